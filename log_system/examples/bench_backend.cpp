@@ -0,0 +1,98 @@
+// 64 个日志器各自带后台线程，与挂在共享后台(1/2/4 个线程)上的对比：
+// 进程的线程数、上下文切换次数，以及 4 个生产者轮流写各日志器时全部写出所用的时间
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kLoggers = 64;
+const size_t kProducers = 4;
+const size_t kPerProducer = 250000;
+
+// 只统计行数
+class CountFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *data, size_t len) override
+    {
+        lines_ += std::count(data, data + len, '\n');
+    }
+    std::atomic<size_t> lines_{0};
+};
+
+size_t ThreadCount()
+{
+    size_t count = 0;
+    DIR *dir = opendir("/proc/self/task");
+    while (dir && readdir(dir))
+        ++count;
+    if (dir)
+        closedir(dir);
+    return count > 2 ? count - 2 : 0; // 去掉 . 和 ..
+}
+
+long ContextSwitches()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+void RunOnce(const char *name, mylog::LogBackend::ptr backend)
+{
+    std::vector<mylog::AsyncLogger::ptr> loggers;
+    size_t base_threads = ThreadCount();
+    for (size_t i = 0; i < kLoggers; ++i)
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName("bench_backend_" + std::to_string(i));
+        builder.BuildLoggerFlush<CountFlush>();
+        if (backend)
+            builder.BuildSharedBackend(backend);
+        loggers.push_back(builder.Build());
+    }
+    // 共享后台的线程在它创建时就有了
+    size_t threads = ThreadCount() - base_threads + (backend ? backend->Threads() : 0);
+
+    long switches = ContextSwitches();
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t t = 0; t < kProducers; ++t)
+        producers.emplace_back([&, t]()
+                               {
+                                   for (size_t i = 0; i < kPerProducer; ++i)
+                                       LOGINFO(loggers[(i + t) % kLoggers], "producer {} request {} finished, cost={}us", t, i, 42); });
+    for (auto &t : producers)
+        t.join();
+    // 所有日志器都写出并同步后计时结束
+    std::vector<uint64_t> seqs;
+    for (auto &logger : loggers)
+        seqs.push_back(logger->Persist());
+    for (size_t i = 0; i < kLoggers; ++i)
+        loggers[i]->WaitPersisted(seqs[i]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    switches = ContextSwitches() - switches;
+    printf("%-14s %-10zu %-14.2f %-12ld\n", name, threads, kProducers * kPerProducer / seconds / 1e6, switches);
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("loggers=%zu producers=%zu lines=%zu\n", kLoggers, kProducers, kProducers * kPerProducer);
+    printf("%-14s %-10s %-14s %-12s\n", "backend", "threads", "Mlines/s", "ctx-switches");
+    RunOnce("own threads", nullptr);
+    RunOnce("shared x1", std::make_shared<mylog::LogBackend>(1));
+    RunOnce("shared x2", std::make_shared<mylog::LogBackend>(2));
+    RunOnce("shared x4", std::make_shared<mylog::LogBackend>(4));
+    delete tp;
+    return 0;
+}
@@ -0,0 +1,219 @@
+// 远程备份客户端的端到端测试：在子进程里起本地接收端(ServerBackupLog 的 TcpServer)，
+// 通过 BackupClient 的长连接发送 N 条记录，发到一半时杀掉接收端(SIGKILL)，停机期间继续发送，
+// 过一段时间重启接收端。最后核对接收端文件中 N 条记录全部到达且按序(至少一次，允许重发的重复)，
+// 以及重连成功后重连间隔回到下限。
+// 开始前先检查落盘队列的恢复：上次退出时最后一条记录写了一半，重启后它之前的记录照常发出，
+// 发送线程随后空闲；正在追加的段里出现损坏记录时同样跳过，不会一直认为还有未发出的记录
+// 用法：./bench_backup [port] [records]
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+#include "../logs_code/backlog/ServerBackupLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const char *kSpoolDir = "./bench_out/backup_spool/";
+const char *kRecvDir = "./bench_out/backup_recv/";
+const int kOutageMs = 1500; // 接收端停机时长，足够让重连间隔翻倍几次
+const size_t kRecovered = 1000; // 启动前留在落盘队列里的记录数，最后一条被截断
+
+// 进程累计使用的CPU时间(用户态+内核态)，秒
+double CpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+std::string Frames(size_t begin, size_t end)
+{
+    std::string frames;
+    char record[64];
+    for (size_t i = begin; i < end; ++i)
+    {
+        int n = snprintf(record, sizeof(record), "seq=%08zu backup record\n", i);
+        uint32_t head = htonl(n);
+        frames.append(reinterpret_cast<const char *>(&head), sizeof(head));
+        frames.append(record, n);
+    }
+    return frames;
+}
+
+// 模拟上次退出时最后一条记录只写了一半：写入 count 条记录后把段文件截掉几个字节
+void PrepareSpool(size_t count)
+{
+    {
+        mylog::BackupSpool spool(kSpoolDir, g_conf_data->backup_segment_bytes, g_conf_data->backup_spool_bytes);
+        spool.Append(Frames(0, count));
+    }
+    std::string seg = std::string(kSpoolDir) + "00000000000000000001.seg"; // 空目录下的第一个段
+    struct stat st;
+    if (stat(seg.c_str(), &st) != 0 || truncate(seg.c_str(), st.st_size - 3) != 0)
+        perror("truncate spool segment");
+}
+
+// 正在追加的段里最后一条记录损坏(不重启)：读出它之前的记录后 Unsent() 应变为假
+bool CorruptWriteSegment()
+{
+    std::string dir = "./bench_out/backup_spool_corrupt/";
+    mylog::BackupSpool spool(dir, g_conf_data->backup_segment_bytes, g_conf_data->backup_spool_bytes);
+    spool.Append(Frames(0, 10));
+    std::string seg = dir + "00000000000000000001.seg"; // 构造时新开的段，即正在追加的段
+    struct stat st;
+    int fd = open(seg.c_str(), O_WRONLY);
+    if (fd < 0 || stat(seg.c_str(), &st) != 0 || pwrite(fd, "X", 1, st.st_size - 1) != 1)
+        perror("corrupt spool segment");
+    close(fd);
+    size_t read = 0;
+    for (int i = 0; i < 3 && spool.Unsent(); ++i)
+    {
+        std::string out;
+        size_t n = spool.Read(&out, 1024 * 1024);
+        spool.Consume(out.size());
+        read += n;
+    }
+    printf("corrupt write segment: read=%zu/9 unsent=%d\n", read, spool.Unsent());
+    return read == 9 && !spool.Unsent();
+}
+
+// 在子进程里运行接收端，返回子进程号
+pid_t StartReceiver(uint16_t port)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        TcpServer server(port, kRecvDir, 1);
+        if (!server.init_service())
+            _exit(1);
+        server.start_service();
+        _exit(0);
+    }
+    return pid;
+}
+
+void StopReceiver(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+// 读出接收端文件中的记录序号
+std::vector<size_t> Received()
+{
+    std::vector<size_t> seqs;
+    std::ifstream ifs(std::string(kRecvDir) + "127.0.0.1.log");
+    std::string line;
+    while (std::getline(ifs, line))
+        if (line.compare(0, 4, "seq=") == 0)
+            seqs.push_back(std::stoul(line.substr(4)));
+    return seqs;
+}
+
+// 等到接收端收到 count 条不重复的记录，最多等 timeout_ms
+bool WaitReceived(size_t count, int timeout_ms)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto seqs = Received();
+        size_t next = 0;
+        for (auto s : seqs)
+            if (s == next)
+                ++next;
+        if (next >= count)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+void SendRange(size_t begin, size_t end)
+{
+    char record[64];
+    for (size_t i = begin; i < end; ++i)
+    {
+        int n = snprintf(record, sizeof(record), "seq=%08zu backup record\n", i);
+        mylog::BackupClient::GetInstance().Send(record, n);
+        if (i % 100 == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? atoi(argv[1]) : 28080;
+    size_t records = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+    if (system("rm -rf ./bench_out/backup_spool ./bench_out/backup_spool_corrupt ./bench_out/backup_recv") != 0)
+        return 1;
+    mkdir("./bench_out", 0755);
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    g_conf_data->backup_addr = "127.0.0.1";
+    g_conf_data->backup_port = port;
+    g_conf_data->backup_spool_dir = kSpoolDir;
+
+    bool corrupt_ok = CorruptWriteSegment();
+    PrepareSpool(kRecovered);
+
+    pid_t receiver = StartReceiver(port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    mylog::BackupClient &client = mylog::BackupClient::GetInstance();
+    int min_backoff = client.Backoff();
+    auto begin = std::chrono::steady_clock::now();
+
+    // 重启后先发出落盘队列里截断记录之前的部分，之后发送线程应当空闲
+    bool recovered = WaitReceived(kRecovered - 1, 10000);
+    double cpu = CpuSeconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double idle_cpu = (CpuSeconds() - cpu) / 0.5 * 100;
+    printf("recovered=%s idle cpu=%.1f%%\n", recovered ? "yes" : "no", idle_cpu);
+
+    // 被截断的那条记录丢失，从它开始重新编号，接收端的序号仍然连续
+    // 前一半发完并等接收端写出后再杀掉：协议没有应答，已写进对端内核缓冲但未读出的数据会随进程一起丢掉
+    SendRange(kRecovered - 1, records / 2);
+    bool first_half = WaitReceived(records / 2, 10000);
+    StopReceiver(receiver);
+
+    // 停机期间继续发送，记录留在落盘队列里，重连间隔翻倍
+    auto outage_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(kOutageMs);
+    SendRange(records / 2, records);
+    std::this_thread::sleep_until(outage_end);
+    int outage_backoff = client.Backoff();
+
+    receiver = StartReceiver(port);
+    bool all = WaitReceived(records, 30000 + outage_backoff);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    int final_backoff = client.Backoff();
+    StopReceiver(receiver);
+
+    auto seqs = Received();
+    size_t next = 0, dups = 0;
+    bool ordered = true;
+    for (auto s : seqs)
+    {
+        if (s == next)
+            ++next;
+        else if (s < next)
+            ++dups; // 至少一次：读位置落盘前断开的记录会重发
+        else
+            ordered = false;
+    }
+    printf("records=%zu received=%zu dups=%zu dropped=%zu %.2fs\n", records, next, dups, client.Dropped(), secs);
+    printf("backoff(ms): start=%d outage=%d after reconnect=%d\n", min_backoff, outage_backoff, final_backoff);
+    bool ok = corrupt_ok && recovered && idle_cpu < 10 && first_half && all && ordered && next == records && outage_backoff > min_backoff && final_backoff == min_backoff;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// 测量后台线程的CPU占用：空闲时、低频写入时的进程CPU使用率(getrusage)，以及满负载下的写入吞吐，
+// 空闲的日志器应当几乎不占CPU
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/AsyncWorker.hpp"
+#include "../logs_code/Util.hpp"
+
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 4;             // 满负载时的生产者线程数
+const size_t kTotalMessages = 2000000; // 满负载时写入的总条数
+const size_t kMessageSize = 128;       // 单条日志长度
+
+// 进程累计使用的CPU时间(用户态+内核态)，秒
+double CpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// 运行 func 并返回这段时间内进程的CPU使用率(百分比)
+template <typename Func>
+double CpuPercent(Func &&func)
+{
+    double cpu = CpuSeconds();
+    auto begin = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return (CpuSeconds() - cpu) / std::chrono::duration<double>(end - begin).count() * 100;
+}
+
+void RunOnce(const char *name, mylog::AsyncType type)
+{
+    std::atomic<size_t> consumed(0);
+    std::atomic<size_t> batches(0);
+    mylog::AsyncWorker worker([&](mylog::Buffer &buffer)
+                              { consumed += buffer.ReadableSize(); ++batches; },
+                              type);
+    std::string message(kMessageSize - 1, 'x');
+    message += '\n';
+
+    // 空闲：不写任何日志
+    double idle = CpuPercent([]()
+                             { std::this_thread::sleep_for(std::chrono::seconds(2)); });
+    // 低频：每10毫秒写一条
+    double trickle = CpuPercent([&]()
+                                {
+                                    for (int i = 0; i < 200; ++i)
+                                    {
+                                        worker.Push(message.data(), message.size());
+                                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                                    } });
+    size_t trickle_batches = batches.load();
+
+    // 满负载
+    size_t per_thread = kTotalMessages / kThreads;
+    size_t expect = consumed.load() + per_thread * kThreads * kMessageSize;
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < kThreads; ++i)
+        producers.emplace_back([&]()
+                               {
+                                   for (size_t j = 0; j < per_thread; ++j)
+                                       worker.Push(message.data(), message.size()); });
+    for (auto &t : producers)
+        t.join();
+    while (consumed.load() < expect)
+        std::this_thread::yield();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+
+    printf("%-10s %-12.2f %-14.2f %-16zu %-12.2f\n", name, idle, trickle, trickle_batches,
+           per_thread * kThreads / seconds / 1e6);
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    printf("flush_bytes=%zu flush_interval_ms=%zu consumer_spin=%zu\n",
+           g_conf_data->flush_bytes, g_conf_data->flush_interval_ms, g_conf_data->consumer_spin);
+    printf("%-10s %-12s %-14s %-16s %-12s\n", "type", "idle(%cpu)", "trickle(%cpu)", "trickle batches", "Mmsg/s");
+    RunOnce("safe", mylog::AsyncType::ASYNC_SAFE);
+    RunOnce("unsafe", mylog::AsyncType::ASYNC_UNSAFE);
+    RunOnce("lockfree", mylog::AsyncType::ASYNC_LOCKFREE);
+    RunOnce("staged", mylog::AsyncType::ASYNC_STAGED);
+    return 0;
+}
@@ -0,0 +1,51 @@
+// 测量被等级过滤掉的日志调用的开销，与真正写日志的调用对比
+// 编译期裁剪的效果可用 -DMYLOG_ACTIVE_LEVEL=1 重新编译本文件观察 DEBUG 一行
+#include <chrono>
+#include <cstdio>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+// 什么都不做的落地方向，只测前台开销
+class NullFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *, size_t) override {}
+};
+
+const size_t kCalls = 1000000;
+
+template <typename Func>
+double NsPerCall(Func &&func)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kCalls; ++i)
+        func(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / kCalls;
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    mylog::LoggerBuilder builder;
+    builder.BuildLoggerName("bench_level");
+    builder.BuildLoggerFlush<NullFlush>();
+    builder.BuildLoggerLevel(mylog::LogLevel::value::INFO); // 运行时关闭 DEBUG
+    auto logger = builder.Build();
+
+    printf("MYLOG_ACTIVE_LEVEL=%d\n", MYLOG_ACTIVE_LEVEL);
+    printf("%-36s %8.2f ns\n", "disabled LOGDEBUG (typed)", NsPerCall([&](size_t i)
+                                                                     { LOGDEBUG(logger, "request {} done, {} bytes", i, i * 2); }));
+    printf("%-36s %8.2f ns\n", "disabled ->Debug (printf)", NsPerCall([&](size_t i)
+                                                                     { logger->Debug("request %zu done, %zu bytes", i, i * 2); }));
+    printf("%-36s %8.2f ns\n", "enabled LOGINFO (typed)", NsPerCall([&](size_t i)
+                                                                   { LOGINFO(logger, "request {} done, {} bytes", i, i * 2); }));
+    printf("%-36s %8.2f ns\n", "enabled ->Info (printf)", NsPerCall([&](size_t i)
+                                                                   { logger->Info("request %zu done, %zu bytes", i, i * 2); }));
+    logger.reset();
+    delete tp;
+    return 0;
+}
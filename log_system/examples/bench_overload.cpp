@@ -0,0 +1,109 @@
+// 落地方向跟不上时各溢出策略的表现：生产者吞吐与单次调用最长耗时、各类丢弃计数、
+// 文件中保留下来的 ERROR 行数以及 "messages dropped" 汇总行数
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 4;
+const size_t kPerThread = 200000;
+const size_t kErrorEvery = 100; // 每100条有一条 ERROR
+
+// 写文件前按数据量等待，吞吐约为 20MB/s，模拟很慢的磁盘
+class SlowFileFlush : public mylog::FileFlush
+{
+public:
+    SlowFileFlush(const std::string &filename) : FileFlush(filename) {}
+    void Flush(const char *data, size_t len) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(len / 20));
+        FileFlush::Flush(data, len);
+    }
+    // 逐块经过上面的 Flush，不走 FileFlush 的 writev
+    void FlushV(const struct iovec *iov, int iovcnt) override { LogFlush::FlushV(iov, iovcnt); }
+};
+
+size_t CountLines(const std::string &file, const char *pattern)
+{
+    std::ifstream ifs(file);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(ifs, line))
+        if (line.find(pattern) != std::string::npos)
+            ++count;
+    return count;
+}
+
+void RunOnce(const char *name, mylog::AsyncType type, mylog::OverloadPolicy policy)
+{
+    const std::string file = "./logs/bench_overload.log";
+    unlink(file.c_str());
+    double seconds, max_us;
+    mylog::DropStats stats;
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName("bench_overload");
+        builder.BuildLopperType(type);
+        builder.BuildOverloadPolicy(policy);
+        builder.BuildLoggerFlush<SlowFileFlush>(file);
+        auto logger = builder.Build();
+
+        std::atomic<uint64_t> max_ns(0);
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < kThreads; ++t)
+            producers.emplace_back([&, t]()
+                                   {
+                                       uint64_t longest = 0;
+                                       for (size_t i = 0; i < kPerThread; ++i)
+                                       {
+                                           auto s = std::chrono::steady_clock::now();
+                                           if (i % kErrorEvery == 0)
+                                               LOGERROR(logger, "thread {} request {} failed", t, i);
+                                           else
+                                               LOGINFO(logger, "thread {} request {} finished, bytes={}, cost={}us", t, i, i * 3, 42);
+                                           longest = std::max<uint64_t>(longest, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                                     std::chrono::steady_clock::now() - s).count());
+                                       }
+                                       uint64_t cur = max_ns.load();
+                                       while (longest > cur && !max_ns.compare_exchange_weak(cur, longest))
+                                           ; });
+        for (auto &t : producers)
+            t.join();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        max_us = max_ns / 1e3;
+        stats = logger->GetDropStats();
+    } // 日志器析构时把剩余日志写完
+    printf("%-22s %-10.0f %-10.0f %-10lu %-10lu %-10lu %-8zu/%-8zu %-8zu\n", name,
+           kThreads * kPerThread / seconds, max_us,
+           static_cast<unsigned long>(stats.dropped_newest), static_cast<unsigned long>(stats.dropped_oldest),
+           static_cast<unsigned long>(stats.sampled_out),
+           CountLines(file, "][ERROR]["), kThreads * kPerThread / kErrorEvery, CountLines(file, "messages dropped"));
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("threads=%zu lines=%zu buffer_size=%zu sample_rate=%zu\n", kThreads, kThreads * kPerThread,
+           g_conf_data->buffer_size, g_conf_data->sample_rate);
+    printf("%-22s %-10s %-10s %-10s %-10s %-10s %-17s %-8s\n", "policy", "lines/s", "max(us)",
+           "newest", "oldest", "sampled", "errors kept", "reports");
+    RunOnce("SAFE BLOCK", mylog::AsyncType::ASYNC_SAFE, mylog::OverloadPolicy::BLOCK);
+    RunOnce("SAFE DROP_NEWEST", mylog::AsyncType::ASYNC_SAFE, mylog::OverloadPolicy::DROP_NEWEST);
+    RunOnce("SAFE DROP_OLDEST", mylog::AsyncType::ASYNC_SAFE, mylog::OverloadPolicy::DROP_OLDEST);
+    RunOnce("SAFE SAMPLE", mylog::AsyncType::ASYNC_SAFE, mylog::OverloadPolicy::SAMPLE);
+    RunOnce("LOCKFREE DROP_NEWEST", mylog::AsyncType::ASYNC_LOCKFREE, mylog::OverloadPolicy::DROP_NEWEST);
+    RunOnce("LOCKFREE SAMPLE", mylog::AsyncType::ASYNC_LOCKFREE, mylog::OverloadPolicy::SAMPLE);
+    delete tp;
+    return 0;
+}
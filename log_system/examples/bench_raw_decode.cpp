@@ -0,0 +1,183 @@
+// 二进制 RAW 模式的离线解码检查：
+// 1. 滚动输出把日志切成多个文件，用全新的解码器逐个单独解码，每个文件的记录都能还原
+// 2. 按 DROP 丢弃的落地方向被卡住、队列已满时才出现新的调用点，带着定义的批次被丢弃，
+//    方向恢复后收到的记录仍然都能解码
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const char *kRollDir = "./bench_out/raw_roll/";
+const size_t kRecords = 200000;
+
+// 数据中普通日志记录的条数(不含调用点定义和文本记录)
+size_t CountRecords(const std::string &data)
+{
+    size_t count = 0;
+    mylog::BinaryHeader head;
+    for (size_t pos = 0; pos + sizeof(head) <= data.size(); pos += head.size)
+    {
+        memcpy(&head, data.data() + pos, sizeof(head));
+        if (head.size < sizeof(head))
+            break;
+        if (head.site != mylog::kTextSite && head.site != mylog::kDefineSite)
+            ++count;
+    }
+    return count;
+}
+
+// 用全新的解码器解码，返回还原出的行数
+size_t DecodedLines(const std::string &data)
+{
+    mylog::BinaryDecoder decoder;
+    std::string out;
+    decoder.Decode(data.data(), data.size(), &out);
+    return std::count(out.begin(), out.end(), '\n');
+}
+
+// 写 [begin, end) 的记录：前半段只用一个调用点，后半段才出现另外两个
+void Produce(mylog::AsyncLogger::ptr &logger, size_t begin = 0, size_t end = kRecords)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (i < kRecords / 2)
+            LOGINFO(logger, "request {} finished, bytes={}", i, i * 3);
+        else if (i % 2)
+            LOGINFO(logger, "request {} retried, attempt={}", i, i % 5);
+        else
+            LOGWARN(logger, "request {} slow, cost={}us", i, i % 977);
+    }
+}
+
+bool RollFiles()
+{
+    if (system("rm -rf ./bench_out/raw_roll") != 0)
+        return false;
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName("bench_raw_roll");
+        builder.BuildLopperType(mylog::AsyncType::ASYNC_UNSAFE);
+        builder.BuildBinaryMode(mylog::BinaryMode::RAW);
+        builder.BuildLoggerFlush<mylog::RollFileFlush>(std::string(kRollDir) + "r_", 512 * 1024);
+        auto logger = builder.Build();
+        Produce(logger);
+    }
+    std::vector<std::string> files;
+    DIR *dir = opendir(kRollDir);
+    while (struct dirent *ent = dir ? readdir(dir) : nullptr)
+        if (ent->d_name[0] != '.')
+            files.push_back(std::string(kRollDir) + ent->d_name);
+    if (dir)
+        closedir(dir);
+    size_t records = 0, decoded = 0, broken = 0;
+    for (auto &file : files)
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        size_t n = CountRecords(ss.str()), lines = DecodedLines(ss.str());
+        records += n;
+        decoded += lines;
+        if (lines != n)
+            ++broken;
+    }
+    printf("roll: files=%zu records=%zu decoded separately=%zu files with undecodable records=%zu\n",
+           files.size(), records, decoded, broken);
+    return files.size() > 2 && records == kRecords && decoded == kRecords;
+}
+
+// 收下写来的数据，Open 之前一直卡在第一次写入上，队列很快积压到上限
+class BlockedCapture : public mylog::LogFlush
+{
+public:
+    void Flush(const char *data, size_t len) override
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]()
+                   { return open_; });
+        data_.append(data, len);
+    }
+    void Open()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            open_ = true;
+        }
+        cond_.notify_all();
+    }
+    std::string data_; // 只在落地方向线程里写，日志器析构后再读
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool open_ = false;
+};
+
+// 等到落地方向丢弃的批数超过 count
+bool WaitDropped(mylog::AsyncLogger::ptr &logger, uint64_t count)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (logger->GetSinkStats()[0].dropped_batches <= count)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+bool DropSink()
+{
+    size_t queue_bytes = g_conf_data->sink_queue_bytes;
+    g_conf_data->sink_queue_bytes = 256 * 1024;
+    auto capture = std::make_shared<BlockedCapture>();
+    mylog::SinkStats stats;
+    bool dropped = false;
+    {
+        std::vector<mylog::LogFlush::ptr> flushs{capture};
+        auto logger = std::make_shared<mylog::AsyncLogger>("bench_raw_drop", flushs, mylog::AsyncType::ASYNC_UNSAFE,
+                                                           mylog::BinaryMode::RAW,
+                                                           std::vector<mylog::SinkPolicy>{mylog::SinkPolicy::DROP});
+        // 前半段把队列塞满，然后新调用点第一次出现的批次(带着它们的定义)也被丢弃
+        Produce(logger, 0, kRecords / 2);
+        dropped = WaitDropped(logger, 0);
+        uint64_t before = logger->GetSinkStats()[0].dropped_batches;
+        Produce(logger, kRecords / 2, kRecords / 2 + 1000);
+        dropped = dropped && WaitDropped(logger, before);
+        // 恢复后写出的新调用点记录依赖前面被丢弃批次中的定义
+        capture->Open();
+        Produce(logger, kRecords / 2 + 1000, kRecords);
+        stats = logger->GetSinkStats()[0];
+    }
+    g_conf_data->sink_queue_bytes = queue_bytes;
+    size_t records = CountRecords(capture->data_), decoded = DecodedLines(capture->data_);
+    printf("drop: dropped batches=%lu records kept=%zu decoded=%zu\n",
+           static_cast<unsigned long>(stats.dropped_batches), records, decoded);
+    return dropped && records > 0 && decoded == records;
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    mkdir("./bench_out", 0755);
+    bool roll_ok = RollFiles();
+    bool drop_ok = DropSink();
+    delete tp;
+    printf("%s\n", roll_ok && drop_ok ? "OK" : "FAILED");
+    return roll_ok && drop_ok ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// 32 个线程同时按名字取日志器并判断级别，比较三种取法每次的耗时：
+// mutex 加 unordered_map 的旧注册表(每次加锁并复制 shared_ptr)、
+// 当前的 GetLogger(快照查表不加锁，但仍复制 shared_ptr)、缓存的 LoggerHandle(不查表也不改引用计数)
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 32;
+const size_t kPerThread = 1000000;
+
+// 旧的注册表：每次查找都加锁
+class LockedRegistry
+{
+public:
+    void Add(const mylog::AsyncLogger::ptr &logger)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        loggers_.insert(std::make_pair(logger->Name(), logger));
+    }
+    mylog::AsyncLogger::ptr Get(const std::string &name)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto it = loggers_.find(name);
+        return it == loggers_.end() ? mylog::AsyncLogger::ptr() : it->second;
+    }
+
+private:
+    std::mutex mtx_;
+    std::unordered_map<std::string, mylog::AsyncLogger::ptr> loggers_;
+};
+
+template <typename Func>
+double RunOnce(Func &&func)
+{
+    std::atomic<size_t> hits(0);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t)
+        threads.emplace_back([&]()
+                             {
+                                 size_t n = 0;
+                                 for (size_t i = 0; i < kPerThread; ++i)
+                                     n += func();
+                                 hits += n; });
+    for (auto &t : threads)
+        t.join();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    if (hits != kThreads * kPerThread)
+        printf("expect %zu hits, got %zu\n", kThreads * kPerThread, hits.load());
+    // 单次调用的耗时：墙钟时间乘以同时在跑的线程数(不超过 CPU 数)再除以总次数
+    size_t running = std::max<size_t>(1, std::min<size_t>(kThreads, std::thread::hardware_concurrency()));
+    return ns * running / (kThreads * kPerThread);
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    const std::string name = "bench_registry";
+    mylog::LoggerBuilder builder;
+    builder.BuildLoggerName(name);
+    builder.BuildLoggerFlush<mylog::StdoutFlush>();
+    auto logger = builder.Build();
+    mylog::LoggerManager::GetInstance().AddLogger(mylog::AsyncLogger::ptr(logger));
+    // 再注册几个日志器，让表里不止一项
+    for (int i = 0; i < 8; ++i)
+    {
+        mylog::LoggerBuilder other;
+        other.BuildLoggerName("bench_registry_" + std::to_string(i));
+        other.BuildLoggerFlush<mylog::StdoutFlush>();
+        mylog::LoggerManager::GetInstance().AddLogger(other.Build());
+    }
+
+    LockedRegistry locked;
+    for (int i = 0; i < 8; ++i)
+        locked.Add(mylog::GetLogger("bench_registry_" + std::to_string(i)));
+    locked.Add(logger);
+    static mylog::LoggerHandle handle = mylog::GetLoggerHandle(name);
+
+    printf("threads=%zu lookups=%zu cpus=%u\n", kThreads, kThreads * kPerThread, std::thread::hardware_concurrency());
+    printf("%-16s %-12s\n", "lookup", "ns/call");
+    printf("%-16s %-12.1f\n", "mutex map", RunOnce([&]()
+                                                   { return locked.Get(name)->ShouldLog(mylog::LogLevel::value::INFO); }));
+    printf("%-16s %-12.1f\n", "GetLogger", RunOnce([&]()
+                                                   { return mylog::GetLogger(name)->ShouldLog(mylog::LogLevel::value::INFO); }));
+    printf("%-16s %-12.1f\n", "cached handle", RunOnce([&]()
+                                                       { return handle->ShouldLog(mylog::LogLevel::value::INFO); }));
+    delete tp;
+    return 0;
+}
@@ -0,0 +1,58 @@
+// 对比双缓冲区(ASYNC_SAFE)、无锁环形缓冲区(ASYNC_LOCKFREE)与线程暂存缓冲区(ASYNC_STAGED)
+// 在 1~64 个生产者线程下的写入吞吐
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/AsyncWorker.hpp"
+#include "../logs_code/Util.hpp"
+
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kTotalMessages = 2000000; // 每轮写入的总条数，平均分给各生产者
+const size_t kMessageSize = 128;       // 单条日志长度
+
+double RunOnce(mylog::AsyncType type, size_t threads)
+{
+    std::atomic<size_t> consumed(0);
+    size_t per_thread = kTotalMessages / threads;
+    size_t expect = per_thread * threads * kMessageSize;
+    mylog::AsyncWorker worker([&](mylog::Buffer &buffer)
+                              { consumed += buffer.ReadableSize(); },
+                              type);
+    std::string message(kMessageSize - 1, 'x');
+    message += '\n';
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < threads; ++i)
+        producers.emplace_back([&]()
+                               {
+                                   for (size_t j = 0; j < per_thread; ++j)
+                                       worker.Push(message.data(), message.size()); });
+    for (auto &t : producers)
+        t.join();
+    // 等消费者把数据全部交给回调才算结束
+    while (consumed.load() < expect)
+        std::this_thread::yield();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    printf("%-8s %-16s %-18s %-16s\n", "threads", "safe(Mmsg/s)", "lockfree(Mmsg/s)", "staged(Mmsg/s)");
+    for (size_t threads = 1; threads <= 64; threads *= 2)
+    {
+        size_t total = kTotalMessages / threads * threads;
+        double safe = RunOnce(mylog::AsyncType::ASYNC_SAFE, threads);
+        double lockfree = RunOnce(mylog::AsyncType::ASYNC_LOCKFREE, threads);
+        double staged = RunOnce(mylog::AsyncType::ASYNC_STAGED, threads);
+        printf("%-8zu %-16.2f %-18.2f %-16.2f\n", threads,
+               total / safe / 1e6, total / lockfree / 1e6, total / staged / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// 分片日志器在 1~8 个分片下的端到端吞吐：8 个生产者线程写入，日志器析构(全部写入文件)后计时结束。
+// text 列为文本模式，后台线程只做 writev；backend 列为二进制模式，格式化在后台线程完成，
+// 单个后台线程更容易成为瓶颈。落地方向为 SharedFileFlush，各分片按预留偏移同时写一个文件
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 8;
+const size_t kPerThread = 250000;
+
+size_t CountLines(const std::string &file)
+{
+    std::ifstream ifs(file);
+    return std::count(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>(), '\n');
+}
+
+double RunOnce(size_t shards, mylog::BinaryMode mode)
+{
+    const std::string file = "./logs/bench_shards.log";
+    unlink(file.c_str());
+    auto begin = std::chrono::steady_clock::now();
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName("bench_shards");
+        builder.BuildLopperType(mylog::AsyncType::ASYNC_SAFE);
+        builder.BuildBinaryMode(mode);
+        builder.BuildShards(shards);
+        builder.BuildLoggerFlush<mylog::SharedFileFlush>(file);
+        auto logger = builder.Build();
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < kThreads; ++t)
+            producers.emplace_back([&, t]()
+                                   {
+                                       for (size_t i = 0; i < kPerThread; ++i)
+                                           LOGINFO(logger, "thread {} request {} finished, bytes={}, cost={}us, ratio={}",
+                                                   t, i, i * 3, 42, 0.75); });
+        for (auto &t : producers)
+            t.join();
+    } // 析构时等所有分片写完
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    size_t lines = CountLines(file);
+    if (lines != kThreads * kPerThread)
+        printf("shards=%zu: expect %zu lines, got %zu\n", shards, kThreads * kPerThread, lines);
+    return kThreads * kPerThread / seconds / 1e6;
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("producers=%zu lines=%zu cpus=%u\n", kThreads, kThreads * kPerThread, std::thread::hardware_concurrency());
+    printf("%-8s %-16s %-16s\n", "shards", "text(Mlines/s)", "backend(Mlines/s)");
+    for (size_t shards : {1, 2, 4, 8})
+        printf("%-8zu %-16.2f %-16.2f\n", shards, RunOnce(shards, mylog::BinaryMode::OFF),
+               RunOnce(shards, mylog::BinaryMode::BACKEND));
+    delete tp;
+    return 0;
+}
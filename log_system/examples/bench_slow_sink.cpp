@@ -0,0 +1,116 @@
+// 一个文件落地方向加一个很慢的落地方向(模拟被慢速消费者读取的管道)：
+// 对比慢方向在异步工作器线程里直接写(INLINE)与独立线程的 BLOCK/DROP/DEGRADE 策略下，
+// 生产者的吞吐、阻塞时间、文件方向是否完整，以及慢方向的积压统计。
+// DEGRADE 下分别用文本和 JSON 记录格式检查慢方向收到了全部 ERROR 行
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 4;
+const size_t kPerThread = 200000;
+const double kBlockedNs = 20000; // 单次调用超过20微秒视为被阻塞
+
+std::atomic<size_t> g_slow_errors(0); // 慢方向收到的 ERROR 行数
+
+// 每批写入都要等待，吞吐约为 20MB/s
+class SlowFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *data, size_t len) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(len / 20));
+        bytes_ += len;
+        // 信息体里没有 ERROR 字样，文本行的 [ERROR] 和 JSON 行的 "level":"ERROR" 各出现一次
+        std::string_view view(data, len);
+        for (size_t pos = view.find("ERROR"); pos != std::string_view::npos; pos = view.find("ERROR", pos + 5))
+            ++g_slow_errors;
+    }
+    std::atomic<size_t> bytes_{0};
+};
+
+size_t CountLines(const std::string &file)
+{
+    std::ifstream ifs(file);
+    return std::count(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>(), '\n');
+}
+
+// 返回慢方向是否收到了全部 ERROR 行
+bool RunOnce(const char *name, mylog::SinkPolicy policy, mylog::RecordLayout layout = mylog::RecordLayout::TEXT)
+{
+    const std::string file = "./logs/bench_slow_sink.log";
+    unlink(file.c_str());
+    g_slow_errors = 0;
+    mylog::LoggerBuilder builder;
+    builder.BuildLoggerName("bench_slow_sink");
+    builder.BuildLopperType(mylog::AsyncType::ASYNC_SAFE);
+    builder.BuildRecordLayout(layout);
+    builder.BuildLoggerFlush<mylog::FileFlush>(file);
+    builder.BuildLoggerFlush<SlowFlush>();
+    builder.BuildSinkPolicy(policy);
+    auto logger = builder.Build();
+
+    std::atomic<uint64_t> blocked_ns(0);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t t = 0; t < kThreads; ++t)
+        producers.emplace_back([&, t]()
+                               {
+                                   uint64_t blocked = 0;
+                                   for (size_t i = 0; i < kPerThread; ++i)
+                                   {
+                                       auto s = std::chrono::steady_clock::now();
+                                       if (i % 1000 == 0)
+                                           LOGERROR(logger, "thread {} request {} failed", t, i);
+                                       else
+                                           LOGINFO(logger, "thread {} request {} finished, bytes={}, cost={}us", t, i, i * 3, 42);
+                                       uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::steady_clock::now() - s).count();
+                                       if (ns > kBlockedNs)
+                                           blocked += ns;
+                                   }
+                                   blocked_ns += blocked; });
+    for (auto &t : producers)
+        t.join();
+    double produce = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    mylog::SinkStats stats = logger->GetSinkStats()[1];
+    // 文件方向写完所用的时间，DROP/DEGRADE 下不受慢方向影响
+    logger->Persist();
+    while (CountLines(file) < kThreads * kPerThread &&
+           std::chrono::steady_clock::now() - begin < std::chrono::seconds(60))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    double file_done = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    printf("%-8s %-12.0f %-12.1f %-10.2f %-12zu %-10lu %-14lu %-10lu\n", name,
+           kThreads * kPerThread / produce, blocked_ns / 1e6, file_done,
+           stats.queued_bytes, static_cast<unsigned long>(stats.lag_ms),
+           static_cast<unsigned long>(stats.dropped_bytes), static_cast<unsigned long>(stats.degraded_batches));
+    logger.reset(); // 等慢方向把队列写完
+    return g_slow_errors == kThreads * kPerThread / 1000;
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("threads=%zu lines=%zu sink_queue_bytes=%zu\n", kThreads, kThreads * kPerThread, g_conf_data->sink_queue_bytes);
+    printf("%-8s %-12s %-12s %-10s %-12s %-10s %-14s %-10s\n", "policy", "lines/s", "blocked(ms)", "file(s)",
+           "queued(B)", "lag(ms)", "dropped(B)", "degraded");
+    RunOnce("INLINE", mylog::SinkPolicy::INLINE);
+    RunOnce("BLOCK", mylog::SinkPolicy::BLOCK);
+    RunOnce("DROP", mylog::SinkPolicy::DROP);
+    bool text_ok = RunOnce("DEGRADE", mylog::SinkPolicy::DEGRADE);
+    bool json_ok = RunOnce("DEG-JSON", mylog::SinkPolicy::DEGRADE, mylog::RecordLayout::JSON);
+    printf("degraded sink kept all ERROR lines: text=%s json=%s\n", text_ok ? "yes" : "no", json_ok ? "yes" : "no");
+    delete tp;
+    printf("%s\n", text_ok && json_ok ? "OK" : "FAILED");
+    return text_ok && json_ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// 存储服务请求日志(url、字节数、压缩算法、耗时)四种写法的单线程生产者耗时：
+// {} 格式化成文本、结构化字段的文本格式、结构化字段的 JSON 格式，
+// 以及在调用点构造 Json::Value 再序列化后作为信息体写入。
+// 另外写一批带引号、换行、控制字符和中文的记录，用 jsoncpp 逐行解析检查 JSON 格式的输出
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jsoncpp/json/json.h>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kLines = 1000000;
+
+// 只统计字节数
+class CountFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *, size_t len) override { bytes_ += len; }
+    std::atomic<size_t> bytes_{0};
+};
+
+// 保存写出的全部数据
+class CaptureFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *data, size_t len) override
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        data_.append(data, len);
+    }
+    std::mutex mtx_;
+    std::string data_;
+};
+
+mylog::AsyncLogger::ptr MakeLogger(mylog::RecordLayout layout, mylog::LogFlush::ptr flush)
+{
+    std::vector<mylog::LogFlush::ptr> flushs{flush};
+    return std::make_shared<mylog::AsyncLogger>("bench_structured", flushs, mylog::AsyncType::ASYNC_SAFE,
+                                                mylog::BinaryMode::OFF, std::vector<mylog::SinkPolicy>(),
+                                                mylog::OverloadPolicy::BLOCK, 1, nullptr, layout);
+}
+
+template <typename Func>
+void RunOnce(const char *name, mylog::RecordLayout layout, Func &&func)
+{
+    auto flush = std::make_shared<CountFlush>();
+    double seconds;
+    {
+        auto logger = MakeLogger(layout, flush);
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kLines; ++i)
+            func(logger, i);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    printf("%-18s %-10.1f %-10.1f\n", name, seconds * 1e9 / kLines, static_cast<double>(flush->bytes_) / kLines);
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    const std::string url = "/download/low_storage/report-2024.pdf";
+    const char *codec = "LZ4";
+
+    printf("lines=%zu\n", kLines);
+    printf("%-18s %-10s %-10s\n", "encoding", "ns/line", "bytes/line");
+    RunOnce("format text", mylog::RecordLayout::TEXT, [&](mylog::AsyncLogger::ptr &logger, size_t i)
+            { LOGINFO(logger, "request url={} bytes={} codec={} latency_us={}", url, i * 3, codec, i % 977); });
+    RunOnce("kv text", mylog::RecordLayout::TEXT, [&](mylog::AsyncLogger::ptr &logger, size_t i)
+            { LOGINFOKV(logger, "request", mylog::KV("url", url), mylog::KV("bytes", i * 3),
+                        mylog::KV("codec", codec), mylog::KV("latency_us", i % 977)); });
+    RunOnce("kv json", mylog::RecordLayout::JSON, [&](mylog::AsyncLogger::ptr &logger, size_t i)
+            { LOGINFOKV(logger, "request", mylog::KV("url", url), mylog::KV("bytes", i * 3),
+                        mylog::KV("codec", codec), mylog::KV("latency_us", i % 977)); });
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    RunOnce("Json::Value", mylog::RecordLayout::TEXT, [&](mylog::AsyncLogger::ptr &logger, size_t i)
+            {
+                Json::Value root;
+                root["url"] = url;
+                root["bytes"] = Json::UInt64(i * 3);
+                root["codec"] = codec;
+                root["latency_us"] = Json::UInt64(i % 977);
+                std::ostringstream oss;
+                writer->write(root, &oss);
+                LOGINFO(logger, "{}", oss.str()); });
+
+    // 检查 JSON 输出能被解析，字段值与写入时一致
+    const std::string tricky[] = {"plain", "quote\" back\\slash", "line\nbreak\ttab", std::string("nul\0ctl\x01\x1f", 9),
+                                  "中文路径/文件.txt", std::string(20000, 'x')};
+    auto capture = std::make_shared<CaptureFlush>();
+    {
+        auto logger = MakeLogger(mylog::RecordLayout::JSON, capture);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const std::string &value = tricky[i % (sizeof(tricky) / sizeof(tricky[0]))];
+            LOGINFOKV(logger, "check \"msg\"", mylog::KV("i", i), mylog::KV("value", value),
+                      mylog::KV("ratio", 0.5), mylog::KV("ok", i % 2 == 0));
+            LOGINFO(logger, "format {} with\ttab", value);
+        }
+    }
+    size_t lines = 0, bad = 0, truncated = 0;
+    std::istringstream iss(capture->data_);
+    std::string line;
+    Json::CharReaderBuilder reader_builder;
+    std::unique_ptr<Json::CharReader> reader(reader_builder.newCharReader());
+    while (std::getline(iss, line))
+    {
+        ++lines;
+        Json::Value root;
+        std::string err;
+        if (!reader->parse(line.data(), line.data() + line.size(), &root, &err))
+        {
+            ++bad;
+            continue;
+        }
+        if (!root.isMember("i"))
+            continue;
+        const std::string &value = tricky[root["i"].asUInt64() % (sizeof(tricky) / sizeof(tricky[0]))];
+        if (root["value"].asString() != value)
+            ++truncated; // 超过单条长度上限的值被截断
+    }
+    printf("json check: lines=%zu parse_errors=%zu truncated_values=%zu\n", lines, bad, truncated);
+    delete tp;
+    return 0;
+}
@@ -0,0 +1,397 @@
+// 日志系统基准测试集：在生产者线程数、信息体大小、异步类型、flush_log 和落地方向几个维度上测量
+// 端到端吞吐(msgs/s、MB/s，从开始写到全部落地)、生产者吞吐，以及单次调用耗时的分位数。
+// 默认以 4 线程、128 字节、ASYNC_SAFE、flush_log=0、FileFlush 为基准，每次只改变一个维度；
+// --full 时对各维度取笛卡尔积。每个用例一行 JSON 写入结果文件，--compare 与之前的结果对比，
+// 吞吐下降或 p99 耗时上升超过 --tolerance 百分比时列出并以非0状态退出，用于发现回退。
+// 需要在 log_system/examples 目录下运行(配置文件按相对路径读取)，见同目录的 Makefile
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const char *kOutDir = "./bench_out/"; // 落地方向写出的文件，每个用例结束后清空
+const size_t kSampleEvery = 16;        // 每个生产者每隔多少次调用计一次耗时
+const std::string kSinks[] = {"null", "file", "roll", "shared", "mmap", "uring"};
+
+// 什么也不写，只衡量日志器本身
+class NullFlush : public mylog::LogFlush
+{
+public:
+    void Flush(const char *, size_t) override {}
+    void FlushV(const struct iovec *, int) override {}
+    bool Concurrent() override { return true; }
+};
+
+struct Case
+{
+    std::string sink;
+    std::string type;
+    int flush_log;
+    size_t threads;
+    size_t size;
+    std::string Key() const
+    {
+        return sink + "/" + type + "/flush_log=" + std::to_string(flush_log) + "/threads=" + std::to_string(threads) +
+               "/size=" + std::to_string(size);
+    }
+};
+
+struct Result
+{
+    double seconds;          // 从开始写到全部落地
+    double producer_seconds; // 所有生产者写完
+    double msgs_per_s;
+    double mb_per_s;
+    double producer_msgs_per_s;
+    uint64_t p50_ns, p90_ns, p99_ns, p999_ns, max_ns; // 单次调用耗时(抽样)
+    mylog::MetricsSnapshot metrics;
+};
+
+mylog::AsyncType ParseType(const std::string &type)
+{
+    if (type == "unsafe")
+        return mylog::AsyncType::ASYNC_UNSAFE;
+    if (type == "lockfree")
+        return mylog::AsyncType::ASYNC_LOCKFREE;
+    if (type == "staged")
+        return mylog::AsyncType::ASYNC_STAGED;
+    return mylog::AsyncType::ASYNC_SAFE;
+}
+
+void AddSink(mylog::LoggerBuilder &builder, const std::string &sink)
+{
+    std::string file = std::string(kOutDir) + "bench_" + sink + ".log";
+    if (sink == "null")
+        builder.BuildLoggerFlush<NullFlush>();
+    else if (sink == "file")
+        builder.BuildLoggerFlush<mylog::FileFlush>(file);
+    else if (sink == "roll")
+        builder.BuildLoggerFlush<mylog::RollFileFlush>(file, 64 * 1024 * 1024);
+    else if (sink == "shared")
+        builder.BuildLoggerFlush<mylog::SharedFileFlush>(file);
+    else if (sink == "mmap")
+        builder.BuildLoggerFlush<mylog::MmapFileFlush>(file);
+    else if (sink == "uring")
+        builder.BuildLoggerFlush<mylog::IoUringFileFlush>(file);
+}
+
+void CleanOutDir()
+{
+    DIR *dir = opendir(kOutDir);
+    if (dir == nullptr)
+        return;
+    while (struct dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.')
+            unlink((std::string(kOutDir) + entry->d_name).c_str());
+    closedir(dir);
+}
+
+uint64_t Percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * p / 100));
+    return sorted[index];
+}
+
+Result RunCase(const Case &c, size_t lines)
+{
+    g_conf_data->flush_log = c.flush_log; // 落地方向每次写入时读取，工作器在构造时读取
+    CleanOutDir();
+    const std::string payload(c.size, 'x');
+    size_t per_thread = lines / c.threads;
+    std::vector<std::vector<uint64_t>> samples(c.threads);
+    Result r;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName("bench_suite");
+        builder.BuildLopperType(ParseType(c.type));
+        AddSink(builder, c.sink);
+        auto logger = builder.Build();
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < c.threads; ++t)
+            producers.emplace_back([&, t]()
+                                   {
+                                       std::vector<uint64_t> &sample = samples[t];
+                                       sample.reserve(per_thread / kSampleEvery + 1);
+                                       std::string_view body(payload);
+                                       for (size_t i = 0; i < per_thread; ++i)
+                                       {
+                                           if (i % kSampleEvery)
+                                           {
+                                               LOGINFO(logger, "{} {} {}", t, i, body);
+                                               continue;
+                                           }
+                                           auto call = std::chrono::steady_clock::now();
+                                           LOGINFO(logger, "{} {} {}", t, i, body);
+                                           sample.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                std::chrono::steady_clock::now() - call).count());
+                                       } });
+        for (auto &t : producers)
+            t.join();
+        r.producer_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        logger->WaitPersisted(logger->Persist());
+        r.metrics = logger->GetMetrics();
+    } // 析构时后台线程写完剩余数据
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    CleanOutDir();
+
+    std::vector<uint64_t> all;
+    for (auto &sample : samples)
+        all.insert(all.end(), sample.begin(), sample.end());
+    std::sort(all.begin(), all.end());
+    size_t total = per_thread * c.threads;
+    r.msgs_per_s = total / r.seconds;
+    r.mb_per_s = r.metrics.bytes / r.seconds / (1024 * 1024);
+    r.producer_msgs_per_s = total / r.producer_seconds;
+    r.p50_ns = Percentile(all, 50);
+    r.p90_ns = Percentile(all, 90);
+    r.p99_ns = Percentile(all, 99);
+    r.p999_ns = Percentile(all, 99.9);
+    r.max_ns = all.empty() ? 0 : all.back();
+    return r;
+}
+
+// 一个用例的结果写成一行 JSON
+std::string ToJson(const Case &c, const Result &r, size_t lines)
+{
+    char buf[2048];
+    mylog::FixedWriter writer(buf, sizeof(buf));
+    mylog::JsonWriter json(writer);
+    json.Add("case", mylog::MakeArg(c.Key()));
+    json.Add("sink", mylog::MakeArg(c.sink));
+    json.Add("type", mylog::MakeArg(c.type));
+    json.Add("flush_log", mylog::MakeArg(c.flush_log));
+    json.Add("threads", mylog::MakeArg(c.threads));
+    json.Add("msg_size", mylog::MakeArg(c.size));
+    json.Add("lines", mylog::MakeArg(lines));
+    json.Add("seconds", mylog::MakeArg(r.seconds));
+    json.Add("msgs_per_s", mylog::MakeArg(static_cast<uint64_t>(r.msgs_per_s)));
+    json.Add("mb_per_s", mylog::MakeArg(r.mb_per_s));
+    json.Add("producer_msgs_per_s", mylog::MakeArg(static_cast<uint64_t>(r.producer_msgs_per_s)));
+    json.Add("lat_p50_ns", mylog::MakeArg(r.p50_ns));
+    json.Add("lat_p90_ns", mylog::MakeArg(r.p90_ns));
+    json.Add("lat_p99_ns", mylog::MakeArg(r.p99_ns));
+    json.Add("lat_p999_ns", mylog::MakeArg(r.p999_ns));
+    json.Add("lat_max_ns", mylog::MakeArg(r.max_ns));
+    json.Add("bytes", mylog::MakeArg(r.metrics.bytes));
+    json.Add("swaps", mylog::MakeArg(r.metrics.swaps));
+    json.Add("high_water_bytes", mylog::MakeArg(r.metrics.high_water_bytes));
+    json.Add("producer_waits", mylog::MakeArg(r.metrics.producer_wait.count));
+    json.Add("producer_wait_ms", mylog::MakeArg(r.metrics.producer_wait.sum_ns / 1000000));
+    json.Add("dropped", mylog::MakeArg(r.metrics.dropped));
+    json.Add("cpus", mylog::MakeArg(std::thread::hardware_concurrency()));
+    json.End();
+    return std::string(writer.Data(), writer.Size());
+}
+
+std::vector<std::string> Split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+std::vector<size_t> SplitNumbers(const std::string &list)
+{
+    std::vector<size_t> numbers;
+    for (auto &item : Split(list))
+        numbers.push_back(std::stoul(item));
+    return numbers;
+}
+
+// 与之前的结果对比，返回回退的用例数
+size_t Compare(const std::string &baseline, const std::vector<std::string> &results, double tolerance)
+{
+    std::map<std::string, Json::Value> old;
+    std::ifstream ifs(baseline);
+    if (!ifs)
+    {
+        std::cout << __FILE__ << __LINE__ << "open baseline failed: " << baseline << std::endl;
+        perror(NULL);
+        return 0;
+    }
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        Json::Value root;
+        mylog::Util::JsonUtil::UnSerialize(line, &root); // 返回值不表示成功与否，按内容判断
+        if (root.isObject() && root.isMember("case"))
+            old[root["case"].asString()] = root;
+    }
+    size_t regressions = 0;
+    printf("\n%-56s %10s   %10s\n", "compare with baseline", "msgs/s", "p99");
+    for (auto &result : results)
+    {
+        Json::Value cur;
+        mylog::Util::JsonUtil::UnSerialize(result, &cur);
+        auto it = old.find(cur["case"].asString());
+        if (it == old.end())
+            continue;
+        double speed = (cur["msgs_per_s"].asDouble() / std::max(1.0, it->second["msgs_per_s"].asDouble()) - 1) * 100;
+        double p99 = (cur["lat_p99_ns"].asDouble() / std::max(1.0, it->second["lat_p99_ns"].asDouble()) - 1) * 100;
+        bool regressed = speed < -tolerance || p99 > tolerance;
+        regressions += regressed;
+        printf("%-56s %+9.1f%%   %+9.1f%%   %s\n", cur["case"].asCString(), speed, p99, regressed ? "REGRESSION" : "");
+    }
+    return regressions;
+}
+
+void Usage(const char *prog)
+{
+    printf("usage: %s [--lines N] [--repeat N] [--threads 1,2,4,8] [--sizes 32,128,512,2048]\n"
+           "          [--types safe,unsafe,lockfree,staged] [--flush-log 0,1,2]\n"
+           "          [--sinks null,file,roll,shared,mmap,uring] [--full]\n"
+           "          [--out results.jsonl] [--compare baseline.jsonl] [--tolerance 10]\n",
+           prog);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lines = 400000, repeat = 1;
+    std::vector<size_t> threads{1, 2, 4, 8}, sizes{32, 128, 512, 2048};
+    std::vector<std::string> types{"safe", "unsafe", "lockfree", "staged"}, sinks(std::begin(kSinks), std::end(kSinks));
+    std::vector<size_t> flush_logs{0, 1, 2};
+    bool full = false;
+    std::string out = "bench_results.jsonl", baseline;
+    double tolerance = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--full")
+        {
+            full = true;
+            continue;
+        }
+        if (arg == "--help" || i + 1 >= argc)
+        {
+            Usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        ++i;
+        if (arg == "--lines")
+            lines = std::stoul(value);
+        else if (arg == "--repeat")
+            repeat = std::max<size_t>(1, std::stoul(value));
+        else if (arg == "--threads")
+            threads = SplitNumbers(value);
+        else if (arg == "--sizes")
+            sizes = SplitNumbers(value);
+        else if (arg == "--types")
+            types = Split(value);
+        else if (arg == "--flush-log")
+            flush_logs = SplitNumbers(value);
+        else if (arg == "--sinks")
+            sinks = Split(value);
+        else if (arg == "--out")
+            out = value;
+        else if (arg == "--compare")
+            baseline = value;
+        else if (arg == "--tolerance")
+            tolerance = std::stod(value);
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    mkdir(kOutDir, 0755);
+
+    // 基准用例取各维度列表中最接近默认基准的值
+    auto pick = [](const std::vector<size_t> &list, size_t want)
+    { return std::find(list.begin(), list.end(), want) != list.end() ? want : list.front(); };
+    auto pick_str = [](const std::vector<std::string> &list, const std::string &want)
+    { return std::find(list.begin(), list.end(), want) != list.end() ? want : list.front(); };
+    Case base{pick_str(sinks, "file"), pick_str(types, "safe"), static_cast<int>(pick(flush_logs, 0)),
+              pick(threads, 4), pick(sizes, 128)};
+    std::vector<Case> cases;
+    auto add = [&](const Case &c)
+    {
+        for (auto &old : cases)
+            if (old.Key() == c.Key())
+                return;
+        cases.push_back(c);
+    };
+    if (full)
+    {
+        for (auto &sink : sinks)
+            for (auto &type : types)
+                for (size_t flush_log : flush_logs)
+                    for (size_t t : threads)
+                        for (size_t size : sizes)
+                            add(Case{sink, type, static_cast<int>(flush_log), t, size});
+    }
+    else
+    {
+        for (size_t t : threads)
+            add(Case{base.sink, base.type, base.flush_log, t, base.size});
+        for (size_t size : sizes)
+            add(Case{base.sink, base.type, base.flush_log, base.threads, size});
+        for (auto &type : types)
+            add(Case{base.sink, type, base.flush_log, base.threads, base.size});
+        for (size_t flush_log : flush_logs)
+            add(Case{base.sink, base.type, static_cast<int>(flush_log), base.threads, base.size});
+        for (auto &sink : sinks)
+            add(Case{sink, base.type, base.flush_log, base.threads, base.size});
+    }
+
+    std::ofstream ofs(out, std::ios::trunc);
+    if (!ofs)
+    {
+        std::cout << __FILE__ << __LINE__ << "open result file failed: " << out << std::endl;
+        perror(NULL);
+        return 1;
+    }
+    printf("cases=%zu lines=%zu repeat=%zu cpus=%u out=%s\n", cases.size(), lines, repeat,
+           std::thread::hardware_concurrency(), out.c_str());
+    printf("%-56s %-10s %-8s %-10s %-9s %-9s %-9s\n", "case", "Mmsgs/s", "MB/s", "prod Mm/s", "p50(ns)", "p99(ns)",
+           "p999(ns)");
+    std::vector<std::string> results;
+    for (auto &c : cases)
+    {
+        if (std::find(std::begin(kSinks), std::end(kSinks), c.sink) == std::end(kSinks))
+        {
+            printf("unknown sink: %s\n", c.sink.c_str());
+            continue;
+        }
+        // 重复多次时取吞吐居中的一次
+        std::vector<Result> runs;
+        for (size_t i = 0; i < repeat; ++i)
+            runs.push_back(RunCase(c, lines));
+        std::sort(runs.begin(), runs.end(), [](const Result &a, const Result &b)
+                  { return a.msgs_per_s < b.msgs_per_s; });
+        const Result &r = runs[runs.size() / 2];
+        printf("%-56s %-10.2f %-8.1f %-10.2f %-9lu %-9lu %-9lu\n", c.Key().c_str(), r.msgs_per_s / 1e6, r.mb_per_s,
+               r.producer_msgs_per_s / 1e6, r.p50_ns, r.p99_ns, r.p999_ns);
+        results.push_back(ToJson(c, r, lines));
+        ofs << results.back() << '\n';
+        ofs.flush();
+    }
+    size_t regressions = baseline.empty() ? 0 : Compare(baseline, results, tolerance);
+    delete tp;
+    return regressions ? 2 : 0;
+}
@@ -0,0 +1,110 @@
+// 调用点限流与重复折叠：4 个生产者在同一个调用点上反复写同一条 WARN，
+// 比较直接写、限流(每秒5条)和重复折叠(1秒)三种方式每次调用的耗时。
+// 调用点突发之后不再调用：等窗口过去，日志器仍存活时文件中就应有剩余压下条数的汇报(后台线程补写)；
+// 另有一组突发后立即销毁日志器，汇报由析构写出。核对放行条数加汇报的压下条数等于调用次数
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 4;
+const size_t kPerThread = 1000000;
+
+enum class Mode
+{
+    PLAIN,
+    LIMIT,
+    DEDUP
+};
+
+void Storm(const mylog::AsyncLogger::ptr &logger, Mode mode, size_t calls)
+{
+    for (size_t i = 0; i < calls; ++i)
+    {
+        if (mode == Mode::PLAIN)
+            LOGWARN(logger, "write {} failed: {}", "./low_storage/a.txt", "No space left on device");
+        else if (mode == Mode::LIMIT)
+            LOGWARNLIMIT(logger, 5, 1000, "write {} failed: {}", "./low_storage/a.txt", "No space left on device");
+        else
+            LOGWARNDEDUP(logger, 1000, "write {} failed: {}", "./low_storage/a.txt", "No space left on device");
+    }
+}
+
+// 统计文件中放行的条数、汇报的次数和汇报的压下条数
+void Count(const std::string &file, size_t *written, size_t *reports, uint64_t *suppressed)
+{
+    std::ifstream ifs(file);
+    std::string line;
+    *written = *reports = *suppressed = 0;
+    while (std::getline(ifs, line))
+    {
+        size_t pos;
+        if ((pos = line.find("last message repeated ")) != std::string::npos)
+            *suppressed += std::stoull(line.substr(pos + 22)), ++*reports;
+        else if ((pos = line.find("]\t")) != std::string::npos && line.find(" messages suppressed by rate limit") != std::string::npos)
+            *suppressed += std::stoull(line.substr(pos + 2)), ++*reports;
+        else if (line.find("No space left on device") != std::string::npos)
+            ++*written;
+    }
+}
+
+// quiet 为真时突发后等窗口过去，在日志器存活时检查汇报已写出；否则突发后立即销毁日志器
+void Run(const char *name, Mode mode, size_t per_thread, bool quiet = true)
+{
+    const std::string file = std::string("./logs/bench_throttle_") + name + ".log";
+    unlink(file.c_str());
+    double ns;
+    size_t written, reports;
+    uint64_t suppressed;
+    size_t calls = kThreads * per_thread;
+    bool quiet_ok = true;
+    {
+        mylog::LoggerBuilder builder;
+        builder.BuildLoggerName(std::string("bench_throttle_") + name);
+        builder.BuildLopperType(mylog::AsyncType::ASYNC_SAFE);
+        builder.BuildLoggerFlush<mylog::FileFlush>(file);
+        auto logger = builder.Build();
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < kThreads; ++t)
+            producers.emplace_back([&]()
+                                   { Storm(logger, mode, per_thread); });
+        for (auto &t : producers)
+            t.join();
+        ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / calls;
+        if (mode != Mode::PLAIN && quiet)
+        {
+            // 调用点不再被调用，等窗口或间隔过去，后台线程应自己写出剩下的压下条数
+            std::this_thread::sleep_for(std::chrono::milliseconds(1300));
+            Count(file, &written, &reports, &suppressed);
+            quiet_ok = written + suppressed == calls;
+        }
+        logger->WaitPersisted(logger->Persist());
+    }
+    Count(file, &written, &reports, &suppressed);
+    bool ok = quiet_ok && written + suppressed == calls;
+    printf("%-10s %8.1f ns/call  written=%-8zu reports=%-4zu suppressed=%-8lu total=%lu/%zu %s\n", name, ns, written,
+           reports, suppressed, written + suppressed, calls, ok ? "OK" : "MISMATCH");
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("threads=%zu calls/thread=%zu\n", kThreads, kPerThread);
+    Run("plain", Mode::PLAIN, kPerThread / 10); // 全部写出，调用次数少一些
+    Run("limit", Mode::LIMIT, kPerThread);
+    Run("dedup", Mode::DEDUP, kPerThread);
+    Run("limit_exit", Mode::LIMIT, kPerThread / 10, false); // 窗口还没过去就销毁，汇报由析构写出
+    Run("dedup_exit", Mode::DEDUP, kPerThread / 10, false);
+    delete tp;
+    return 0;
+}
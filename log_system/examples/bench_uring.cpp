@@ -0,0 +1,84 @@
+// 对比 FileFlush、MmapFileFlush 与 IoUringFileFlush(io_uring 及退化的写线程两种路径)：
+// ASYNC_SAFE 模式下持续写入的 MB/s，以及生产者因缓冲区写满而阻塞的时间
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "../logs_code/MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+mylog::Util::JsonData *g_conf_data;
+
+const size_t kThreads = 4;
+const size_t kPerThread = 500000;
+const double kBlockedNs = 20000; // 单次调用超过20微秒视为被阻塞
+
+struct Result
+{
+    double seconds;
+    double blocked_ms; // 所有生产者被阻塞的总时间
+    double max_us;     // 单次调用的最长耗时
+};
+
+template <typename FlushType, typename... Args>
+Result RunOnce(const std::string &file, Args &&...args)
+{
+    unlink(file.c_str());
+    mylog::LoggerBuilder builder;
+    builder.BuildLoggerName("bench_uring");
+    builder.BuildLopperType(mylog::AsyncType::ASYNC_SAFE);
+    builder.BuildLoggerFlush<FlushType>(file, std::forward<Args>(args)...);
+    auto logger = builder.Build();
+
+    std::atomic<uint64_t> blocked_ns(0);
+    std::atomic<uint64_t> max_ns(0);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t t = 0; t < kThreads; ++t)
+        producers.emplace_back([&]()
+                               {
+                                   uint64_t blocked = 0, longest = 0;
+                                   for (size_t i = 0; i < kPerThread; ++i)
+                                   {
+                                       auto s = std::chrono::steady_clock::now();
+                                       LOGINFO(logger, "request {} finished, user={}, bytes={}, cost={}us", i, "benchmark", i * 3, 42);
+                                       uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::steady_clock::now() - s).count();
+                                       if (ns > kBlockedNs)
+                                           blocked += ns;
+                                       longest = std::max(longest, ns);
+                                   }
+                                   blocked_ns += blocked;
+                                   uint64_t cur = max_ns.load();
+                                   while (longest > cur && !max_ns.compare_exchange_weak(cur, longest))
+                                       ; });
+    for (auto &t : producers)
+        t.join();
+    logger->WaitPersisted(logger->Persist()); // 全部写入文件才算结束
+    auto end = std::chrono::steady_clock::now();
+    return Result{std::chrono::duration<double>(end - begin).count(), blocked_ns / 1e6, max_ns / 1e3};
+}
+
+void Print(const char *name, const std::string &file, const Result &r)
+{
+    double mb = mylog::Util::File().FileSize(file) / 1024.0 / 1024.0;
+    printf("%-18s %-10.1f %-14.1f %-12.1f\n", name, mb / r.seconds, r.blocked_ms, r.max_us);
+}
+
+int main()
+{
+    g_conf_data = mylog::Util::JsonData::GetJsonData();
+    tp = new ThreadPool(g_conf_data->thread_count);
+    printf("flush_log=%zu threads=%zu lines=%zu\n", g_conf_data->flush_log, kThreads, kThreads * kPerThread);
+    printf("%-18s %-10s %-14s %-12s\n", "sink", "MB/s", "blocked(ms)", "max(us)");
+    Print("FileFlush", "./logs/bench_file.log", RunOnce<mylog::FileFlush>("./logs/bench_file.log"));
+    Print("Mmap", "./logs/bench_mmap.log", RunOnce<mylog::MmapFileFlush>("./logs/bench_mmap.log"));
+    Print("IoUring", "./logs/bench_uring.log", RunOnce<mylog::IoUringFileFlush>("./logs/bench_uring.log"));
+    Print("IoUring(pwrite)", "./logs/bench_pwrite.log", RunOnce<mylog::IoUringFileFlush>("./logs/bench_pwrite.log", false));
+    delete tp;
+    return 0;
+}
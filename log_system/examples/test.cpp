@@ -15,6 +15,7 @@ void test() {
         mylog::GetLogger("asynclogger")->Debug("测试日志-%d", cnt++);
         mylog::GetLogger("asynclogger")->Error("测试日志-%d", cnt++);
         mylog::GetLogger("asynclogger")->Fatal("测试日志-%d", cnt++);
+        LOGINFO(mylog::GetLogger("asynclogger"), "测试日志-{}", cnt++);
     }
 }
 
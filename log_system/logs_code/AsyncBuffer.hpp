@@ -1,6 +1,11 @@
 /*日志缓冲区类设计*/
 #pragma once
+#include <sys/uio.h>
+
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "Util.hpp"
@@ -9,91 +14,177 @@ extern mylog::Util::JsonData *g_conf_data;
 
 namespace mylog
 {
-    class Buffer
+    // 缓冲区块：一段连续内存及其中已写入的长度
+    struct Block
+    {
+        char *data;
+        size_t cap; // 容量
+        size_t len; // 已写入的长度
+    };
+
+    // 所有异步工作器共用的缓冲区块池：缓冲区增长时从这里取固定大小(block_size)的块，
+    // 处理完一批后整块还回来，突发过后空闲的块留给下一次突发使用，
+    // 空闲总量超过 block_pool_bytes 的部分直接释放
+    class BlockPool
     {
     public:
-        Buffer() : write_pos_(0), read_pos_(0)
+        static BlockPool &GetInstance()
+        {
+            // 不析构：退出时静态对象中的缓冲区可能还会还块
+            static BlockPool *pool = new BlockPool;
+            return *pool;
+        }
+        // 取一块至少 len 字节的块，超过 block_size 的单独分配，不进入池
+        Block Get(size_t len)
+        {
+            if (len <= block_size_)
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (!idle_.empty())
+                {
+                    char *data = idle_.back();
+                    idle_.pop_back();
+                    return Block{data, block_size_, 0};
+                }
+                ++allocated_;
+                return Block{new char[block_size_], block_size_, 0};
+            }
+            return Block{new char[len], len, 0};
+        }
+        void Put(const Block &block)
         {
-            buffer_.resize(g_conf_data->buffer_size);
+            if (block.cap == block_size_)
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if ((idle_.size() + 1) * block_size_ <= max_idle_bytes_)
+                {
+                    idle_.push_back(block.data);
+                    return;
+                }
+                --allocated_;
+            }
+            delete[] block.data;
         }
+        size_t BlockSize() const { return block_size_; }
+        // 池中空闲的字节数
+        size_t IdleBytes()
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            return idle_.size() * block_size_;
+        }
+        // 已分配的标准块字节数(使用中加空闲)
+        size_t AllocatedBytes()
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            return allocated_ * block_size_;
+        }
+
+    private:
+        BlockPool()
+            : block_size_(g_conf_data->block_size),
+              max_idle_bytes_(g_conf_data->block_pool_bytes),
+              allocated_(0) {}
+
+        const size_t block_size_;
+        const size_t max_idle_bytes_;
+        std::mutex mtx_;
+        std::vector<char *> idle_;
+        size_t allocated_;
+    };
+
+    // 由缓冲区块串成的链：增长时追加新块，已写入的数据从不搬动；
+    // 每条记录保证落在同一块内，按块遍历时拿到的都是完整的记录
+    class Buffer
+    {
+    public:
+        Buffer() : size_(0), capacity_(g_conf_data->buffer_size), sync_seq_(0) {}
+        ~Buffer() { Reset(); }
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
         // 写入数据
         void Push(const char *data, size_t len)
         {
-            ToBeEnough(len); // 确保容量足够
-            // 开始写入
-            std::copy(data, data + len, &buffer_[write_pos_]);
-            write_pos_ += len;
+            memcpy(Reserve(len), data, len);
+            Commit(len);
+        }
+        // 预留 len 字节的连续可写空间，返回写指针，生产者直接在其中写数据后调用 Commit。
+        // 最后一块放不下时追加新块，原有数据不动
+        char *Reserve(size_t len)
+        {
+            if (blocks_.empty() || blocks_.back().cap - blocks_.back().len < len)
+                blocks_.push_back(BlockPool::GetInstance().Get(len));
+            return blocks_.back().data + blocks_.back().len;
         }
-        // 读取数据
-        char *ReadBegin(int len)
+        // 提交 Reserve 后实际写入的长度
+        void Commit(size_t len)
         {
-            assert(len <= ReadableSize());
-            return &buffer_[read_pos_];
+            if (len == 0)
+                return;
+            assert(!blocks_.empty() && len <= blocks_.back().cap - blocks_.back().len);
+            blocks_.back().len += len;
+            size_ += len;
         }
         // 判断是否为空
-        bool IsEmpty() { return write_pos_ == read_pos_; }
+        bool IsEmpty() { return size_ == 0; }
         // 交换两个缓冲区
         void Swap(Buffer &buf)
         {
-            buffer_.swap(buf.buffer_);
-            std::swap(read_pos_, buf.read_pos_);
-            std::swap(write_pos_, buf.write_pos_);
+            blocks_.swap(buf.blocks_);
+            std::swap(size_, buf.size_);
+        }
+        // 把 buf 的块整块接到末尾，不复制数据，buf 变为空
+        void Append(Buffer &buf)
+        {
+            for (auto &block : buf.blocks_)
+                blocks_.push_back(block);
+            size_ += buf.size_;
+            buf.blocks_.clear();
+            buf.size_ = 0;
         }
-        // 写空间剩余容量
+        // 距容量(buffer_size)还能写入的字节数，只有 ASYNC_SAFE 按它限制生产者
         size_t WriteableSize()
         {
-            return buffer_.size() - write_pos_;
+            return capacity_ > size_ ? capacity_ - size_ : 0;
         }
-        // 读空间剩余容量
+        // 已写入的字节数
         size_t ReadableSize()
         {
-            return write_pos_ - read_pos_;
+            return size_;
         }
-        // 返回缓冲区起始位置
-        const char *Begin() { return &buffer_[read_pos_]; }
-        // 移动写位置
-        void MoveWritePos(int len)
+        // 按顺序对每块中的数据调用 func(data, len)
+        template <typename Func>
+        void ForEach(Func &&func)
         {
-            assert(len <= WriteableSize());
-            write_pos_ += len;
+            for (auto &block : blocks_)
+                if (block.len)
+                    func(static_cast<const char *>(block.data), block.len);
         }
-        // 移动读位置
-        void MoveReadPos(int len)
+        // 把各块的数据追加到 iov，交给 writev 一次写出
+        void ToIovec(std::vector<struct iovec> *iov)
         {
-            assert(len <= ReadableSize());
-            read_pos_ += len;
+            for (auto &block : blocks_)
+                if (block.len)
+                    iov->push_back(iovec{block.data, block.len});
         }
-        // 重置缓冲区
+        // 重置缓冲区，所有块还回块池
         void Reset()
         {
-            write_pos_ = 0;
-            read_pos_ = 0;
-        }
-
-    protected:
-        // 确保容量足够
-        void ToBeEnough(size_t len)
-        {
-            int buffersize = buffer_.size();
-            // 如果写空间剩余容量小于len，则需要扩容
-            if (len >= WriteableSize())
-            {
-                // 如果缓冲区大小小于阈值，则扩容
-                if (buffer_.size() < g_conf_data->threshold)
-                {
-                    buffer_.resize(2 * buffer_.size() + buffersize);
-                }
-                // 如果缓冲区大小大于阈值，则线性扩容
-                else
-                {
-                    buffer_.resize(g_conf_data->linear_growth + buffersize);
-                }
-            }
+            for (auto &block : blocks_)
+                BlockPool::GetInstance().Put(block);
+            blocks_.clear();
+            size_ = 0;
+            sync_seq_ = 0;
         }
+        // 消费者缓冲区上附带的持久化序号：非0表示处理完这批数据后需要同步到磁盘，
+        // 之后该序号之前请求的日志都已落盘
+        void SetSyncSeq(uint64_t seq) { sync_seq_ = seq; }
+        uint64_t SyncSeq() { return sync_seq_; }
 
     protected:
-        std::vector<char> buffer_; // 缓冲区
-        size_t write_pos_;         // 生产者此时的位置
-        size_t read_pos_;          // 消费者此时的位置
+        std::vector<Block> blocks_; // 缓冲区块链
+        size_t size_;               // 各块已写入的字节数之和
+        const size_t capacity_;     // 基础容量
+        uint64_t sync_seq_;         // 持久化序号，只在消费者缓冲区上使用
     };
-} // namespace mylog
\ No newline at end of file
+} // namespace mylog
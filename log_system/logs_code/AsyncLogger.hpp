@@ -1,14 +1,22 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstdarg>
+#include <cstdio>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "Level.hpp"
 #include "AsyncWorker.hpp"
+#include "BinaryLog.hpp"
+#include "Format.hpp"
 #include "Message.hpp"
+#include "Structured.hpp"
 #include "LogFlush.hpp"
+#include "SinkWorker.hpp"
+#include "Throttle.hpp"
 #include "backlog/CliBackupLog.hpp"
 #include "ThreadPoll.hpp"
 
@@ -21,149 +29,727 @@ namespace mylog
     public:
         using ptr = std::shared_ptr<AsyncLogger>; // 智能指针类型
 
-        AsyncLogger(const std::string &logger_name, std::vector<LogFlush::ptr> &flushs, AsyncType type)
+        // policies 与 flushs 一一对应，缺省的按 SinkPolicy::INLINE 处理。
+        // shards 大于1时日志器分成多个分片，每个分片有自己的缓冲区和后台线程，
+        // 生产者线程固定写其中一个分片，各分片的后台线程同时写同一组落地方向。
+        // backend 不为空时不创建自己的后台线程，交给共享后台处理。
+        // layout 为 JSON 时所有记录都在前台写成 JSON 行，二进制模式下也包装成文本记录
+        AsyncLogger(const std::string &logger_name, std::vector<LogFlush::ptr> &flushs, AsyncType type,
+                    BinaryMode binary_mode = BinaryMode::OFF,
+                    const std::vector<SinkPolicy> &policies = std::vector<SinkPolicy>(),
+                    OverloadPolicy overload = OverloadPolicy::BLOCK, size_t shards = 1,
+                    LogBackend::ptr backend = nullptr, RecordLayout layout = RecordLayout::TEXT)
             : logger_name_(logger_name),                 // 初始化日志器的名字
               flushs_(flushs.begin(), flushs.end()),     // 添加实例化方式给日志器，如日志输出到文件还是标准输出，可能有多种
-              asyncworker(std::make_shared<AsyncWorker>( // 启动异步工作器
-                  std::bind(&AsyncLogger::RealFlush, this, std::placeholders::_1),
-                  type))
+              level_(static_cast<int>(LogLevel::FromString(g_conf_data->log_level))),
+              binary_mode_(binary_mode),
+              layout_(layout),
+              last_report_(std::chrono::steady_clock::now()),
+              reported_{0, 0, 0},
+              last_metrics_(last_report_),
+              metrics_(std::make_shared<LoggerMetrics>(flushs_.size())),
+              reported_metrics_(metrics_->Read()),
+              defines_(MakeDefines(flushs_, binary_mode)),
+              sync_latency_(MakeSyncLatency(flushs_, metrics_)),
+              sink_locks_(MakeSinkLocks(flushs_, shards)),
+              sinks_(MakeSinks(flushs_, policies, binary_mode != BinaryMode::RAW, layout, shards, metrics_.get(), sync_latency_)),
+              states_(MakeStates(logger_name, shards)),
+              workers_(MakeWorkers(type, overload, shards, backend)) // 启动异步工作器
         {
         }
-        virtual ~AsyncLogger() {};
+        virtual ~AsyncLogger()
+        {
+            // 先停下后台线程把剩余日志写完，再补上最后一段时间的丢弃汇总
+            for (auto &worker : workers_)
+                worker->Stop();
+            ReportDrops(true);
+            ReportThrottled(true);
+            ReportMetrics(true);
+        };
         std::string Name() { return logger_name_; } // 获取日志器名称
+        // 运行时最低日志等级，低于它的日志在格式化之前就直接返回
+        void SetLevel(LogLevel::value level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+        LogLevel::value GetLevel() { return static_cast<LogLevel::value>(level_.load(std::memory_order_relaxed)); }
+        bool ShouldLog(LogLevel::value level)
+        {
+            return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+        }
+        // 有日志时最多等待多少毫秒就写出，默认为 flush_interval_ms
+        void SetFlushInterval(size_t ms)
+        {
+            for (auto &worker : workers_)
+                worker->SetFlushInterval(ms);
+        }
+        // 编译期被裁掉的日志调用会替换成它
+        void NoLog() {}
 
         // 该函数则是特定日志级别的日志信息的格式化，当外部调用该日志器时，使用debug模式的日志就会进来
         // 在serialize时把日志信息中的日志级别定义为DEBUG。
-        void Debug(const std::string &file, size_t line, const std::string format,
-                   ...)
+        // printf 风格接口保留用于兼容，格式串由编译器按 printf 规则检查
+        __attribute__((format(printf, 4, 5))) void Debug(const char *file, size_t line, const char *format, ...)
         {
-            // 获取可变参数列表中的格式
+            if (!ShouldLog(LogLevel::value::DEBUG)) // 等级不够直接返回，不做任何格式化
+                return;
             va_list va;
             va_start(va, format); // 初始化va指针
-            char *ret;
-            int r = vasprintf(&ret, format.c_str(), va); // 将格式化字符串转换为字符串
-            if (r == -1)
-                perror("vasprintf failed!!!: ");
+            serializeV(LogLevel::value::DEBUG, file, line, format, va);
             va_end(va); // 将va指针置空
-            // 生成格式化日志信息并写文件
-            serialize(LogLevel::value::DEBUG, file, line, ret);
-            // 释放ret
-            free(ret);
-            ret = nullptr;
         };
         // 信息级别日志
-        void Info(const std::string &file, size_t line, const std::string format,
-                  ...)
+        __attribute__((format(printf, 4, 5))) void Info(const char *file, size_t line, const char *format, ...)
         {
+            if (!ShouldLog(LogLevel::value::INFO))
+                return;
             va_list va;
-            va_start(va, format); // 初始化va指针
-            char *ret;
-            int r = vasprintf(&ret, format.c_str(), va); // 将格式化字符串转换为字符串
-            if (r == -1)
-                perror("vasprintf failed!!!: ");
-            va_end(va); // 将va指针置空
-
-            serialize(LogLevel::value::INFO, file, line,
-                      ret);
-
-            free(ret);
-            ret = nullptr;
+            va_start(va, format);
+            serializeV(LogLevel::value::INFO, file, line, format, va);
+            va_end(va);
         };
 
-        void Warn(const std::string &file, size_t line, const std::string format,
-                  ...)
+        __attribute__((format(printf, 4, 5))) void Warn(const char *file, size_t line, const char *format, ...)
         {
+            if (!ShouldLog(LogLevel::value::WARN))
+                return;
             va_list va;
             va_start(va, format);
-            char *ret;
-            int r = vasprintf(&ret, format.c_str(), va);
-            if (r == -1)
-                perror("vasprintf failed!!!: ");
+            serializeV(LogLevel::value::WARN, file, line, format, va);
             va_end(va);
-
-            serialize(LogLevel::value::WARN, file, line, ret);
-            free(ret);
-            ret = nullptr;
         };
         // 错误级别日志
-        void Error(const std::string &file, size_t line, const std::string format,
-                   ...)
+        __attribute__((format(printf, 4, 5))) void Error(const char *file, size_t line, const char *format, ...)
         {
+            if (!ShouldLog(LogLevel::value::ERROR))
+                return;
             va_list va;
             va_start(va, format);
-            char *ret;
-            int r = vasprintf(&ret, format.c_str(), va);
-            if (r == -1)
-                perror("vasprintf failed!!!: ");
+            serializeV(LogLevel::value::ERROR, file, line, format, va);
             va_end(va);
-
-            serialize(LogLevel::value::ERROR, file, line,
-                      ret);
-
-            free(ret);
-            ret = nullptr;
         };
         // 致命级别日志
-        void Fatal(const std::string &file, size_t line, const std::string format,
-                   ...)
+        __attribute__((format(printf, 4, 5))) void Fatal(const char *file, size_t line, const char *format, ...)
         {
+            if (!ShouldLog(LogLevel::value::FATAL))
+                return;
             va_list va;
             va_start(va, format);
-            char *ret;
-            int r = vasprintf(&ret, format.c_str(), va);
-            if (r == -1)
-                perror("vasprintf failed!!!: ");
+            serializeV(LogLevel::value::FATAL, file, line, format, va);
             va_end(va);
+        };
+        // 类型安全的格式化接口，格式串用 {} 作占位符，site 由日志宏在调用点静态定义，
+        // N 为宏在编译期统计出的占位符个数，参数类型不支持或个数不符都会编译失败。
+        // 文本模式下结果直接格式化进工作器缓冲区预留的空间；二进制模式下只记录调用点编号、
+        // 时间戳和原始参数，格式化留给后台线程或离线解码工具，两种模式都不申请堆内存
+        template <size_t N, typename... Args>
+        void Log(const LogSite &site, const Args &...args)
+        {
+            static_assert(N == sizeof...(Args), "格式串中 {} 的个数与参数个数不一致");
+            if (!ShouldLog(site.level))
+                return;
+            FormatArg list[sizeof...(Args) + 1] = {MakeArg(args)...};
+            if (layout_ == RecordLayout::JSON)
+            { // 先把信息体格式化到线程局部缓冲区，再转义成 msg 字段
+                FixedWriter text(MessageBuffer(), kMaxLineSize);
+                FormatArgs(text, site.format, list, sizeof...(Args));
+                return Emit(LogMessage(site.level, site.file, site.line, logger_name_.c_str(),
+                                       std::string_view(text.Data(), text.Size())),
+                            nullptr, 0);
+            }
+            if (site.level == LogLevel::value::ERROR || site.level == LogLevel::value::FATAL)
+            {
+                // 需要远程备份的日志要在前台得到文本，先写线程局部缓冲区再拷贝
+                FixedWriter writer(LineBuffer(), kMaxLineSize - 1);
+                LogMessage msg(site.level, site.file, site.line, logger_name_.c_str());
+                msg.FormatHead(writer);
+                FormatArgs(writer, site.format, list, sizeof...(Args));
+                if (binary_mode_ == BinaryMode::OFF)
+                    return serialize(site.level, writer);
+                Backup(site.level, FinishLine(writer), writer.Size() + 1);
+            }
+            else if (binary_mode_ == BinaryMode::OFF)
+            {
+                // 按长度上界在工作器缓冲区中预留空间，直接格式化进去，只有这一次写入
+                LogMessage msg(site.level, site.file, site.line, logger_name_.c_str());
+                size_t bound = msg.MaxHeadSize() + MaxFormattedSize(site.format, list, sizeof...(Args)) + 1;
+                if (bound > kMaxLineSize)
+                    bound = kMaxLineSize;
+                auto slot = Worker().Reserve(bound, site.level);
+                FixedWriter writer(slot.Data(), bound - 1);
+                msg.FormatHead(writer);
+                FormatArgs(writer, site.format, list, sizeof...(Args));
+                FinishLine(writer);
+                slot.Commit(writer.Size() + 1);
+                return;
+            }
+            size_t size = EncodedSize(list, sizeof...(Args));
+            if (size > kMaxLineSize)
+                size = kMaxLineSize;
+            auto slot = Worker().Reserve(size, site.level);
+            FixedWriter writer(slot.Data(), size);
+            EncodeRecord(writer, site.id, list, sizeof...(Args));
+            slot.Commit(writer.Size());
+            SyncUrgent(site.level);
+        }
+        // 结构化日志接口，msg 为调用点固定的信息体，fields 为若干 KV("key", value)。
+        // 按日志器的记录格式写成 msg key=value ... 或一行 JSON，二进制模式下在前台格式化后包装成文本记录
+        template <typename... Fields>
+        void LogFields(const LogSite &site, const Fields &...fields)
+        {
+            static_assert((std::is_same<Fields, Field>::value && ...), "结构化日志的参数必须是 mylog::KV(key, value)");
+            if (!ShouldLog(site.level))
+                return;
+            const Field list[sizeof...(Fields) + 1] = {fields...};
+            Emit(LogMessage(site.level, site.file, site.line, logger_name_.c_str(), site.format),
+                 list, sizeof...(Fields));
+        }
+        // 重复日志折叠接口，dedup 由日志宏在调用点静态定义。参数与上一条放行的相同且在间隔内时
+        // 只计数后返回，否则先补一条折叠的条数再正常写出
+        template <size_t N, typename... Args>
+        void LogDedup(SiteDedup &dedup, const LogSite &site, const Args &...args)
+        {
+            if (!ShouldLog(site.level))
+                return;
+            FormatArg list[sizeof...(Args) + 1] = {MakeArg(args)...};
+            uint64_t repeated = 0;
+            if (!dedup.Admit(HashArgs(list, sizeof...(Args)), &repeated))
+                return;
+            Watch(dedup, site);
+            if (repeated)
+                LogSuppressed(site, repeated, true);
+            Log<N>(site, args...);
+        }
+        // 限流或折叠的调用点放行时补写被压下的条数，与该调用点同级别、同文件行号，
+        // repeat 为真时是与上一条相同而折叠的，否则是超过限流被丢掉的
+        void LogSuppressed(const LogSite &site, uint64_t count, bool repeat)
+        {
+            char buf[64];
+            FixedWriter text(buf, sizeof(buf));
+            Emit(LogMessage(site.level, site.file, site.line, logger_name_.c_str(), SuppressedText(text, count, repeat)),
+                 nullptr, 0);
+        }
+        // 限流或折叠的调用点放行后调用：第一次放行时登记到本日志器，并要求后台线程在它安静下来时醒来，
+        // 这样调用点之后不再被调用，期间压下的条数也会由 ReportThrottled 写出，不会丢失
+        void Watch(ThrottleSite &throttle, const LogSite &site)
+        {
+            if (!throttle.Owned(this))
+            {
+                if (!throttle.Claim(this, &site))
+                    return; // 由最先放行它的日志器负责
+                std::unique_lock<std::mutex> lock(throttle_mtx_);
+                throttled_.push_back(&throttle);
+            }
+            WakeForReport(throttle.IdleAt());
+        }
+        // 持久化水位：Persist 返回一个序号，代表调用之前写入本日志器的全部日志，
+        // 后台线程把它们写入落地方向并同步到存储后，PersistedSeq 推进到该序号
+        // 各分片共用一个序号，其余分片只需立即处理一批即可看到它
+        uint64_t Persist()
+        {
+            uint64_t seq = workers_[0]->RequestSync();
+            for (size_t i = 1; i < workers_.size(); ++i)
+                workers_[i]->RequestFlush();
+            return seq;
+        }
+        // 溢出策略丢弃的日志条数，各分片之和
+        DropStats GetDropStats()
+        {
+            DropStats total{0, 0, 0};
+            for (auto &worker : workers_)
+            {
+                DropStats stats = worker->GetDropStats();
+                total.dropped_newest += stats.dropped_newest;
+                total.dropped_oldest += stats.dropped_oldest;
+                total.sampled_out += stats.sampled_out;
+            }
+            return total;
+        }
+        // 有多个分片或独立线程的落地方向时，取其中最小的已同步序号
+        uint64_t PersistedSeq()
+        {
+            uint64_t seq = UINT64_MAX;
+            for (auto &worker : workers_)
+                seq = std::min(seq, worker->SyncedSeq());
+            for (auto &sink : sinks_)
+                if (sink && sink->SyncedSeq() < seq)
+                    seq = sink->SyncedSeq();
+            return seq;
+        }
+        // 等待序号 seq 之前的日志落盘，timeout_ms 小于0时一直等待，超时返回 false
+        bool WaitPersisted(uint64_t seq, int timeout_ms = -1)
+        {
+            auto deadline = timeout_ms < 0 ? std::chrono::steady_clock::time_point::max()
+                                           : std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            for (auto &worker : workers_)
+            {
+                int left = timeout_ms;
+                if (timeout_ms >= 0)
+                    left = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                    deadline - std::chrono::steady_clock::now()).count());
+                if (!worker->WaitSynced(seq, left))
+                    return false;
+            }
+            for (auto &sink : sinks_)
+                if (sink && !sink->WaitSynced(seq, deadline))
+                    return false;
+            return true;
+        }
+        // 运行指标：写入的条数和字节数、生产者等待、一批的最大字节数和批数、各方向写出和同步的耗时、丢弃数，
+        // 都是创建以来的累计值，两次读取相减得到一段时间内的情况
+        MetricsSnapshot GetMetrics()
+        {
+            MetricsSnapshot snapshot = metrics_->Read();
+            snapshot.dropped = GetDropStats().Total();
+            for (auto &sink : sinks_)
+                if (sink)
+                    snapshot.sink_dropped_batches += sink->Stats().dropped_batches;
+            return snapshot;
+        }
+        // 各落地方向的积压情况，与添加顺序一致，在异步工作器线程中直接写出的方向没有统计，积压为0
+        std::vector<SinkStats> GetSinkStats()
+        {
+            std::vector<SinkStats> stats;
+            for (auto &sink : sinks_)
+                stats.push_back(sink ? sink->Stats() : SinkStats());
+            return stats;
+        }
 
-            serialize(LogLevel::value::FATAL, file, line,
-                      ret);
+    protected:
+        // 每个分片的后台线程私有的状态
+        struct ShardState
+        {
+            ShardState(const std::string &logger) : decoder(logger, true) {}
+            BinaryDecoder decoder;         // 二进制解码器
+            std::string decoded;           // 解码结果，重复使用避免反复分配
+            std::vector<struct iovec> iov; // 交给落地方向的各块数据
+        };
 
-            free(ret);
-            ret = nullptr;
+        // RAW 模式下各分片已写出的调用点定义，各落地方向共用
+        struct Defines
+        {
+            std::mutex mtx;
+            std::string data; // 各调用点的定义记录
         };
 
-    protected:
-        // 在这里将日志消息组织起来，并写入文件
-        void serialize(LogLevel::value level, const std::string &file, size_t line,
-                       char *ret)
+        static std::vector<std::unique_ptr<ShardState>> MakeStates(const std::string &logger, size_t shards)
+        {
+            std::vector<std::unique_ptr<ShardState>> states;
+            for (size_t i = 0; i < std::max<size_t>(shards, 1); ++i)
+                states.emplace_back(new ShardState(logger));
+            return states;
+        }
+        // 分片共用持久化请求序号，各自回调 RealFlush 时带上分片编号
+        std::vector<AsyncWorker::ptr> MakeWorkers(AsyncType type, OverloadPolicy overload, size_t shards,
+                                                  const LogBackend::ptr &backend)
+        {
+            std::vector<AsyncWorker::ptr> workers;
+            auto counter = std::make_shared<std::atomic<uint64_t>>(0);
+            for (size_t i = 0; i < std::max<size_t>(shards, 1); ++i)
+                workers.push_back(std::make_shared<AsyncWorker>(
+                    std::bind(&AsyncLogger::RealFlush, this, i, std::placeholders::_1), type, overload, counter, backend,
+                    metrics_));
+            return workers;
+        }
+        // RAW 模式下让滚动输出换新文件时先写入已出现的调用点定义，新文件不依赖之前的文件。
+        // 必须在后台线程启动前设置
+        static std::shared_ptr<Defines> MakeDefines(const std::vector<LogFlush::ptr> &flushs, BinaryMode mode)
+        {
+            auto defines = std::make_shared<Defines>();
+            if (mode == BinaryMode::RAW)
+                for (auto &flush : flushs)
+                    flush->SetPrologue([defines]()
+                                       {
+                                           std::unique_lock<std::mutex> lock(defines->mtx);
+                                           return defines->data; });
+            return defines;
+        }
+        // 同步耗时的记录方式：能自己记录 fdatasync 耗时的落地方向(含 Flush 中成组提交的同步)直接记到
+        // metrics 的 Sync 中，返回值中对应位置为空；其余的由日志器记录整个 Sync 调用的耗时
+        static std::vector<Histogram *> MakeSyncLatency(const std::vector<LogFlush::ptr> &flushs, const LoggerMetrics::ptr &metrics)
+        {
+            std::vector<Histogram *> latency;
+            for (auto &flush : flushs)
+                latency.push_back(flush->SetSyncLatency(std::shared_ptr<Histogram>(metrics, &metrics->Sync())) ? nullptr : &metrics->Sync());
+            return latency;
+        }
+        // 多个分片时，不能被同时调用的落地方向各配一把锁
+        static std::vector<std::unique_ptr<std::mutex>> MakeSinkLocks(const std::vector<LogFlush::ptr> &flushs, size_t shards)
+        {
+            std::vector<std::unique_ptr<std::mutex>> locks;
+            for (auto &flush : flushs)
+                locks.emplace_back(shards > 1 && !flush->Concurrent() ? new std::mutex : nullptr);
+            return locks;
+        }
+        static std::vector<SinkWorker::ptr> MakeSinks(const std::vector<LogFlush::ptr> &flushs,
+                                                      const std::vector<SinkPolicy> &policies, bool text, RecordLayout layout,
+                                                      size_t shards, LoggerMetrics *metrics,
+                                                      const std::vector<Histogram *> &sync_latency)
+        {
+            std::vector<SinkWorker::ptr> sinks;
+            for (size_t i = 0; i < flushs.size(); ++i)
+            {
+                SinkPolicy policy = i < policies.size() ? policies[i] : SinkPolicy::INLINE;
+                if (policy == SinkPolicy::INLINE)
+                    sinks.emplace_back();
+                else
+                    sinks.emplace_back(new SinkWorker(flushs[i], policy, text, g_conf_data->sink_queue_bytes,
+                                                      std::max<size_t>(shards, 1), &metrics->SinkFlush(i), sync_latency[i], layout));
+            }
+            return sinks;
+        }
+        // 单条日志的最大长度，超出部分被截断
+        static const size_t kMaxLineSize = 16 * 1024;
+        // 每个线程一块格式化缓冲区，格式化时直接写在这里
+        static char *LineBuffer()
+        {
+            thread_local char buffer[kMaxLineSize];
+            return buffer;
+        }
+        // 每个线程一块信息体缓冲区，JSON 格式下信息体先格式化到这里再转义
+        static char *MessageBuffer()
+        {
+            thread_local char buffer[kMaxLineSize];
+            return buffer;
+        }
+        // 每个线程一块二进制记录编码缓冲区
+        static char *RecordBuffer()
+        {
+            thread_local char buffer[kMaxLineSize];
+            return buffer;
+        }
+        // 限流或折叠的汇总文字，repeat 为真时是重复折叠的条数，否则是被限流丢掉的条数
+        static std::string_view SuppressedText(FixedWriter &text, uint64_t count, bool repeat)
+        {
+            if (repeat)
+            {
+                text.Append("last message repeated ");
+                text.AppendNumber(count);
+                text.Append(" times");
+            }
+            else
+            {
+                text.AppendNumber(count);
+                text.Append(" messages suppressed by rate limit");
+            }
+            return std::string_view(text.Data(), text.Size());
+        }
+        // 让0号分片的后台线程在 idle_at(CoarseMs 毫秒)之后醒来一次，即使没有日志，也会执行 ReportThrottled
+        void WakeForReport(uint64_t idle_at)
+        {
+            uint64_t now = Util::Date::CoarseMs();
+            uint64_t delay = idle_at > now ? idle_at - now : 0;
+            // 粗粒度时钟比 steady_clock 最多慢一个节拍，多等1毫秒，醒来时调用点已经安静
+            workers_[0]->WakeAt(std::chrono::steady_clock::now() + std::chrono::milliseconds(delay + 1));
+        }
+        // 生产者线程固定写一个分片：线程第一次写日志时按顺序编号，编号对分片数取模
+        AsyncWorker &Worker()
+        {
+            if (workers_.size() == 1)
+                return *workers_[0];
+            static std::atomic<size_t> next(0);
+            thread_local size_t id = next.fetch_add(1);
+            return *workers_[id % workers_.size()];
+        }
+        // 在分片的后台线程中调用落地方向，需要时加锁
+        template <typename Func>
+        void CallSink(size_t i, Func &&func)
+        {
+            if (!sink_locks_[i])
+                return func();
+            std::unique_lock<std::mutex> lock(*sink_locks_[i]);
+            func();
+        }
+        // 补上换行，缓冲区末尾预留了换行的位置
+        static const char *FinishLine(FixedWriter &writer)
+        {
+            writer.Data()[writer.Size()] = '\n';
+            return writer.Data();
+        }
+        // printf 风格的日志组织，vsnprintf 直接写入线程局部缓冲区
+        void serializeV(LogLevel::value level, const char *file, size_t line,
+                        const char *format, va_list va)
+        {
+            if (layout_ == RecordLayout::JSON)
+            {
+                FixedWriter text(MessageBuffer(), kMaxLineSize);
+                text.AppendV(format, va);
+                return Emit(LogMessage(level, file, line, logger_name_.c_str(),
+                                       std::string_view(text.Data(), text.Size())),
+                            nullptr, 0);
+            }
+            FixedWriter writer(LineBuffer(), kMaxLineSize - 1);
+            LogMessage msg(level, file, line, logger_name_.c_str()); // 创建日志消息
+            msg.FormatHead(writer);
+            writer.AppendV(format, va);
+            serialize(level, writer);
+        }
+        // 按记录格式写出整条记录(不含换行)
+        void FormatLine(FixedWriter &writer, const LogMessage &msg, const Field *fields, size_t count)
+        {
+            if (layout_ == RecordLayout::JSON)
+                msg.FormatJson(writer, fields, count);
+            else
+                msg.FormatText(writer, fields, count);
+        }
+        // 写入一条信息体已确定的记录：需要远程备份或包装成二进制记录的先写线程局部缓冲区，
+        // 其余按长度上界在工作器缓冲区中预留空间直接写进去
+        void Emit(const LogMessage &msg, const Field *fields, size_t count)
+        {
+            if (binary_mode_ != BinaryMode::OFF ||
+                msg.level_ == LogLevel::value::ERROR || msg.level_ == LogLevel::value::FATAL)
+            {
+                FixedWriter writer(LineBuffer(), kMaxLineSize - 1);
+                FormatLine(writer, msg, fields, count);
+                return serialize(msg.level_, writer);
+            }
+            size_t bound = std::min(msg.MaxRecordSize(fields, count) + 1, kMaxLineSize);
+            auto slot = Worker().Reserve(bound, msg.level_);
+            FixedWriter writer(slot.Data(), bound - 1);
+            FormatLine(writer, msg, fields, count);
+            FinishLine(writer);
+            slot.Commit(writer.Size() + 1);
+        }
+        // 在这里将格式化好的日志补上换行，并写入异步缓冲区
+        void serialize(LogLevel::value level, FixedWriter &writer)
+        {
+            const char *data = FinishLine(writer);
+            size_t len = writer.Size() + 1;
+            Backup(level, data, len);
+            // 获取到日志信息后就可以输出到异步缓冲区了，异步工作器后续会对其进行刷盘
+            if (binary_mode_ == BinaryMode::OFF)
+                Flush(data, len, level);
+            else
+            {
+                // 二进制模式下已格式化的文本也包装成记录，保证缓冲区里只有一种格式
+                FixedWriter record(RecordBuffer(), kMaxLineSize);
+                EncodeText(record, data, len);
+                Flush(record.Data(), record.Size(), level);
+            }
+            SyncUrgent(level);
+        }
+        // 错误和致命级别的日志写入后立即请求持久化，不等攒够批量或同步间隔
+        void SyncUrgent(LogLevel::value level)
         {
-            // std::cout << "Debug:serialize begin\n";
-            LogMessage msg(level, file, line, logger_name_, ret); // 创建日志消息
-            std::string data = msg.format();                      // 格式化日志消息
             if (level == LogLevel::value::FATAL ||
                 level == LogLevel::value::ERROR)
+                Worker().RequestSync();
+        }
+        // 错误和致命级别的日志发往远程备份，只进入备份客户端的发送队列，不等待网络
+        void Backup(LogLevel::value level, const char *data, size_t len)
+        {
+            if (level == LogLevel::value::FATAL ||
+                level == LogLevel::value::ERROR)
+                BackupClient::GetInstance().Send(data, len);
+        }
+        // 刷新日志
+        void Flush(const char *data, size_t len, LogLevel::value level)
+        {
+            Worker().Push(data, len, level); // Push函数本身是线程安全的，这里不加锁
+            // 通过 Push() 将日志数据放入 AsyncWorker 内部的 Buffer，由异步线程写入
+        }
+        // 0号分片的后台线程调用：距上次汇总超过 drop_report_interval_ms 且期间有日志被溢出策略丢弃时，
+        // 在这批日志之前写一行 WARN 汇总所有分片的丢弃；force 为真时不看间隔，后台线程停止后由析构调用
+        void ReportDrops(bool force = false)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (!force && now - last_report_ < std::chrono::milliseconds(g_conf_data->drop_report_interval_ms))
+                return;
+            DropStats stats = GetDropStats();
+            if (stats.Total() == reported_.Total())
+                return;
+            FixedWriter text(MessageBuffer(), kMaxLineSize);
+            text.AppendNumber(stats.Total() - reported_.Total());
+            text.Append(" messages dropped in the last ");
+            text.AppendNumber(std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report_).count());
+            text.Append("ms (drop_newest=");
+            text.AppendNumber(stats.dropped_newest - reported_.dropped_newest);
+            text.Append(", drop_oldest=");
+            text.AppendNumber(stats.dropped_oldest - reported_.dropped_oldest);
+            text.Append(", sampled_out=");
+            text.AppendNumber(stats.sampled_out - reported_.sampled_out);
+            text.Append(')');
+            last_report_ = now;
+            reported_ = stats;
+            WriteInternal(LogMessage(LogLevel::value::WARN, __FILE__, __LINE__, logger_name_.c_str(),
+                                     std::string_view(text.Data(), text.Size())),
+                          nullptr, 0);
+        }
+        // 0号分片的后台线程调用：登记过的限流、折叠调用点在窗口或间隔过去后还有没汇报的条数时，
+        // 以该调用点的级别和文件行号补写一行；仍在活跃的调用点等它安静下来时再检查。
+        // force 为真时全部写出并解除登记，后台线程停止后由析构调用
+        void ReportThrottled(bool force = false)
+        {
+            std::vector<std::pair<ThrottleSite *, uint64_t>> pending;
+            uint64_t wake = UINT64_MAX;
             {
-                try
+                std::unique_lock<std::mutex> lock(throttle_mtx_);
+                uint64_t now = Util::Date::CoarseMs();
+                for (auto throttle : throttled_)
                 {
-                    auto ret = tp->enqueue(start_backup, data); // 将日志消息加入到线程池中
-                    ret.get();                                  // 等待任务完成
+                    if (!force && now < throttle->IdleAt())
+                    {
+                        wake = std::min(wake, throttle->IdleAt());
+                        continue;
+                    }
+                    if (uint64_t count = throttle->TakeUnreported())
+                        pending.emplace_back(throttle, count);
                 }
-                catch (const std::runtime_error &e)
+                if (force)
                 {
-                    // 该线程池没有把stop设置为true的逻辑，所以不做处理
-                    std::cout << __FILE__ << __LINE__ << "thread pool closed" << std::endl;
+                    for (auto throttle : throttled_)
+                        throttle->Release(this);
+                    throttled_.clear();
                 }
             }
-            // 获取到string类型的日志信息后就可以输出到异步缓冲区了，异步工作器后续会对其进行刷盘
-            Flush(data.c_str(), data.size());
-
-            // std::cout << "Debug:serialize Flush\n";
+            for (auto &p : pending)
+            {
+                const LogSite &site = *p.first->Site();
+                char buf[64];
+                FixedWriter text(buf, sizeof(buf));
+                WriteInternal(LogMessage(site.level, site.file, site.line, logger_name_.c_str(),
+                                         SuppressedText(text, p.second, p.first->Repeat())),
+                              nullptr, 0);
+            }
+            if (wake != UINT64_MAX)
+                WakeForReport(wake);
         }
-        // 刷新日志
-        void Flush(const char *data, size_t len)
+        // 0号分片的后台线程调用：每隔 metrics_report_interval_ms 写一行这段时间的运行指标，为0时不写。
+        // 这段时间内生产者等待过或有日志被丢弃时为 WARN，说明日志系统成了瓶颈，否则为 INFO
+        void ReportMetrics(bool force = false)
         {
-            asyncworker->Push(data, len); // Push函数本身是线程安全的，这里不加锁
-            // 通过 Push() 将日志数据放入 AsyncWorker 内部的 Buffer，由异步线程写入
+            size_t interval_ms = g_conf_data->metrics_report_interval_ms;
+            auto now = std::chrono::steady_clock::now();
+            if (interval_ms == 0 || (!force && now - last_metrics_ < std::chrono::milliseconds(interval_ms)))
+                return;
+            MetricsSnapshot cur = GetMetrics();
+            MetricsSnapshot &prev = reported_metrics_;
+            if (force && cur.messages == prev.messages)
+                return;
+            uint64_t elapsed_ms = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(now - last_metrics_).count());
+            HistogramSnapshot wait = cur.producer_wait.Since(prev.producer_wait);
+            HistogramSnapshot sync = cur.sync.Since(prev.sync);
+            uint64_t dropped = cur.dropped - prev.dropped + cur.sink_dropped_batches - prev.sink_dropped_batches;
+            std::vector<Field> fields{
+                KV("interval_ms", elapsed_ms),
+                KV("messages", cur.messages - prev.messages),
+                KV("bytes", cur.bytes - prev.bytes),
+                KV("msgs_per_s", (cur.messages - prev.messages) * 1000 / elapsed_ms),
+                KV("swaps", cur.swaps - prev.swaps),
+                KV("high_water_bytes", cur.high_water_bytes),
+                KV("producer_waits", wait.count),
+                KV("producer_wait_p99_us", wait.PercentileNs(99) / 1000),
+                KV("sync_p99_us", sync.PercentileNs(99) / 1000),
+                KV("dropped", dropped)};
+            if (sink_keys_.empty())
+                for (size_t i = 0; i < flushs_.size(); ++i)
+                    sink_keys_.push_back("sink" + std::to_string(i) + "_flush_p99_us");
+            for (size_t i = 0; i < flushs_.size(); ++i)
+                fields.push_back(KV(sink_keys_[i], cur.sink_flush[i].Since(prev.sink_flush[i]).PercentileNs(99) / 1000));
+            last_metrics_ = now;
+            reported_metrics_ = std::move(cur);
+            LogLevel::value level = wait.count || dropped ? LogLevel::value::WARN : LogLevel::value::INFO;
+            WriteInternal(LogMessage(level, __FILE__, __LINE__, logger_name_.c_str(), "logger metrics"),
+                          fields.data(), fields.size());
         }
-        // 实际写文件
-        void RealFlush(Buffer &buffer)
+        // 日志系统自己的记录(丢弃汇总、运行指标)，在后台线程中不经过缓冲区直接写给各落地方向
+        void WriteInternal(const LogMessage &msg, const Field *fields, size_t count)
+        {
+            FixedWriter writer(LineBuffer(), kMaxLineSize - 1);
+            FormatLine(writer, msg, fields, count);
+            const char *data = FinishLine(writer);
+            size_t len = writer.Size() + 1;
+            FixedWriter record(RecordBuffer(), kMaxLineSize);
+            if (binary_mode_ == BinaryMode::RAW)
+            { // 原样写出二进制记录时，汇总行也包装成记录
+                EncodeText(record, data, len);
+                data = record.Data();
+                len = record.Size();
+            }
+            SinkWorker::Data shared;
+            for (size_t i = 0; i < flushs_.size(); ++i)
+            {
+                if (!sinks_[i])
+                    CallSink(i, [&]()
+                             { flushs_[i]->Flush(data, len); });
+                else
+                {
+                    if (!shared)
+                        shared = std::make_shared<SinkData>(std::string(data, len));
+                    sinks_[i]->Submit(shared, 0);
+                }
+            }
+        }
+        // 实际写文件，shard 为回调的分片
+        void RealFlush(size_t shard, Buffer &buffer)
         {
             if (flushs_.empty())
                 return;
-            for (auto &e : flushs_)
+            if (shard == 0)
+            {
+                ReportDrops();
+                ReportThrottled();
+                ReportMetrics();
+            }
+            if (buffer.IsEmpty() && !buffer.SyncSeq())
+                return; // 只是为补写汇总而醒来，见 WakeForReport
+            // 缓冲区是一串块，每条记录都在同一块内，逐块解码或交给 writev
+            ShardState &state = *states_[shard];
+            state.iov.clear();
+            state.decoded.clear();
+            if (binary_mode_ == BinaryMode::BACKEND)
+            { // 在后台线程把二进制记录格式化成文本
+                buffer.ForEach([&](const char *data, size_t n)
+                               { state.decoder.Decode(data, n, &state.decoded); });
+                if (!state.decoded.empty())
+                    state.iov.push_back(iovec{&state.decoded[0], state.decoded.size()});
+            }
+            else
+            {
+                if (binary_mode_ == BinaryMode::RAW)
+                { // 第一次出现的调用点先写出定义，离线解码时才能还原
+                    buffer.ForEach([&](const char *data, size_t n)
+                                   { state.decoder.CollectDefines(data, n, &state.decoded); });
+                    if (!state.decoded.empty())
+                    {
+                        state.iov.push_back(iovec{&state.decoded[0], state.decoded.size()});
+                        std::unique_lock<std::mutex> lock(defines_->mtx);
+                        defines_->data.append(state.decoded);
+                    }
+                }
+                buffer.ToIovec(&state.iov);
+            }
+            // 有独立线程的方向时，这批数据(解码结果和缓冲区的块)整体移交给一份共用的只读数据，
+            // 不复制，各方向写完才还回块池；本线程直接写的方向也改从它写出
+            const std::vector<struct iovec> *iov = &state.iov;
+            SinkWorker::Data shared;
+            if (!state.iov.empty() && std::any_of(sinks_.begin(), sinks_.end(), [](const SinkWorker::ptr &s)
+                                                  { return s != nullptr; }))
+            {
+                shared = std::make_shared<SinkData>(std::move(state.decoded),
+                                                    binary_mode_ == BinaryMode::BACKEND ? nullptr : &buffer,
+                                                    binary_mode_ == BinaryMode::RAW);
+                state.decoded.clear();
+                iov = &shared->Iov();
+            }
+            for (size_t i = 0; i < flushs_.size(); ++i)
             { // e是Flush这个类，即控制把日志输出到哪的类。
-                e->Flush(buffer.Begin(), buffer.ReadableSize());
+                if (sinks_[i])
+                    sinks_[i]->Submit(shared, buffer.SyncSeq(), shard);
+                else if (!iov->empty())
+                    CallSink(i, [&]()
+                             {
+                                 auto begin = std::chrono::steady_clock::now();
+                                 flushs_[i]->FlushV(iov->data(), iov->size());
+                                 metrics_->SinkFlush(i).RecordSince(begin); });
             }
+            // 这批数据带有持久化序号，回调返回前同步到存储，独立线程的方向写出后各自同步
+            if (buffer.SyncSeq())
+                for (size_t i = 0; i < flushs_.size(); ++i)
+                    if (!sinks_[i])
+                        CallSink(i, [&]()
+                                 {
+                                     auto begin = std::chrono::steady_clock::now();
+                                     flushs_[i]->Sync();
+                                     if (sync_latency_[i])
+                                         sync_latency_[i]->RecordSince(begin); });
         }
 
     protected:
@@ -171,7 +757,23 @@ namespace mylog
         std::string logger_name_;            // 日志器名称
         std::vector<LogFlush::ptr> flushs_;  // 输出到指定方向\
     std::vector<LogFlush> flush_;不能使用logflush作为元素类型，logflush是纯虚类，不能实例化
-        mylog::AsyncWorker::ptr asyncworker; // 异步工作器
+        std::atomic<int> level_;             // 最低日志等级
+        BinaryMode binary_mode_;             // 编码方式
+        RecordLayout layout_;                // 记录格式
+        std::chrono::steady_clock::time_point last_report_; // 以下两个仅0号分片的后台线程访问：上次写丢弃汇总的时间
+        DropStats reported_;                 // 上次汇总时的丢弃计数
+        std::chrono::steady_clock::time_point last_metrics_; // 以下两个仅0号分片的后台线程访问：上次写运行指标的时间
+        LoggerMetrics::ptr metrics_;         // 运行指标，各分片的工作器和独立线程的落地方向共用
+        MetricsSnapshot reported_metrics_;   // 上次写运行指标时的快照
+        std::vector<std::string> sink_keys_; // 运行指标中各落地方向的字段名
+        std::mutex throttle_mtx_;            // 保护 throttled_
+        std::vector<ThrottleSite *> throttled_; // 登记到本日志器的限流、折叠调用点，见 Watch
+        std::shared_ptr<Defines> defines_;   // 落地方向换新文件时重写一遍，见 LogFlush::SetPrologue
+        std::vector<Histogram *> sync_latency_; // 与 flushs_ 对应，由日志器记录 Sync 调用耗时的方向不为空
+        std::vector<std::unique_ptr<std::mutex>> sink_locks_; // 与 flushs_ 对应，多个分片时不能同时调用的方向不为空
+        std::vector<SinkWorker::ptr> sinks_; // 与 flushs_ 对应，有独立线程的方向不为空，必须在异步工作器之前构造、之后析构
+        std::vector<std::unique_ptr<ShardState>> states_; // 各分片后台线程的状态
+        std::vector<mylog::AsyncWorker::ptr> workers_; // 异步工作器，每个分片一个
     };
 
     // 日志器建造
@@ -182,12 +784,41 @@ namespace mylog
         using ptr = std::shared_ptr<LoggerBuilder>;
         void BuildLoggerName(const std::string &name) { logger_name_ = name; }
         void BuildLopperType(AsyncType type) { async_type_ = type; }
+        void BuildBinaryMode(BinaryMode mode) { binary_mode_ = mode; }
+        // 记录格式，默认为文本，JSON 为每行一个对象，便于分析系统直接解析
+        void BuildRecordLayout(RecordLayout layout) { layout_ = layout; }
+        // 指定最低日志等级，不指定则使用配置文件中的 log_level
+        void BuildLoggerLevel(LogLevel::value level)
+        {
+            level_ = level;
+            level_set_ = true;
+        }
         // 添加日志输出方式
         template <typename FlushType, typename... Args>
         void BuildLoggerFlush(Args &&...args)
         {
             flushs_.emplace_back(
                 LogFlushFactory::CreateLog<FlushType>(std::forward<Args>(args)...));
+            policies_.push_back(SinkPolicy::INLINE);
+        }
+        // 分片个数，大于1时用多个后台线程同时写，同一生产者线程的日志保持顺序；
+        // 落地方向不支持同时调用(Concurrent)的会加锁，文件输出可用 SharedFileFlush 免锁
+        void BuildShards(size_t shards) { shards_ = shards; }
+        // 不创建自己的后台线程，交给共享后台处理，默认为线程数 backend_threads 的全局共享后台
+        void BuildSharedBackend(LogBackend::ptr backend = LogBackend::GetInstance()) { backend_ = backend; }
+        // 有日志时最多等待多少毫秒就写出，不指定则使用配置文件中的 flush_interval_ms
+        void BuildFlushInterval(size_t ms)
+        {
+            flush_interval_ms_ = ms;
+            flush_interval_set_ = true;
+        }
+        // 缓冲区写满时的处理方式，默认 BLOCK 即按异步类型阻塞或增长
+        void BuildOverloadPolicy(OverloadPolicy policy) { overload_ = policy; }
+        // 为最近添加的日志输出方式指定执行方式，BLOCK/DROP/DEGRADE 时该方向使用独立线程和有界队列
+        void BuildSinkPolicy(SinkPolicy policy)
+        {
+            assert(!policies_.empty()); // 先添加输出方式
+            policies_.back() = policy;
         }
         // 构建日志器
         AsyncLogger::ptr Build()
@@ -196,14 +827,32 @@ namespace mylog
 
             // 如果写日志方式没有指定，那么采用默认的标准输出
             if (flushs_.empty())
+            {
                 flushs_.emplace_back(std::make_shared<StdoutFlush>());
-            return std::make_shared<AsyncLogger>(
-                logger_name_, flushs_, async_type_);
+                policies_.push_back(SinkPolicy::INLINE);
+            }
+            auto logger = std::make_shared<AsyncLogger>(
+                logger_name_, flushs_, async_type_, binary_mode_, policies_, overload_, shards_, backend_, layout_);
+            if (level_set_)
+                logger->SetLevel(level_);
+            if (flush_interval_set_)
+                logger->SetFlushInterval(flush_interval_ms_);
+            return logger;
         }
 
     protected:
         std::string logger_name_ = "async_logger";     // 日志器名称
         std::vector<mylog::LogFlush::ptr> flushs_;     // 写日志方式
+        std::vector<SinkPolicy> policies_;             // 与 flushs_ 对应的执行方式
         AsyncType async_type_ = AsyncType::ASYNC_SAFE; // 用于控制缓冲区是否增长
+        OverloadPolicy overload_ = OverloadPolicy::BLOCK; // 缓冲区写满时的处理方式
+        size_t shards_ = 1;                            // 分片个数
+        LogBackend::ptr backend_;                      // 共享后台，为空时自带线程
+        size_t flush_interval_ms_ = 0;                 // 有日志时最多等待的毫秒数
+        bool flush_interval_set_ = false;              // 是否指定过
+        BinaryMode binary_mode_ = BinaryMode::OFF;     // 编码方式
+        RecordLayout layout_ = RecordLayout::TEXT;     // 记录格式
+        LogLevel::value level_ = LogLevel::value::DEBUG; // 最低日志等级
+        bool level_set_ = false;                       // 是否指定过最低日志等级
     };
 } // namespace mylog
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <iostream>
@@ -7,90 +9,647 @@
 #include <thread>
 
 #include "AsyncBuffer.hpp"
+#include "Level.hpp"
+#include "LogBackend.hpp"
+#include "Metrics.hpp"
+#include "RingBuffer.hpp"
+#include "StagingBuffer.hpp"
 
 namespace mylog
 {
     enum class AsyncType
     {
-        ASYNC_SAFE,
-        ASYNC_UNSAFE
+        ASYNC_SAFE,    // 固定大小双缓冲区，写满时生产者阻塞
+        ASYNC_UNSAFE,  // 双缓冲区无限增长
+        ASYNC_LOCKFREE, // 无锁MPSC环形缓冲区，写满时生产者自旋等待
+        ASYNC_STAGED    // 每个生产者线程独享SPSC暂存缓冲区，后台按时间戳归并
     }; // 异步类型
 
+    // 缓冲区写满时的处理方式，BLOCK 以外的策略都不会阻塞生产者，缓冲区不超过 buffer_size
+    enum class OverloadPolicy
+    {
+        BLOCK,       // 由异步类型决定：ASYNC_SAFE 阻塞，ASYNC_UNSAFE 无限增长，无锁模式自旋等待
+        DROP_NEWEST, // 丢弃新写入的日志
+        DROP_OLDEST, // 丢弃最早的一批还没处理的日志(生产者缓冲区中的全部日志)，无锁模式下同 DROP_NEWEST
+        SAMPLE       // 用量过半时 DEBUG/INFO 按 1/sample_rate 抽样保留，写满时丢弃新日志；
+                     // ERROR/FATAL 总是保留，写满时允许超出到两倍上限，无锁模式下改写入加锁的缓冲区
+    };
+
+    // 各策略丢弃的日志条数，只增不减
+    struct DropStats
+    {
+        uint64_t dropped_newest; // 写满时丢弃的新日志
+        uint64_t dropped_oldest; // 为新日志腾出空间丢弃的旧日志
+        uint64_t sampled_out;    // 抽样时未被选中的日志
+        uint64_t Total() const { return dropped_newest + dropped_oldest + sampled_out; }
+    };
+
     using functor = std::function<void(Buffer &)>; // 回调函数类型
     // using 用于 定义类型别名（类似 typedef）
     // std::function 是 C++11 引入的 可调用对象封装器，用于存储 函数指针、Lambda 表达式、仿函数（Functor）等可调用对象
     // std::function<void(Buffer &)> 代表一个 可调用对象类型
 
-    class AsyncWorker
+    // 默认自带一个后台线程；指定共享后台(LogBackend)时不创建线程，由后台的线程池轮流处理
+    class AsyncWorker : public BackendTask
     {
     public:
         using ptr = std::shared_ptr<AsyncWorker>; // 智能指针类型
 
-        AsyncWorker(const functor &cb, AsyncType async_type = AsyncType::ASYNC_SAFE)
+        // sync_counter 为同一日志器的多个分片共用的持久化请求序号，为空时独立计数；
+        // backend 为共享后台，为空时自带线程；metrics 为日志器的运行指标，分片之间共用，为空时单独统计
+        AsyncWorker(const functor &cb, AsyncType async_type = AsyncType::ASYNC_SAFE,
+                    OverloadPolicy policy = OverloadPolicy::BLOCK,
+                    std::shared_ptr<std::atomic<uint64_t>> sync_counter = nullptr,
+                    LogBackend::ptr backend = nullptr, LoggerMetrics::ptr metrics = nullptr)
             : async_type_(async_type),
-              callback_(cb),
+              policy_(policy),
+              capacity_(g_conf_data->buffer_size),
+              sample_rate_(g_conf_data->sample_rate),
+              records_(0),
+              dropped_newest_(0),
+              dropped_oldest_(0),
+              sampled_out_(0),
               stop_(false),
-              thread_(std::thread(&AsyncWorker::ThreadEntry, this)) {}
+              urgent_(false),
+              wait_state_(kRunning),
+              pending_(0),
+              flush_bytes_(g_conf_data->flush_bytes),
+              flush_interval_ms_(g_conf_data->flush_interval_ms),
+              spin_count_(g_conf_data->consumer_spin),
+              sync_requested_(sync_counter ? sync_counter : std::make_shared<std::atomic<uint64_t>>(0)),
+              synced_(0),
+              report_at_(kNever),
+              idle_sync_(g_conf_data->flush_log == 2),
+              sync_interval_(std::chrono::milliseconds(g_conf_data->sync_interval_ms)),
+              dirty_(false),
+              metrics_(metrics ? metrics : std::make_shared<LoggerMetrics>(0)),
+              ring_(async_type == AsyncType::ASYNC_LOCKFREE
+                        ? new RingBuffer(g_conf_data->ring_size)
+                        : nullptr),
+              staging_(async_type == AsyncType::ASYNC_STAGED
+                           ? new StagingRegistry(g_conf_data->staging_size)
+                           : nullptr),
+              batch_deadline_(std::chrono::steady_clock::time_point::max()),
+              detached_(false),
+              callback_(cb),
+              backend_(backend),
+              thread_(backend ? std::thread() : std::thread(&AsyncWorker::ThreadEntry, this))
+        {
+            if (backend_)
+            {
+                wait_state_.store(kIdleWait); // 挂起状态开始，第一条数据到来时通知后台
+                backend_->Attach(this);
+            }
+        }
         // 创建并启动一个新的线程，线程执行 AsyncWorker 类的 ThreadEntry 成员函数
         // this：绑定当前对象，使 ThreadEntry 在 this 指向的对象上执行
         ~AsyncWorker() { Stop(); }
-        // 写入数据
-        void Push(const char *data, size_t len)
+        // 生产者的写入槽：指向工作器缓冲区中预留好的空间，生产者直接在里面格式化，
+        // 写完后调用 Commit 提交实际长度。加锁的双缓冲区模式下槽持有锁直到提交，
+        // 因此预留到提交之间不能做耗时操作
+        class WriteSlot
         {
+        public:
+            WriteSlot(WriteSlot &&other)
+                : worker_(other.worker_), data_(other.data_), ring_(other.ring_),
+                  staged_(other.staged_), discard_(other.discard_), lock_(std::move(other.lock_))
+            {
+                other.worker_ = nullptr;
+            }
+            ~WriteSlot()
+            {
+                if (worker_)
+                    Commit(0);
+            }
+            char *Data() { return data_; }
+            void Commit(size_t len)
+            {
+                AsyncWorker *worker = worker_;
+                worker_ = nullptr;
+                if (discard_) // 按溢出策略丢弃，写进的是线程局部的暂存区
+                    return;
+                if (len)
+                    worker->metrics_->Written(len);
+                if (lock_.owns_lock())
+                {
+                    worker->buffer_productor_.Commit(len);
+                    if (len)
+                        ++worker->records_;
+                    size_t pending = worker->buffer_productor_.ReadableSize();
+                    worker->pending_.store(pending, std::memory_order_relaxed);
+                    if (worker->ShouldWake(pending))
+                        worker->NotifyConsumer(); // 持有锁，直接通知消费者线程
+                    lock_.unlock();
+                    return;
+                }
+                if (staged_)
+                    StagingRegistry::Commit(ring_, data_, len);
+                else
+                    ring_->Commit(data_, len);
+                // 与消费者设置等待状态后的检查配对，保证两边至少有一方看到对方
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (worker->ShouldWake(ring_->Size()))
+                    worker->WakeConsumer();
+            }
+
+        private:
+            friend class AsyncWorker;
+            WriteSlot(AsyncWorker *worker) : worker_(worker), data_(nullptr), ring_(nullptr), staged_(false), discard_(false) {}
+            AsyncWorker *worker_;
+            char *data_;
+            RingBuffer *ring_;
+            bool staged_;
+            bool discard_; // 被溢出策略丢弃
+            std::unique_lock<std::mutex> lock_;
+        };
+
+        // 预留 len 字节，返回写入槽；空间不足时按溢出策略处理，BLOCK 策略下
+        // ASYNC_SAFE 阻塞，无锁模式下自旋等待。level 用于抽样和保留重要日志
+        WriteSlot Reserve(size_t len, LogLevel::value level = LogLevel::value::INFO)
+        {
+            WriteSlot slot(this);
+            bool important = level == LogLevel::value::ERROR || level == LogLevel::value::FATAL;
+            bool sampled = policy_ == OverloadPolicy::SAMPLE && level <= LogLevel::value::INFO;
+            bool keep = policy_ == OverloadPolicy::SAMPLE && important; // 写满时也不丢弃
+            if (ring_ && len <= ring_->MaxPayload())
+            {
+                if (sampled && ring_->Size() > ring_->Capacity() / 2 && !KeepSample())
+                    return Discard(slot, len, &sampled_out_);
+                if ((slot.data_ = ring_->TryReserve(len)) == nullptr)
+                {
+                    auto begin = std::chrono::steady_clock::now();
+                    do
+                    {
+                        RequestFlush();
+                        if (policy_ != OverloadPolicy::BLOCK)
+                            break;
+                        std::this_thread::yield();
+                    } while ((slot.data_ = ring_->TryReserve(len)) == nullptr);
+                    if (policy_ == OverloadPolicy::BLOCK)
+                        metrics_->ProducerWait().RecordSince(begin);
+                }
+                if (slot.data_)
+                {
+                    slot.ring_ = ring_.get();
+                    return slot;
+                }
+                if (!keep)
+                    return Discard(slot, len, &dropped_newest_);
+                // 重要日志改写入加锁的生产者缓冲区，后台线程会一并取走
+            }
+            else if (staging_ && len <= staging_->MaxPayload())
+            {
+                if ((slot.data_ = staging_->TryReserve(len, &slot.ring_)) == nullptr)
+                {
+                    auto begin = std::chrono::steady_clock::now();
+                    do
+                    {
+                        RequestFlush();
+                        if (policy_ != OverloadPolicy::BLOCK)
+                            break;
+                        std::this_thread::yield();
+                    } while ((slot.data_ = staging_->TryReserve(len, &slot.ring_)) == nullptr);
+                    if (policy_ == OverloadPolicy::BLOCK)
+                        metrics_->ProducerWait().RecordSince(begin);
+                }
+                if (slot.data_)
+                {
+                    slot.staged_ = true;
+                    return slot;
+                }
+                if (!keep)
+                    return Discard(slot, len, &dropped_newest_);
+            }
+            slot.lock_ = std::unique_lock<std::mutex>(mtx_);
+            if (policy_ != OverloadPolicy::BLOCK)
+            {
+                // 不阻塞的策略，生产者缓冲区最多 buffer_size 字节
+                size_t used = buffer_productor_.ReadableSize();
+                if (sampled && used > capacity_ / 2 && !KeepSample())
+                {
+                    slot.lock_.unlock();
+                    return Discard(slot, len, &sampled_out_);
+                }
+                // 重要日志可以超出到两倍上限，再满时才丢弃最早的一批
+                if (used > 0 && used + len > (keep ? 2 * capacity_ : capacity_))
+                {
+                    urgent_ = true;
+                    NotifyConsumer();
+                    if (policy_ == OverloadPolicy::DROP_NEWEST || (policy_ == OverloadPolicy::SAMPLE && !keep))
+                    {
+                        slot.lock_.unlock();
+                        return Discard(slot, len, &dropped_newest_);
+                    }
+                    dropped_oldest_ += records_;
+                    records_ = 0;
+                    buffer_productor_.Reset();
+                    pending_.store(0, std::memory_order_relaxed);
+                }
+            }
             // 如果生产者队列不足以写下len长度数据，并且缓冲区是固定大小，那么阻塞
-            std::unique_lock<std::mutex> lock(mtx_);
-            if (AsyncType::ASYNC_SAFE == async_type_) // 冲区固定大小（ASYNC_SAFE）
-                cond_productor_.wait(lock, [&]()
+            else if (AsyncType::ASYNC_SAFE == async_type_ && len > buffer_productor_.WriteableSize())
+            {
+                // 缓冲区写满了，不等攒够批量或超时，让消费者立即取走
+                urgent_ = true;
+                NotifyConsumer();
+                auto begin = std::chrono::steady_clock::now();
+                cond_productor_.wait(slot.lock_, [&]()
                                      { return len <= buffer_productor_.WriteableSize(); });
-            buffer_productor_.Push(data, len); // 写入数据
-            cond_consumer_.notify_one();       // 通知消费者线程
+                metrics_->ProducerWait().RecordSince(begin);
+            }
+            slot.data_ = buffer_productor_.Reserve(len);
+            return slot;
+        }
+        // 写入数据
+        void Push(const char *data, size_t len, LogLevel::value level = LogLevel::value::INFO)
+        {
+            WriteSlot slot = Reserve(len, level);
+            memcpy(slot.Data(), data, len);
+            slot.Commit(len);
+        }
+        // 请求持久化，不等待：返回一个序号，代表调用之前已提交的全部数据。
+        // 后台线程立即取走这些数据，交给回调时附带该序号要求同步到磁盘，回调返回后已同步序号推进到它
+        uint64_t RequestSync()
+        {
+            uint64_t seq = sync_requested_->fetch_add(1) + 1;
+            RequestFlush();
+            return seq;
+        }
+        // 要求消费者立即处理，不等攒够批量或超时：缓冲区写满，或者同一日志器的其他分片发出了持久化请求
+        void RequestFlush()
+        {
+            urgent_ = true;
+            if (wait_state_.load() != kRunning)
+                WakeConsumer();
+        }
+        DropStats GetDropStats()
+        {
+            return DropStats{dropped_newest_.load(), dropped_oldest_.load(), sampled_out_.load()};
+        }
+        // 已同步序号，该序号之前请求的数据都已落盘
+        uint64_t SyncedSeq() { return synced_.load(); }
+        // 等待序号 seq 之前的数据都已落盘，timeout_ms 小于0时一直等待，超时或工作器已停止返回 false
+        bool WaitSynced(uint64_t seq, int timeout_ms = -1)
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            auto done = [&]()
+            { return synced_.load() >= seq || stop_; };
+            if (timeout_ms < 0)
+                cond_synced_.wait(lock, done);
+            else
+                cond_synced_.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
+            return synced_.load() >= seq;
         }
-        // 停止
+        // 停止，可以重复调用
         void Stop()
         {
-            stop_ = true;                // 设置停止标志
+            if (backend_ ? detached_ : !thread_.joinable())
+                return;
+            if (idle_sync_)
+                RequestSync(); // 退出前把写过的数据同步一次
+            {
+                // 加锁设置，防止消费者检查完条件、还没进入等待时错过通知
+                std::unique_lock<std::mutex> lock(mtx_);
+                stop_ = true; // 设置停止标志
+            }
+            if (backend_)
+            {
+                backend_->Detach(this); // 共享后台把剩余数据处理完才会摘下
+                detached_ = true;
+                return;
+            }
             cond_consumer_.notify_all(); // 所有线程把缓冲区内数据处理完就结束了
             thread_.join();              // 等待线程结束
         }
+        // 有数据时最多等待多少毫秒就处理，默认为 flush_interval_ms
+        void SetFlushInterval(size_t ms) { flush_interval_ms_.store(ms, std::memory_order_relaxed); }
+        // 到 when 时即使没有数据也调用一次回调(缓冲区为空)，让日志器在后台线程补写汇总；
+        // 已有更早的时间时保留更早的，回调里可以再次调用
+        void WakeAt(std::chrono::steady_clock::time_point when)
+        {
+            int64_t at = when.time_since_epoch().count();
+            int64_t cur = report_at_.load();
+            while (at < cur && !report_at_.compare_exchange_weak(cur, at))
+            {
+            }
+            if (at < cur && wait_state_.load() != kRunning)
+                WakeConsumer(); // 休眠中的消费者按新的时间重新等待
+        }
+
+        // 以下两个由共享后台的线程调用，同一时间只有一个线程
+        bool RunBatch() override
+        {
+            wait_state_.store(kRunning);
+            auto now = std::chrono::steady_clock::now();
+            if (PendingBytes() == 0 && dirty_ && idle_sync_ && now >= last_batch_ + sync_interval_)
+                sync_requested_->fetch_add(1); // 空闲前写过的数据到期主动同步，同 WaitForBatch
+            if (!BatchReady() && (PendingBytes() == 0 || now < batch_deadline_) && now < ReportAt())
+                return false; // 还没到处理的时候，由 Park 设置截止时间
+            batch_deadline_ = std::chrono::steady_clock::time_point::max();
+            return ProcessBatch();
+        }
+        bool Park(std::chrono::steady_clock::time_point *deadline) override
+        {
+            bool idle = PendingBytes() == 0;
+            wait_state_.store(idle ? kIdleWait : kTimedWait);
+            // 与生产者提交后的检查配对，见 WriteSlot::Commit
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // 停止后处理完剩余数据和持久化请求就可以挂起，等待摘下
+            bool ready = stop_ ? !idle || SyncPending() : BatchReady();
+            if (ready)
+            {
+                wait_state_.store(kRunning);
+                return false;
+            }
+            if (idle)
+            {
+                batch_deadline_ = std::chrono::steady_clock::time_point::max();
+                if (!stop_)
+                    *deadline = ReportAt();
+                if (dirty_ && idle_sync_ && !stop_)
+                    *deadline = std::min(*deadline, last_batch_ + sync_interval_);
+                return true;
+            }
+            // 从空闲到有数据，最大延迟从这时开始计算
+            if (batch_deadline_ == std::chrono::steady_clock::time_point::max())
+                batch_deadline_ = std::chrono::steady_clock::now() + FlushInterval();
+            *deadline = batch_deadline_;
+            return true;
+        }
 
     private:
+        // 消费者的等待状态
+        enum : int
+        {
+            kRunning = 0,  // 正在处理或自旋，生产者不需要唤醒
+            kIdleWait = 1, // 没有任何数据，无限期休眠，第一条数据到来时唤醒
+            kTimedWait = 2 // 有数据但没攒够批量，休眠到超时，数据量达到阈值时提前唤醒
+        };
+        static constexpr int64_t kNever = INT64_MAX; // report_at_ 未设置
+
+        // 丢弃这条日志：槽指向线程局部的暂存区，生产者照常写入，提交时什么也不做
+        WriteSlot Discard(WriteSlot &slot, size_t len, std::atomic<uint64_t> *counter)
+        {
+            thread_local std::vector<char> scratch;
+            if (scratch.size() < len)
+                scratch.resize(len);
+            counter->fetch_add(1, std::memory_order_relaxed);
+            slot.data_ = scratch.data();
+            slot.discard_ = true;
+            return std::move(slot);
+        }
+        // 以 1/sample_rate 的概率保留
+        bool KeepSample()
+        {
+            thread_local uint64_t x = std::chrono::steady_clock::now().time_since_epoch().count() |
+                                      reinterpret_cast<uintptr_t>(&x);
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            return sample_rate_ <= 1 || x % sample_rate_ == 0;
+        }
+        void WakeConsumer()
+        {
+            if (backend_)
+                return backend_->Notify(this);
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_consumer_.notify_one();
+        }
+        // 已持有 mtx_ 时通知消费者
+        void NotifyConsumer()
+        {
+            if (backend_)
+                backend_->Notify(this);
+            else
+                cond_consumer_.notify_one();
+        }
+        std::chrono::milliseconds FlushInterval()
+        {
+            return std::chrono::milliseconds(flush_interval_ms_.load(std::memory_order_relaxed));
+        }
+        bool SyncPending() { return sync_requested_->load() > synced_.load(std::memory_order_relaxed); }
+        // WakeAt 要求的回调时间，没有时为 time_point::max()
+        std::chrono::steady_clock::time_point ReportAt()
+        {
+            int64_t at = report_at_.load();
+            if (at == kNever)
+                return std::chrono::steady_clock::time_point::max();
+            return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(at));
+        }
+        // 要求的回调时间已到时清除它并返回 true
+        bool TakeReport()
+        {
+            int64_t at = report_at_.load();
+            if (at == kNever || std::chrono::steady_clock::now().time_since_epoch().count() < at)
+                return false;
+            report_at_.compare_exchange_strong(at, kNever);
+            return true;
+        }
+        // 生产者提交后判断是否需要唤醒消费者，多个生产者同时判断时只有一个会去唤醒
+        bool ShouldWake(size_t pending)
+        {
+            int state = wait_state_.load(std::memory_order_relaxed);
+            if (state == kRunning || (state == kTimedWait && pending < flush_bytes_))
+                return false;
+            return wait_state_.exchange(kRunning) != kRunning;
+        }
+        // 待处理的字节数，只在消费者线程调用
+        size_t PendingBytes()
+        {
+            size_t pending = pending_.load(std::memory_order_relaxed);
+            if (ring_)
+                pending += ring_->Size();
+            if (staging_)
+                pending += staging_->Size();
+            return pending;
+        }
+        // 有未完成的持久化请求时也立即处理：请求可能在 urgent_ 被 Collect 清除之前到达，
+        // 分片时也可能来自其他分片
+        bool BatchReady()
+        {
+            return stop_ || urgent_ || PendingBytes() >= flush_bytes_ || SyncPending();
+        }
+        // 自适应等待：数据量达到 flush_bytes 立即返回；先短暂自旋，高负载时不必进入休眠；
+        // 之后有数据则最多等待 flush_interval，没有数据则一直休眠到生产者唤醒，空闲时不占CPU
+        void WaitForBatch()
+        {
+            for (size_t i = 0; i < spin_count_; ++i)
+            {
+                if (BatchReady())
+                    return;
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#else
+                std::this_thread::yield();
+#endif
+            }
+            std::unique_lock<std::mutex> lock(mtx_);
+            auto deadline = std::chrono::steady_clock::now() + FlushInterval();
+            while (true)
+            {
+                bool idle = PendingBytes() == 0;
+                wait_state_.store(idle ? kIdleWait : kTimedWait);
+                // 与生产者提交后的检查配对，见 WriteSlot::Commit
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (BatchReady())
+                    break;
+                if (idle)
+                {
+                    if (PendingBytes() != 0)
+                        continue;
+                    // 空闲前写过的数据还没有同步，最多等一个同步间隔，到期后主动同步一次；
+                    // 日志器要求在某个时间补写汇总时也最多等到那时
+                    auto wake = ReportAt();
+                    bool sync_due = dirty_ && idle_sync_;
+                    if (sync_due)
+                        wake = std::min(wake, last_batch_ + sync_interval_);
+                    if (wake == std::chrono::steady_clock::time_point::max())
+                        cond_consumer_.wait(lock);
+                    else if (cond_consumer_.wait_until(lock, wake) == std::cv_status::timeout)
+                    {
+                        if (sync_due && std::chrono::steady_clock::now() >= last_batch_ + sync_interval_)
+                            sync_requested_->fetch_add(1);
+                        break;
+                    }
+                    // 从空闲中被唤醒，最大延迟从第一条数据到来时开始计算
+                    deadline = std::chrono::steady_clock::now() + FlushInterval();
+                }
+                else if (cond_consumer_.wait_until(lock, deadline) == std::cv_status::timeout)
+                    break;
+            }
+            wait_state_.store(kRunning);
+        }
+        // 把待处理数据收集到消费者缓冲区，返回是否因单次上限还有剩余数据。
+        // sync 为真时通过 complete 返回本次是否取完了调用之前已提交的全部数据，
+        // 无锁模式下可能有更早预留、还没提交的记录挡在前面
+        bool Collect(bool sync, bool *complete)
+        {
+            urgent_ = false;
+            bool more = false;
+            *complete = true;
+            if (ring_ || staging_)
+            {
+                // 无锁模式取出已提交的记录，超长记录走加锁的生产者缓冲区，这里一并取出
+                auto push = [&](const char *data, size_t len)
+                { buffer_consumer_.Push(data, len); };
+                size_t max = g_conf_data->buffer_size;
+                uint64_t target = 0;
+                if (sync && ring_)
+                    target = ring_->WritePos();
+                else if (sync)
+                    staging_->Mark(&marks_);
+                more = (ring_ ? ring_->Consume(push, max) : staging_->Drain(push, max)) >= max;
+                if (sync)
+                    *complete = ring_ ? ring_->ReadPos() >= target : StagingRegistry::Passed(marks_);
+                std::unique_lock<std::mutex> lock(mtx_);
+                buffer_consumer_.Append(buffer_productor_); // 整块接过来，不复制
+                records_ = 0;
+                pending_.store(0, std::memory_order_relaxed);
+                return more;
+            }
+            // 缓冲区交换完就解锁，让productor继续写入数据
+            std::unique_lock<std::mutex> lock(mtx_);
+            buffer_productor_.Swap(buffer_consumer_);
+            records_ = 0;
+            // 生产者缓冲区 buffer_productor_ 和消费者缓冲区 buffer_consumer_ 交换
+            // ，以便释放 buffer_productor_ 让 Push() 继续写入数据
+            pending_.store(0, std::memory_order_relaxed);
+            // 固定容量的缓冲区才需要唤醒，可能有多个生产者在等待
+            if (async_type_ == AsyncType::ASYNC_SAFE)
+                cond_productor_.notify_all();
+            return more;
+        }
         // 线程入口
         void ThreadEntry()
         {
+            bool more = false;
             while (1)
             {
-                { // 缓冲区交换完就解锁，让productor继续写入数据
-                    std::unique_lock<std::mutex> lock(mtx_);
-                    if (buffer_productor_.IsEmpty() && stop_)
-                        // 如果 buffer_productor_ 为空且 stop_ 为 false，阻塞等待
-                        // 有数据则交换，无数据就阻塞
-                        cond_consumer_.wait(lock, [&]()
-                                            { return stop_ || !buffer_productor_.IsEmpty(); });
-                    buffer_productor_.Swap(buffer_consumer_);
-                    // 生产者缓冲区 buffer_productor_ 和消费者缓冲区 buffer_consumer_ 交换
-                    // ，以便释放 buffer_productor_ 让 Push() 继续写入数据
-
-                    // 固定容量的缓冲区才需要唤醒
-                    if (async_type_ == AsyncType::ASYNC_SAFE)
-                        cond_productor_.notify_one();
-                }
+                if (!more)
+                    WaitForBatch();
+                more = ProcessBatch();
+                if (!more && stop_ && PendingBytes() == 0)
+                    return;
+            }
+        }
+        // 收集并处理一批数据，返回是否还有数据需要马上再处理
+        bool ProcessBatch()
+        {
+            // 先读请求的序号再收集数据，保证序号之前提交的数据都在这一批里
+            uint64_t want = sync_requested_->load();
+            bool sync = want > synced_.load(std::memory_order_relaxed);
+            bool complete;
+            bool more = Collect(sync, &complete);
+            if (sync && complete)
+                buffer_consumer_.SetSyncSeq(want);
+            bool written = !buffer_consumer_.IsEmpty();
+            if (written)
+                metrics_->Swapped(buffer_consumer_.ReadableSize());
+            if (written || buffer_consumer_.SyncSeq() || TakeReport())
+            {
                 callback_(buffer_consumer_); // 调用回调函数对缓冲区中数据进行处理
+                if (buffer_consumer_.SyncSeq())
+                {
+                    PublishSynced(want);
+                    dirty_ = false;
+                }
+                else if (written)
+                {
+                    dirty_ = true;
+                    last_batch_ = std::chrono::steady_clock::now();
+                }
                 buffer_consumer_.Reset();
-                if (stop_ && buffer_productor_.IsEmpty())
-                    return;
             }
+            // 单次上限之外还有数据，或者还有在途的记录，马上再取一次
+            return more || (sync && !complete);
+        }
+        // 推进已同步序号并唤醒等待者
+        void PublishSynced(uint64_t seq)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                synced_.store(seq);
+            }
+            cond_synced_.notify_all();
         }
 
     private:
         AsyncType async_type_;                   // 异步类型
+        const OverloadPolicy policy_;            // 缓冲区写满时的处理方式
+        const size_t capacity_;                  // 不阻塞的策略下生产者缓冲区的上限
+        const size_t sample_rate_;               // SAMPLE 策略下 DEBUG/INFO 每 sample_rate 条保留约一条
+        size_t records_;                         // 生产者缓冲区中的日志条数，受 mtx_ 保护
+        std::atomic<uint64_t> dropped_newest_;
+        std::atomic<uint64_t> dropped_oldest_;
+        std::atomic<uint64_t> sampled_out_;
         std::atomic<bool> stop_;                 // 用于控制异步工作器的启动
+        std::atomic<bool> urgent_;               // 缓冲区写满，要求消费者立即处理
+        std::atomic<int> wait_state_;            // 消费者的等待状态，决定生产者是否需要唤醒它
+        std::atomic<size_t> pending_;            // 加锁的生产者缓冲区中待处理的字节数
+        const size_t flush_bytes_;               // 攒够这么多字节就处理一批
+        std::atomic<size_t> flush_interval_ms_;  // 有数据时最多等待这么多毫秒就处理
+        const size_t spin_count_;                // 休眠前的自旋次数
+        std::shared_ptr<std::atomic<uint64_t>> sync_requested_; // 已发出的持久化请求序号，分片之间共用
+        std::atomic<uint64_t> synced_;           // 已同步序号
+        std::atomic<int64_t> report_at_;         // 到这个时间(steady_clock 计数)即使没有数据也回调一次，见 WakeAt
+        const bool idle_sync_;                   // flush_log 为2时，空闲前写过的数据到期主动同步
+        const std::chrono::milliseconds sync_interval_; // 写入后最多这么久同步一次
+        bool dirty_;                             // 以下仅消费者线程访问：写过数据但还没同步
+        std::chrono::steady_clock::time_point last_batch_; // 最近一次写数据的时间
+        std::vector<std::pair<std::shared_ptr<StagingBuffer>, uint64_t>> marks_; // 暂存缓冲区的写位置
+        LoggerMetrics::ptr metrics_;             // 运行指标
         std::mutex mtx_;                         // 互斥锁
         mylog::Buffer buffer_productor_;         // 生产者缓冲区
         mylog::Buffer buffer_consumer_;          // 消费者缓冲区
+        std::unique_ptr<RingBuffer> ring_;       // 无锁环形缓冲区，仅ASYNC_LOCKFREE使用
+        std::unique_ptr<StagingRegistry> staging_; // 线程暂存缓冲区，仅ASYNC_STAGED使用
         std::condition_variable cond_productor_; // 生产者条件变量
         std::condition_variable cond_consumer_;  // 消费者条件变量
-        std::thread thread_;                     // 线程
-
-        functor callback_; // 回调函数，用来告知工作器如何落地
+        std::condition_variable cond_synced_;    // 等待持久化的条件变量
+        std::chrono::steady_clock::time_point batch_deadline_; // 共享后台模式下这批数据最晚的处理时间
+        bool detached_;                          // 已从共享后台摘下
+        functor callback_;                       // 回调函数，用来告知工作器如何落地
+        LogBackend::ptr backend_;                // 共享后台，为空时自带线程
+        std::thread thread_;                     // 线程，必须最后初始化，保证线程启动时其余成员已构造
     };
-} // namespace mylog
\ No newline at end of file
+} // namespace mylog
@@ -0,0 +1,329 @@
+/*二进制延迟格式化日志设计*/
+#pragma once
+#include <pthread.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Format.hpp"
+#include "Level.hpp"
+#include "Message.hpp"
+#include "Util.hpp"
+
+namespace mylog
+{
+    // 日志器的编码方式
+    enum class BinaryMode
+    {
+        OFF,     // 前台线程直接格式化成文本
+        BACKEND, // 前台只记录二进制参数，后台线程格式化成文本后交给落地方向
+        RAW      // 二进制原样落地，由 tools/LogDecoder 离线还原为文本
+    };
+
+    struct LogSite;
+    // 调用点注册表，进程内为每个调用点分配唯一编号，编号从1开始
+    class SiteRegistry
+    {
+    public:
+        static SiteRegistry &GetInstance()
+        {
+            static SiteRegistry registry;
+            return registry;
+        }
+        uint32_t Register(const LogSite *site)
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            sites_.push_back(site);
+            return sites_.size();
+        }
+        const LogSite *Find(uint32_t id)
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (id == 0 || id > sites_.size())
+                return nullptr;
+            return sites_[id - 1];
+        }
+
+    private:
+        SiteRegistry() = default;
+        std::mutex mtx_;
+        std::vector<const LogSite *> sites_;
+    };
+
+    // 调用点的静态信息，由日志宏在调用点定义为静态变量，只在第一次执行时注册
+    struct LogSite
+    {
+        LogSite(LogLevel::value level, const char *file, size_t line, const char *format)
+            : level(level), file(file), line(line), format(format),
+              id(SiteRegistry::GetInstance().Register(this)) {}
+        LogLevel::value level;
+        const char *file;
+        size_t line;
+        const char *format;
+        uint32_t id;
+    };
+
+    // 二进制记录头，后面紧跟编码后的参数
+    struct BinaryHeader
+    {
+        uint32_t size; // 整条记录的字节数(含记录头)
+        uint32_t site; // 调用点编号
+        uint64_t time; // 纳秒时间戳
+        uint64_t tid;  // 线程id
+    };
+    const uint32_t kTextSite = 0;           // 记录体是已格式化好的文本(printf 风格接口)
+    const uint32_t kDefineSite = UINT32_MAX; // 记录体是调用点定义，供离线解码
+
+    // 一条记录编码后的长度，不含字符串内容
+    inline size_t EncodedFixedSize(const FormatArg *args, size_t count)
+    {
+        size_t fixed = sizeof(BinaryHeader);
+        for (size_t i = 0; i < count; ++i)
+            fixed += 1 + (args[i].type == FormatArg::Type::STRING ? sizeof(uint32_t) : sizeof(uint64_t));
+        return fixed;
+    }
+    // 一条记录编码后的完整长度
+    inline size_t EncodedSize(const FormatArg *args, size_t count)
+    {
+        size_t size = EncodedFixedSize(args, count);
+        for (size_t i = 0; i < count; ++i)
+            if (args[i].type == FormatArg::Type::STRING)
+                size += args[i].s.len;
+        return size;
+    }
+    // 按二进制格式编码一条记录到 writer，字符串参数在空间不足时被截断，保证记录完整
+    inline void EncodeRecord(FixedWriter &writer, uint32_t site,
+                             const FormatArg *args, size_t count)
+    {
+        size_t fixed = EncodedFixedSize(args, count);
+        if (fixed > writer.Capacity() - writer.Size())
+            return;
+        size_t budget = writer.Capacity() - writer.Size() - fixed;
+
+        char *begin = writer.Data() + writer.Size();
+        BinaryHeader head;
+        head.site = site;
+        head.time = Util::Date::NowNs();
+        head.tid = static_cast<uint64_t>(pthread_self());
+        writer.Append(reinterpret_cast<const char *>(&head), sizeof(head));
+        for (size_t i = 0; i < count; ++i)
+        {
+            const FormatArg &arg = args[i];
+            writer.Append(static_cast<char>(arg.type));
+            if (arg.type == FormatArg::Type::STRING)
+            {
+                uint32_t len = arg.s.len < budget ? arg.s.len : budget;
+                budget -= len;
+                writer.Append(reinterpret_cast<const char *>(&len), sizeof(len));
+                writer.Append(arg.s.data, len);
+            }
+            else
+            {
+                uint64_t raw = 0; // 定长参数统一占8字节
+                memcpy(&raw, &arg.u, sizeof(raw));
+                if (arg.type == FormatArg::Type::BOOL || arg.type == FormatArg::Type::CHAR)
+                    raw = arg.type == FormatArg::Type::BOOL ? arg.b : static_cast<unsigned char>(arg.c);
+                writer.Append(reinterpret_cast<const char *>(&raw), sizeof(raw));
+            }
+        }
+        uint32_t size = writer.Data() + writer.Size() - begin;
+        memcpy(begin, &size, sizeof(size));
+    }
+    // 把已格式化的文本包装成一条记录
+    inline void EncodeText(FixedWriter &writer, const char *data, size_t len)
+    {
+        FormatArg arg;
+        arg.type = FormatArg::Type::STRING;
+        arg.s.data = data;
+        arg.s.len = len;
+        EncodeRecord(writer, kTextSite, &arg, 1);
+    }
+    // 生成调用点定义记录，参数依次为编号、等级、行号、日志器名、文件名、格式串
+    inline void EncodeDefine(std::string *out, const LogSite &site, const std::string &logger)
+    {
+        char buf[4096];
+        FixedWriter writer(buf, sizeof(buf));
+        FormatArg args[6];
+        args[0].type = FormatArg::Type::UINT;
+        args[0].u = site.id;
+        args[1].type = FormatArg::Type::UINT;
+        args[1].u = static_cast<uint64_t>(site.level);
+        args[2].type = FormatArg::Type::UINT;
+        args[2].u = site.line;
+        const char *strs[3] = {logger.c_str(), site.file, site.format};
+        for (int i = 0; i < 3; ++i)
+        {
+            args[3 + i].type = FormatArg::Type::STRING;
+            args[3 + i].s.data = strs[i];
+            args[3 + i].s.len = strlen(strs[i]);
+        }
+        EncodeRecord(writer, kDefineSite, args, 6);
+        out->append(writer.Data(), writer.Size());
+    }
+
+    // 二进制日志解码器，把记录还原成与文本模式完全相同的格式。
+    // 后台格式化时调用点信息直接查进程内的注册表，离线解码时从定义记录中获取
+    class BinaryDecoder
+    {
+    public:
+        BinaryDecoder(const std::string &logger = "", bool use_registry = false)
+            : logger_(logger), use_registry_(use_registry) {}
+
+        // 解码一段数据，文本追加到 out；末尾不完整的记录留到下一次调用
+        void Decode(const char *data, size_t len, std::string *out)
+        {
+            if (!pending_.empty())
+            {
+                pending_.append(data, len);
+                size_t used = DecodeFrames(pending_.data(), pending_.size(), out);
+                pending_.erase(0, used);
+                return;
+            }
+            size_t used = DecodeFrames(data, len, out);
+            pending_.assign(data + used, len - used);
+        }
+        // 找出数据中本解码器还没输出过定义的调用点，生成定义记录追加到 out，供 RAW 模式使用
+        void CollectDefines(const char *data, size_t len, std::string *out)
+        {
+            BinaryHeader head;
+            for (size_t pos = 0; pos + sizeof(head) <= len; pos += head.size)
+            {
+                memcpy(&head, data + pos, sizeof(head));
+                if (head.size < sizeof(head))
+                    break;
+                if (head.site == kTextSite || head.site == kDefineSite || sites_.count(head.site))
+                    continue;
+                const LogSite *site = SiteRegistry::GetInstance().Find(head.site);
+                if (site == nullptr)
+                    continue;
+                EncodeDefine(out, *site, logger_);
+                sites_[head.site] = SiteInfo{logger_, site->file, site->format, site->line, site->level};
+            }
+        }
+
+    private:
+        struct SiteInfo
+        {
+            std::string logger;
+            std::string file;
+            std::string format;
+            size_t line;
+            LogLevel::value level;
+        };
+
+        size_t DecodeFrames(const char *data, size_t len, std::string *out)
+        {
+            size_t pos = 0;
+            BinaryHeader head;
+            while (pos + sizeof(head) <= len)
+            {
+                memcpy(&head, data + pos, sizeof(head));
+                if (head.size < sizeof(head)) // 数据损坏，丢弃剩余部分
+                    return len;
+                if (pos + head.size > len)
+                    break;
+                DecodeOne(head, data + pos + sizeof(head), head.size - sizeof(head), out);
+                pos += head.size;
+            }
+            return pos;
+        }
+        // 解出参数列表，字符串参数直接指向记录内部
+        bool DecodeArgs(const char *body, size_t len)
+        {
+            args_.clear();
+            size_t pos = 0;
+            while (pos < len)
+            {
+                FormatArg arg;
+                arg.type = static_cast<FormatArg::Type>(body[pos++]);
+                if (arg.type == FormatArg::Type::STRING)
+                {
+                    uint32_t n;
+                    if (pos + sizeof(n) > len)
+                        return false;
+                    memcpy(&n, body + pos, sizeof(n));
+                    pos += sizeof(n);
+                    if (pos + n > len)
+                        return false;
+                    arg.s.data = body + pos;
+                    arg.s.len = n;
+                    pos += n;
+                }
+                else
+                {
+                    uint64_t raw;
+                    if (pos + sizeof(raw) > len)
+                        return false;
+                    memcpy(&raw, body + pos, sizeof(raw));
+                    pos += sizeof(raw);
+                    memcpy(&arg.u, &raw, sizeof(raw));
+                    if (arg.type == FormatArg::Type::BOOL)
+                        arg.b = raw != 0;
+                    else if (arg.type == FormatArg::Type::CHAR)
+                        arg.c = static_cast<char>(raw);
+                }
+                args_.push_back(arg);
+            }
+            return true;
+        }
+        const SiteInfo *Lookup(uint32_t id)
+        {
+            auto it = sites_.find(id);
+            if (it != sites_.end())
+                return &it->second;
+            if (!use_registry_)
+                return nullptr;
+            const LogSite *site = SiteRegistry::GetInstance().Find(id);
+            if (site == nullptr)
+                return nullptr;
+            return &(sites_[id] = SiteInfo{logger_, site->file, site->format, site->line, site->level});
+        }
+        void DecodeOne(const BinaryHeader &head, const char *body, size_t len, std::string *out)
+        {
+            if (!DecodeArgs(body, len))
+                return;
+            if (head.site == kTextSite)
+            {
+                if (!args_.empty())
+                    out->append(args_[0].s.data, args_[0].s.len);
+                return;
+            }
+            if (head.site == kDefineSite)
+            {
+                if (args_.size() != 6)
+                    return;
+                sites_[args_[0].u] = SiteInfo{std::string(args_[3].s.data, args_[3].s.len),
+                                              std::string(args_[4].s.data, args_[4].s.len),
+                                              std::string(args_[5].s.data, args_[5].s.len),
+                                              args_[2].u,
+                                              static_cast<LogLevel::value>(args_[1].u)};
+                return;
+            }
+            const SiteInfo *site = Lookup(head.site);
+            if (site == nullptr)
+                return;
+            char line[16 * 1024];
+            FixedWriter writer(line, sizeof(line) - 1);
+            char tid[24];
+            FixedWriter tid_writer(tid, sizeof(tid) - 1);
+            tid_writer.AppendNumber(head.tid);
+            tid[tid_writer.Size()] = '\0';
+            LogMessage::FormatHead(writer, head.time, tid, site->level,
+                                   site->logger.c_str(), site->file.c_str(), site->line);
+            FormatArgs(writer, site->format.c_str(), args_.data(), args_.size());
+            line[writer.Size()] = '\n';
+            out->append(line, writer.Size() + 1);
+        }
+
+    private:
+        std::string logger_;  // 后台格式化时使用的日志器名
+        bool use_registry_;   // 是否可以直接查进程内的调用点注册表
+        std::string pending_; // 上次未解完的不完整记录
+        std::vector<FormatArg> args_;
+        std::unordered_map<uint32_t, SiteInfo> sites_;
+    };
+} // namespace mylog
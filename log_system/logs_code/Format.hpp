@@ -0,0 +1,296 @@
+/*无堆分配的日志格式化设计*/
+#pragma once
+#include <charconv>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace mylog
+{
+    // 固定容量写入器：把格式化结果直接写进调用方提供的缓冲区(栈或线程局部)，
+    // 超出容量的部分被截断，整个过程不申请堆内存
+    class FixedWriter
+    {
+    public:
+        FixedWriter(char *buf, size_t cap) : buf_(buf), cap_(cap), size_(0) {}
+
+        void Append(const char *data, size_t len)
+        {
+            size_t n = len < cap_ - size_ ? len : cap_ - size_;
+            memcpy(buf_ + size_, data, n);
+            size_ += n;
+        }
+        void Append(const char *str) { Append(str, strlen(str)); }
+        void Append(char c)
+        {
+            if (size_ < cap_)
+                buf_[size_++] = c;
+        }
+        // 整数与浮点数用 to_chars 转换，不经过 locale 也不分配内存
+        template <typename T>
+        void AppendNumber(T value)
+        {
+            auto ret = std::to_chars(buf_ + size_, buf_ + cap_, value);
+            if (ret.ec == std::errc())
+                size_ = ret.ptr - buf_;
+        }
+        void AppendHex(uint64_t value)
+        {
+            auto ret = std::to_chars(buf_ + size_, buf_ + cap_, value, 16);
+            if (ret.ec == std::errc())
+                size_ = ret.ptr - buf_;
+        }
+        // 按固定宽度写入无符号数，不足补零
+        void AppendPadded(uint64_t value, int width)
+        {
+            char tmp[20];
+            for (int i = width - 1; i >= 0; --i, value /= 10)
+                tmp[i] = '0' + value % 10;
+            Append(tmp, width);
+        }
+        // printf 风格追加，兼容旧接口
+        void AppendV(const char *format, va_list va)
+        {
+            if (size_ >= cap_)
+                return;
+            int r = vsnprintf(buf_ + size_, cap_ - size_, format, va);
+            if (r < 0)
+                return;
+            size_t n = static_cast<size_t>(r);
+            size_ += n < cap_ - size_ ? n : cap_ - size_ - 1; // vsnprintf 截断时最后一字节是'\0'
+        }
+
+        // 回退到 size 字节，丢弃之后写入的内容
+        void Truncate(size_t size)
+        {
+            if (size < size_)
+                size_ = size;
+        }
+
+        char *Data() { return buf_; }
+        size_t Size() { return size_; }
+        size_t Capacity() { return cap_; }
+
+    private:
+        char *buf_;
+        size_t cap_;
+        size_t size_;
+    };
+
+    // 类型擦除后的格式化参数，变参模板把每个参数转换成它再交给 FormatArgs
+    struct FormatArg
+    {
+        enum class Type
+        {
+            BOOL,
+            CHAR,
+            INT,
+            UINT,
+            DOUBLE,
+            STRING,
+            POINTER
+        };
+        Type type;
+        union
+        {
+            bool b;
+            char c;
+            int64_t i;
+            uint64_t u;
+            double d;
+            const void *p;
+            struct
+            {
+                const char *data;
+                size_t len;
+            } s;
+        };
+    };
+
+    template <typename T>
+    struct UnsupportedArg : std::false_type
+    {
+    };
+
+    // 把参数转换成 FormatArg，不支持的类型在编译期报错
+    template <typename T>
+    FormatArg MakeArg(const T &value)
+    {
+        using U = std::decay_t<T>;
+        FormatArg arg;
+        if constexpr (std::is_same<U, bool>::value)
+        {
+            arg.type = FormatArg::Type::BOOL;
+            arg.b = value;
+        }
+        else if constexpr (std::is_same<U, char>::value)
+        {
+            arg.type = FormatArg::Type::CHAR;
+            arg.c = value;
+        }
+        else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value)
+        {
+            arg.type = FormatArg::Type::INT;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral<U>::value)
+        {
+            arg.type = FormatArg::Type::UINT;
+            arg.u = value;
+        }
+        else if constexpr (std::is_enum<U>::value)
+        {
+            arg.type = FormatArg::Type::INT;
+            arg.i = static_cast<int64_t>(value);
+        }
+        else if constexpr (std::is_floating_point<U>::value)
+        {
+            arg.type = FormatArg::Type::DOUBLE;
+            arg.d = value;
+        }
+        else if constexpr (std::is_same<U, const char *>::value || std::is_same<U, char *>::value)
+        {
+            arg.type = FormatArg::Type::STRING;
+            arg.s.data = value ? value : "(null)";
+            arg.s.len = strlen(arg.s.data);
+        }
+        else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+        {
+            std::string_view sv = value;
+            arg.type = FormatArg::Type::STRING;
+            arg.s.data = sv.data();
+            arg.s.len = sv.size();
+        }
+        else if constexpr (std::is_pointer<U>::value)
+        {
+            arg.type = FormatArg::Type::POINTER;
+            arg.p = value;
+        }
+        else
+        {
+            static_assert(UnsupportedArg<T>::value, "不支持的日志参数类型");
+        }
+        return arg;
+    }
+    // 字符数组(字面量、栈上的缓冲区)不可能为空，不做空指针判断，否则 -Wall 会对数组地址告警
+    template <size_t N>
+    FormatArg MakeArg(const char (&value)[N])
+    {
+        FormatArg arg;
+        arg.type = FormatArg::Type::STRING;
+        arg.s.data = value;
+        arg.s.len = strlen(value);
+        return arg;
+    }
+
+    // 写入单个参数
+    inline void AppendArg(FixedWriter &writer, const FormatArg &arg)
+    {
+        switch (arg.type)
+        {
+        case FormatArg::Type::BOOL:
+            writer.Append(arg.b ? "true" : "false");
+            break;
+        case FormatArg::Type::CHAR:
+            writer.Append(arg.c);
+            break;
+        case FormatArg::Type::INT:
+            writer.AppendNumber(arg.i);
+            break;
+        case FormatArg::Type::UINT:
+            writer.AppendNumber(arg.u);
+            break;
+        case FormatArg::Type::DOUBLE:
+            writer.AppendNumber(arg.d);
+            break;
+        case FormatArg::Type::STRING:
+            writer.Append(arg.s.data, arg.s.len);
+            break;
+        case FormatArg::Type::POINTER:
+            writer.Append("0x");
+            writer.AppendHex(reinterpret_cast<uintptr_t>(arg.p));
+            break;
+        }
+    }
+
+    // 把格式串中的 {} 依次替换为参数，{{ 和 }} 分别输出 { 和 }
+    inline void FormatArgs(FixedWriter &writer, const char *format,
+                           const FormatArg *args, size_t count)
+    {
+        size_t index = 0;
+        const char *p = format;
+        while (*p)
+        {
+            if (p[0] == '{' && p[1] == '}')
+            {
+                if (index < count)
+                    AppendArg(writer, args[index++]);
+                p += 2;
+            }
+            else if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}'))
+            {
+                writer.Append(p[0]);
+                p += 2;
+            }
+            else
+            {
+                writer.Append(*p++);
+            }
+        }
+    }
+
+    // 格式化结果长度的上界，用于预先在缓冲区中预留空间
+    inline size_t MaxFormattedSize(const char *format, const FormatArg *args, size_t count)
+    {
+        size_t size = strlen(format);
+        for (size_t i = 0; i < count; ++i)
+        {
+            switch (args[i].type)
+            {
+            case FormatArg::Type::BOOL:
+                size += 5;
+                break;
+            case FormatArg::Type::CHAR:
+                size += 1;
+                break;
+            case FormatArg::Type::STRING:
+                size += args[i].s.len;
+                break;
+            default: // 整数最长20位，浮点数最短表示不超过24位，指针加0x不超过18位
+                size += 24;
+                break;
+            }
+        }
+        return size;
+    }
+
+    // 编译期统计格式串中的占位符个数，供日志宏检查参数个数
+    constexpr size_t CountPlaceholders(const char *format)
+    {
+        size_t count = 0;
+        while (*format)
+        {
+            if (format[0] == '{' && format[1] == '}')
+            {
+                ++count;
+                format += 2;
+            }
+            else if ((format[0] == '{' && format[1] == '{') || (format[0] == '}' && format[1] == '}'))
+                format += 2;
+            else
+                ++format;
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    void Format(FixedWriter &writer, const char *format, const Args &...args)
+    {
+        FormatArg list[sizeof...(Args) + 1] = {MakeArg(args)...};
+        FormatArgs(writer, format, list, sizeof...(Args));
+    }
+} // namespace mylog
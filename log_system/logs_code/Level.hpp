@@ -4,7 +4,7 @@
 namespace mylog {
 class LogLevel {
    public:
-    enum class value { DEBUG, INFO, WARN, ERROR, FATAL};
+    enum class value { DEBUG, INFO, WARN, ERROR, FATAL, OFF };
 
     // 提供日志等级的字符串转换接口
     static const char* ToString(value level) {
@@ -24,5 +24,14 @@ class LogLevel {
         }
         return "UNKNOW";
     }
+    // 由字符串得到日志等级，无法识别时返回 DEBUG
+    static value FromString(const std::string& level) {
+        if (level == "INFO") return value::INFO;
+        if (level == "WARN") return value::WARN;
+        if (level == "ERROR") return value::ERROR;
+        if (level == "FATAL") return value::FATAL;
+        if (level == "OFF") return value::OFF;
+        return value::DEBUG;
+    }
 };
 }  // namespace mylog
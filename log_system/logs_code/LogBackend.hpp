@@ -0,0 +1,180 @@
+/*多个日志器共用的后台线程池设计*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Util.hpp"
+
+extern mylog::Util::JsonData *g_conf_data;
+
+namespace mylog
+{
+    class LogBackend;
+
+    // 交给共享后台处理的任务，即一个不自带线程的异步工作器
+    class BackendTask
+    {
+    public:
+        virtual ~BackendTask() {}
+        // 处理一批数据，返回是否还有数据需要马上再处理
+        virtual bool RunBatch() = 0;
+        // 没有需要马上处理的数据时调用：返回 true 表示可以挂起，deadline 为最晚什么时候需要再处理
+        // (有数据没攒够批量时为批量的截止时间，没有事情时为 time_point::max())；
+        // 返回 false 表示检查期间又有了需要处理的数据
+        virtual bool Park(std::chrono::steady_clock::time_point *deadline) = 0;
+
+    private:
+        friend class LogBackend;
+        // 以下由 LogBackend 在它的锁内访问
+        bool queued_ = false;   // 在就绪队列中
+        bool running_ = false;  // 正在被某个后台线程处理
+        bool notified_ = false; // 处理期间又收到了通知
+        std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+    };
+
+    // 共享的日志后台：固定数量的线程轮流处理挂在它上面的所有日志器。
+    // 有数据要处理的任务进入就绪队列，线程每次从队头取一个任务只处理一批，处理完还有数据就放回队尾，
+    // 写得多的日志器不会饿死其他日志器；同一任务同一时间只在一个线程中处理，保证顺序。
+    // 挂起的任务各自带有截止时间(各日志器的 flush_interval)，到期时即使没攒够批量也会被处理
+    class LogBackend
+    {
+    public:
+        using ptr = std::shared_ptr<LogBackend>;
+
+        LogBackend(size_t threads) : stop_(false)
+        {
+            for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+                threads_.emplace_back(&LogBackend::ThreadEntry, this);
+        }
+        // 所有任务都已摘下(挂在上面的日志器都持有它，最后一个析构后才会到这里)
+        ~LogBackend()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                stop_ = true;
+            }
+            cond_work_.notify_all();
+            for (auto &t : threads_)
+                t.join();
+        }
+        // 默认的共享后台，线程数为 backend_threads
+        static ptr GetInstance()
+        {
+            static ptr backend = std::make_shared<LogBackend>(g_conf_data->backend_threads);
+            return backend;
+        }
+        size_t Threads() const { return threads_.size(); }
+
+        // 挂上任务，开始时处于挂起状态，有数据后由 Notify 唤醒
+        void Attach(BackendTask *task)
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            tasks_.push_back(task);
+        }
+        // 任务有数据需要处理
+        void Notify(BackendTask *task)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (task->running_)
+                {
+                    task->notified_ = true;
+                    return;
+                }
+                if (task->queued_)
+                    return;
+                Enqueue(task);
+            }
+            cond_work_.notify_one();
+        }
+        // 摘下任务：先让它处理到可以挂起为止(调用前任务应已设置停止标志，处理完剩余数据才会挂起)
+        void Detach(BackendTask *task)
+        {
+            Notify(task);
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_parked_.wait(lock, [&]()
+                              { return !task->queued_ && !task->running_; });
+            tasks_.erase(std::find(tasks_.begin(), tasks_.end(), task));
+        }
+
+    private:
+        void Enqueue(BackendTask *task)
+        {
+            task->queued_ = true;
+            task->deadline_ = std::chrono::steady_clock::time_point::max();
+            ready_.push_back(task);
+        }
+        // 把到期的挂起任务放入就绪队列，返回剩下的最早截止时间
+        std::chrono::steady_clock::time_point Expire()
+        {
+            auto now = std::chrono::steady_clock::now();
+            auto earliest = std::chrono::steady_clock::time_point::max();
+            for (auto task : tasks_)
+            {
+                if (task->queued_ || task->running_)
+                    continue;
+                if (task->deadline_ <= now)
+                    Enqueue(task);
+                else
+                    earliest = std::min(earliest, task->deadline_);
+            }
+            return earliest;
+        }
+        void ThreadEntry()
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (true)
+            {
+                auto earliest = Expire();
+                if (ready_.empty())
+                {
+                    if (stop_)
+                        return;
+                    if (earliest == std::chrono::steady_clock::time_point::max())
+                        cond_work_.wait(lock);
+                    else
+                        cond_work_.wait_until(lock, earliest);
+                    continue;
+                }
+                BackendTask *task = ready_.front();
+                ready_.pop_front();
+                task->queued_ = false;
+                task->running_ = true;
+                task->notified_ = false;
+                lock.unlock();
+
+                auto deadline = std::chrono::steady_clock::time_point::max();
+                bool park = !task->RunBatch() && task->Park(&deadline);
+
+                lock.lock();
+                task->running_ = false;
+                if (!park || task->notified_)
+                {
+                    Enqueue(task); // 放到队尾，先轮到其他任务
+                    if (ready_.size() > 1)
+                        cond_work_.notify_one();
+                }
+                else
+                {
+                    task->deadline_ = deadline;
+                    cond_parked_.notify_all();
+                }
+            }
+        }
+
+    private:
+        bool stop_;
+        std::mutex mtx_;
+        std::vector<BackendTask *> tasks_;  // 挂在后台上的全部任务
+        std::deque<BackendTask *> ready_;   // 就绪队列
+        std::condition_variable cond_work_;   // 有任务就绪或到期
+        std::condition_variable cond_parked_; // 有任务挂起，Detach 等待
+        std::vector<std::thread> threads_;    // 必须最后初始化
+    };
+} // namespace mylog
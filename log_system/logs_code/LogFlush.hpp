@@ -1,7 +1,25 @@
+#pragma once
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <unistd.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Metrics.hpp"
 #include "Util.hpp"
 
 extern mylog::Util::JsonData *g_conf_data;
@@ -13,6 +31,138 @@ namespace mylog
         using ptr = std::shared_ptr<LogFlush>;
         virtual ~LogFlush() {}
         virtual void Flush(const char *data, size_t len) = 0; // 不同的写文件方式Flush的实现不同
+        // 一批数据分散在缓冲区的多个块中，默认逐块调用 Flush；
+        // 直接写文件描述符的方向可以重写为一次 writev
+        virtual void FlushV(const struct iovec *iov, int iovcnt)
+        {
+            for (int i = 0; i < iovcnt; ++i)
+                Flush(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+        // 把之前 Flush 的数据同步到存储，错误/致命日志和持久化请求会触发
+        virtual void Sync() {}
+        // 能否被日志器的多个分片同时调用，不能的由日志器加锁后调用
+        virtual bool Concurrent() { return false; }
+        // 每打开一个新文件时先写入 prologue 返回的内容，由日志器在启动后台线程前设置。
+        // RAW 模式下是已出现过的调用点定义，滚动出的每个文件都能单独离线解码
+        void SetPrologue(std::function<std::string()> prologue) { prologue_ = std::move(prologue); }
+        // 由日志器在启动后台线程前设置：把每次 fdatasync 的耗时记到 latency，包括 flush_log 为2时
+        // 在 Flush 中成组提交的同步。latency 与日志器的运行指标共享所有权，落地方向比日志器活得久也有效。
+        // 返回 false 表示不支持，日志器改为记录整个 Sync 调用的耗时
+        virtual bool SetSyncLatency(std::shared_ptr<Histogram>) { return false; }
+
+    protected:
+        std::function<std::string()> prologue_;
+
+        // 用 writev 把 iov 全部写到 fd，处理部分写入和 IOV_MAX 限制，返回写入的字节数；
+        // offset 不小于0时改用 pwritev 从该偏移开始写
+        static size_t WriteV(int fd, const struct iovec *iov, int iovcnt, off_t offset = -1)
+        {
+            size_t total = 0;
+            struct iovec cur = {nullptr, 0}; // 部分写入时当前块剩下的部分
+            int i = 0;
+            while (i < iovcnt || cur.iov_len)
+            {
+                std::vector<struct iovec> batch;
+                if (cur.iov_len)
+                    batch.push_back(cur);
+                while (i < iovcnt && batch.size() < IOV_MAX)
+                    batch.push_back(iov[i++]);
+                ssize_t n = offset < 0 ? writev(fd, batch.data(), batch.size())
+                                       : pwritev(fd, batch.data(), batch.size(), offset);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        i -= batch.size() - (cur.iov_len ? 1 : 0);
+                        continue;
+                    }
+                    std::cout << __FILE__ << __LINE__ << "writev log file failed" << std::endl;
+                    perror(NULL);
+                    return total;
+                }
+                total += n;
+                if (offset >= 0)
+                    offset += n;
+                // 跳过已写完的块，没写完的部分放到下一轮开头，其余的块退回去重新组批
+                size_t k = 0;
+                while (k < batch.size() && static_cast<size_t>(n) >= batch[k].iov_len)
+                    n -= batch[k++].iov_len;
+                if (k < batch.size())
+                {
+                    cur.iov_base = static_cast<char *>(batch[k].iov_base) + n;
+                    cur.iov_len = batch[k].iov_len - n;
+                    i -= batch.size() - k - 1;
+                }
+                else
+                    cur.iov_len = 0;
+            }
+            return total;
+        }
+    };
+
+    // 成组提交的持久化策略，flush_log 为2时使用：每批数据写入后只用 sync_file_range 发起异步回写，
+    // 累计写入 sync_bytes 字节或距上次同步超过 sync_interval_ms 毫秒才调用 fdatasync，
+    // 多批数据共用一次磁盘同步；Sync 则立即同步
+    class SyncPolicy
+    {
+    public:
+        // 换到新文件时调用，从 offset 开始记录，默认为文件当前末尾
+        void Reset(int fd, off_t offset = -1)
+        {
+            fd_ = fd;
+            offset_ = fd < 0 ? 0 : (offset < 0 ? lseek(fd, 0, SEEK_END) : offset);
+            unsynced_ = 0;
+            last_sync_ = std::chrono::steady_clock::now();
+        }
+        // 已经写入文件(不在 stdio 缓冲区中)的 len 字节
+        void Written(size_t len)
+        {
+            if (fd_ < 0 || len == 0)
+                return;
+            if (range_ && sync_file_range(fd_, offset_, len, SYNC_FILE_RANGE_WRITE) != 0)
+            {
+                if (errno == ENOSYS || errno == EINVAL || errno == ESPIPE) // 文件系统不支持就不再尝试
+                    range_ = false;
+                else
+                {
+                    std::cout << __FILE__ << __LINE__ << "sync_file_range failed" << std::endl;
+                    perror(NULL);
+                }
+            }
+            offset_ += len;
+            unsynced_ += len;
+            if (unsynced_ >= g_conf_data->sync_bytes ||
+                std::chrono::steady_clock::now() - last_sync_ >=
+                    std::chrono::milliseconds(g_conf_data->sync_interval_ms))
+                Sync();
+        }
+        // 立即同步还没同步的数据
+        void Sync()
+        {
+            if (fd_ < 0 || unsynced_ == 0)
+                return;
+            auto begin = std::chrono::steady_clock::now();
+            if (fdatasync(fd_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                perror(NULL);
+            }
+            unsynced_ = 0;
+            last_sync_ = std::chrono::steady_clock::now();
+            if (latency_)
+                latency_->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(last_sync_ - begin).count());
+        }
+        // 每次 fdatasync 的耗时记到 latency，为空时不记录
+        void SetLatency(std::shared_ptr<Histogram> latency) { latency_ = std::move(latency); }
+        Histogram *Latency() { return latency_.get(); }
+
+    private:
+        std::shared_ptr<Histogram> latency_;
+        int fd_ = -1;
+        off_t offset_ = 0;     // 下一次写入的文件偏移
+        size_t unsynced_ = 0;  // 上次同步后写入的字节数
+        bool range_ = true;    // 是否可以使用 sync_file_range
+        std::chrono::steady_clock::time_point last_sync_;
     };
     // 标准输出
     class StdoutFlush : public LogFlush
@@ -23,6 +173,7 @@ namespace mylog
         {
             cout.write(data, len);
         }
+        void Sync() override { cout.flush(); }
     };
     // 文件输出
     class FileFlush : public LogFlush
@@ -41,6 +192,14 @@ namespace mylog
                 std::cout << __FILE__ << __LINE__ << "open log file failed" << std::endl;
                 perror(NULL);
             }
+            sync_.Reset(fs_ == NULL ? -1 : fileno(fs_));
+        }
+        ~FileFlush()
+        {
+            if (fs_ == NULL)
+                return;
+            Sync();
+            fclose(fs_);
         }
         // 写入文件
         void Flush(const char *data, size_t len) override
@@ -60,28 +219,169 @@ namespace mylog
                 }
             }
             else if (g_conf_data->flush_log == 2)
-            {                       // 如果配置为2
-                fflush(fs_);        // 刷新缓冲区
-                fsync(fileno(fs_)); // 同步文件
+            {                      // 如果配置为2
+                fflush(fs_);       // 刷新缓冲区
+                sync_.Written(len); // 由持久化策略决定何时同步
             }
         }
+        // 整批数据绕过 stdio 缓冲区用一次 writev 写出
+        void FlushV(const struct iovec *iov, int iovcnt) override
+        {
+            if (fs_ == NULL)
+                return;
+            fflush(fs_); // stdio 缓冲区中可能还有 Flush 写的数据，先写出保证顺序
+            size_t len = WriteV(fileno(fs_), iov, iovcnt);
+            if (g_conf_data->flush_log == 2)
+                sync_.Written(len);
+        }
+        void Sync() override
+        {
+            if (fs_ == NULL || g_conf_data->flush_log == 0)
+                return;
+            fflush(fs_);
+            if (g_conf_data->flush_log == 2)
+                sync_.Sync();
+        }
+        bool SetSyncLatency(std::shared_ptr<Histogram> latency) override
+        {
+            sync_.SetLatency(std::move(latency));
+            return true;
+        }
 
     private:
         std::string filename_;
         FILE *fs_ = NULL;
+        SyncPolicy sync_;
     };
 
+    // 多个分片共同写一个文件：每批数据先用原子加法在文件末尾预留一段偏移，再用 pwritev 写到预留的位置，
+    // 各分片的后台线程之间不加锁。同一分片的数据保持顺序，不同分片的批次按预留的先后排列；
+    // 进程在预留之后、写完之前退出会在文件中留下一段0字节
+    class SharedFileFlush : public LogFlush
+    {
+    public:
+        using ptr = std::shared_ptr<SharedFileFlush>;
+
+        SharedFileFlush(const std::string &filename) : filename_(filename), unsynced_(0)
+        {
+            Util::File::CreateDirectory(Util::File::Path(filename));
+            // 不能用 O_APPEND 打开，否则 pwritev 会忽略偏移
+            fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+            if (fd_ < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "open log file failed" << std::endl;
+                perror(NULL);
+            }
+            offset_ = fd_ < 0 ? 0 : lseek(fd_, 0, SEEK_END);
+            last_sync_ = NowMs();
+        }
+        ~SharedFileFlush()
+        {
+            if (fd_ < 0)
+                return;
+            Sync();
+            close(fd_);
+        }
+        void Flush(const char *data, size_t len) override
+        {
+            struct iovec iov = {const_cast<char *>(data), len};
+            FlushV(&iov, 1);
+        }
+        void FlushV(const struct iovec *iov, int iovcnt) override
+        {
+            if (fd_ < 0)
+                return;
+            size_t len = 0;
+            for (int i = 0; i < iovcnt; ++i)
+                len += iov[i].iov_len;
+            WriteV(fd_, iov, iovcnt, offset_.fetch_add(len));
+            // flush_log 为2时按 sync_bytes/sync_interval_ms 成组同步
+            if (g_conf_data->flush_log == 2 &&
+                (unsynced_.fetch_add(len) + len >= g_conf_data->sync_bytes ||
+                 NowMs() - last_sync_.load() >= static_cast<int64_t>(g_conf_data->sync_interval_ms)))
+                Sync();
+        }
+        void Sync() override
+        {
+            if (fd_ < 0 || g_conf_data->flush_log == 0)
+                return;
+            unsynced_.store(0);
+            last_sync_.store(NowMs());
+            auto begin = std::chrono::steady_clock::now();
+            if (fdatasync(fd_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                perror(NULL);
+            }
+            if (latency_)
+                latency_->RecordSince(begin);
+        }
+        bool Concurrent() override { return true; }
+        bool SetSyncLatency(std::shared_ptr<Histogram> latency) override
+        {
+            latency_ = std::move(latency);
+            return true;
+        }
+
+    private:
+        static int64_t NowMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        std::string filename_;
+        int fd_;
+        std::atomic<off_t> offset_;     // 下一批数据预留的起始偏移
+        std::atomic<size_t> unsynced_;  // 上次同步后写入的字节数
+        std::atomic<int64_t> last_sync_; // 上次同步的时间(毫秒)
+        std::shared_ptr<Histogram> latency_; // fdatasync 的耗时，可以为空
+    };
+
+    // 滚动文件输出：文件超过 max_size 或跨过 roll_period(小时/天)的边界时换新文件，
+    // 文件名为 basename + 年月日-时分秒-序号.log，按名字排序即按时间排序。
+    // 旧文件的同步、关闭、压缩以及按 roll_keep_files/roll_keep_bytes 清理都交给整理线程，
+    // 后台线程换文件时只做一次 fopen
     class RollFileFlush : public LogFlush
     {
     public:
         using ptr = std::shared_ptr<RollFileFlush>;
+        // 压缩函数：把 in 压缩到 out，失败返回 false
+        using Compressor = std::function<bool(const std::string &in, std::string *out)>;
 
         RollFileFlush(const std::string &filename, size_t max_size)
-            : max_size_(max_size), basename_(filename)
+            : max_size_(max_size),
+              basename_(filename),
+              period_(g_conf_data->roll_period),
+              next_roll_(0),
+              closing_(0),
+              stop_(false)
         {
             Util::File::CreateDirectory(Util::File::Path(filename));
+            house_ = std::thread(&RollFileFlush::HouseEntry, this);
         }
-        // 当文件大小超过 max_size_ 时，创建新日志文件，并 关闭旧文件
+        ~RollFileFlush()
+        {
+            if (fs_ != NULL)
+                Retire();
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                stop_ = true;
+            }
+            cond_work_.notify_all();
+            house_.join();
+        }
+        // 设置滚动出去的文件使用的压缩函数和压缩后文件名的后缀，不设置则不压缩。
+        // 日志系统本身不依赖压缩库，由链接了压缩库的程序(如存储服务的 bundle)在启动时设置。
+        // 文件按 kCompressChunk 字节分块压缩，压缩文件是各块结果依次拼接，
+        // 压缩函数的输出需要自带长度(如 bundle 的头部、gzip 成员、LZ4 帧)，解压时逐块还原
+        static void SetCompressor(const Compressor &compressor, const std::string &suffix)
+        {
+            std::unique_lock<std::mutex> lock(CompressorMutex());
+            CompressorSlot() = std::make_pair(compressor, suffix);
+        }
+        // 当文件大小超过 max_size_ 或跨过滚动周期时，创建新日志文件，旧文件交给整理线程
 
         void Flush(const char *data, size_t len) override
         {
@@ -106,57 +406,303 @@ namespace mylog
                 }
             }
             else if (g_conf_data->flush_log == 2)
-            {                       // 如果配置为2
-                fflush(fs_);        // 刷新缓冲区
-                fsync(fileno(fs_)); // 同步文件
+            {                      // 如果配置为2
+                fflush(fs_);       // 刷新缓冲区
+                sync_.Written(len); // 由持久化策略决定何时同步
+            }
+        }
+        void FlushV(const struct iovec *iov, int iovcnt) override
+        {
+            InitLogFile();
+            if (fs_ == NULL)
+                return;
+            fflush(fs_);
+            size_t len = WriteV(fileno(fs_), iov, iovcnt);
+            cur_size_ += len;
+            if (g_conf_data->flush_log == 2)
+                sync_.Written(len);
+        }
+        // 同步当前文件，并等待已滚动出去的文件在整理线程中同步关闭
+        void Sync() override
+        {
+            if (g_conf_data->flush_log == 0)
+                return;
+            if (fs_ != NULL)
+            {
+                fflush(fs_);
+                if (g_conf_data->flush_log == 2)
+                    sync_.Sync();
             }
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_done_.wait(lock, [&]()
+                            { return closing_ == 0; });
+        }
+        // 当前文件和整理线程中滚动出去的文件的同步都记录
+        bool SetSyncLatency(std::shared_ptr<Histogram> latency) override
+        {
+            sync_.SetLatency(std::move(latency));
+            return true;
         }
 
     private:
+        // 滚动出去等待整理的文件
+        struct Retired
+        {
+            FILE *fs;
+            std::string name;
+        };
+
+        static std::mutex &CompressorMutex()
+        {
+            static std::mutex mtx;
+            return mtx;
+        }
+        static std::pair<Compressor, std::string> &CompressorSlot()
+        {
+            static std::pair<Compressor, std::string> slot;
+            return slot;
+        }
         // 初始化日志文件
         void InitLogFile()
         {
-            if (fs_ == NULL || cur_size_ >= max_size_) // 如果文件为空或当前文件大小超过最大大小
+            if (fs_ != NULL && cur_size_ < max_size_ && Util::Date::Now() < next_roll_)
+                return;
+            if (fs_ != NULL)
+                Retire();
+            time_t now = Util::Date::Now();
+            std::string filename = CreateFilename(now); // 创建新日志文件
             {
-                if (fs_ != NULL)
-                {                // 如果文件不为空
-                    fclose(fs_); // 关闭文件
-                    fs_ = NULL;
-                }
-                std::string filename = CreateFilename(); // 创建新日志文件
-                fs_ = fopen(filename.c_str(), "ab");     // 打开新日志文件
-                if (fs_ == NULL)
-                { // 如果打开失败
-                    std::cout << __FILE__ << __LINE__ << "open file failed" << std::endl;
-                    perror(NULL);
-                }
-                cur_size_ = 0; // 重置当前文件大小
+                std::unique_lock<std::mutex> lock(mtx_);
+                filename_ = filename;
+            }
+            fs_ = fopen(filename.c_str(), "ab"); // 打开新日志文件
+            if (fs_ == NULL)
+            { // 如果打开失败
+                std::cout << __FILE__ << __LINE__ << "open file failed" << std::endl;
+                perror(NULL);
+            }
+            sync_.Reset(fs_ == NULL ? -1 : fileno(fs_));
+            cur_size_ = 0; // 重置当前文件大小
+            next_roll_ = NextRoll(now);
+            if (fs_ != NULL && prologue_)
+            {
+                std::string head = prologue_();
+                fwrite(head.data(), 1, head.size(), fs_);
+                cur_size_ += head.size();
+            }
+        }
+        // 把当前文件交给整理线程
+        void Retire()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                retired_.push_back(Retired{fs_, filename_});
+                ++closing_;
             }
+            cond_work_.notify_one();
+            fs_ = NULL;
+        }
+        // 下一个滚动周期开始的时间，没有配置周期时永不按时间滚动
+        time_t NextRoll(time_t now)
+        {
+            if (period_ != "hour" && period_ != "day")
+                return std::numeric_limits<time_t>::max();
+            struct tm t;
+            localtime_r(&now, &t);
+            t.tm_min = 0;
+            t.tm_sec = 0;
+            if (period_ == "hour")
+                t.tm_hour += 1;
+            else
+            {
+                t.tm_hour = 0;
+                t.tm_mday += 1;
+            }
+            t.tm_isdst = -1; // 让 mktime 自己判断夏令时
+            return mktime(&t);
         }
 
-        // 构建落地的滚动日志文件名称
-        std::string CreateFilename()
+        // 构建落地的滚动日志文件名称，各字段定宽补零，保证按名字排序就是按时间排序
+        std::string CreateFilename(time_t now)
         {
-            time_t time_ = Util::Date::Now();
             struct tm t;
-            localtime_r(&time_, &t);
-            std::string filename = basename_;
-            filename += std::to_string(t.tm_year + 1900);
-            filename += std::to_string(t.tm_mon + 1);
-            filename += std::to_string(t.tm_mday);
-            filename += std::to_string(t.tm_hour + 1);
-            filename += std::to_string(t.tm_min + 1);
-            filename += std::to_string(t.tm_sec + 1) + '-' +
-                        std::to_string(cnt_++) + ".log";
-            return filename;
+            localtime_r(&now, &t);
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%04d%02d%02d-%02d%02d%02d-%04zu.log",
+                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                     t.tm_hour, t.tm_min, t.tm_sec, cnt_++ % 10000);
+            return basename_ + buf;
+        }
+
+        // 整理线程：同步并关闭滚动出去的文件，然后压缩、按保留策略清理旧文件
+        void HouseEntry()
+        {
+            Retain(); // 启动时先按保留策略清理一次
+            while (true)
+            {
+                Retired r;
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    cond_work_.wait(lock, [&]()
+                                    { return stop_ || !retired_.empty(); });
+                    if (retired_.empty())
+                        return;
+                    r = retired_.front();
+                    retired_.pop_front();
+                }
+                if (r.fs != NULL)
+                {
+                    fflush(r.fs);
+                    if (g_conf_data->flush_log == 2)
+                    {
+                        auto begin = std::chrono::steady_clock::now();
+                        if (fdatasync(fileno(r.fs)) != 0)
+                        {
+                            std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                            perror(NULL);
+                        }
+                        if (Histogram *latency = sync_.Latency()) // 只在启动前设置，这里只读
+                            latency->RecordSince(begin);
+                    }
+                    fclose(r.fs);
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    --closing_;
+                }
+                cond_done_.notify_all();
+                if (stop_) // 退出时不再压缩，留给下次启动后的保留策略处理
+                    continue;
+                Compress(r.name);
+                Retain();
+            }
+        }
+        // 压缩一个滚动出去的文件，成功后删除原文件
+        void Compress(const std::string &name)
+        {
+            std::pair<Compressor, std::string> compressor;
+            {
+                std::unique_lock<std::mutex> lock(CompressorMutex());
+                compressor = CompressorSlot();
+            }
+            if (!compressor.first)
+                return;
+            FILE *in = fopen(name.c_str(), "rb");
+            if (in == NULL) // 可能已被保留策略删除
+                return;
+            // 先写临时文件再改名，压缩文件要么完整要么不存在
+            std::string tmp = name + compressor.second + ".tmp";
+            FILE *fs = fopen(tmp.c_str(), "wb");
+            if (fs == NULL)
+            {
+                std::cout << __FILE__ << __LINE__ << "open file failed" << std::endl;
+                perror(NULL);
+                fclose(in);
+                return;
+            }
+            // 逐块读出、压缩、写出，内存占用与文件大小无关
+            std::string chunk(kCompressChunk, '\0'), packed;
+            bool ok = true;
+            size_t n;
+            while (ok && (n = fread(&chunk[0], 1, kCompressChunk, in)) > 0)
+            {
+                chunk.resize(n);
+                if (!compressor.first(chunk, &packed))
+                {
+                    std::cout << __FILE__ << __LINE__ << "compress log file failed: " << name << std::endl;
+                    fclose(in);
+                    fclose(fs);
+                    unlink(tmp.c_str());
+                    return;
+                }
+                ok = fwrite(packed.data(), 1, packed.size(), fs) == packed.size();
+                chunk.resize(kCompressChunk);
+            }
+            ok = !ferror(in) && ok;
+            fclose(in);
+            ok = fclose(fs) == 0 && ok;
+            if (!ok || rename(tmp.c_str(), (name + compressor.second).c_str()) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "write compressed log file failed" << std::endl;
+                perror(NULL);
+                unlink(tmp.c_str());
+                return;
+            }
+            unlink(name.c_str());
+        }
+        // 按 roll_keep_files/roll_keep_bytes 删除最旧的滚动文件，正在写的文件和滚动出去、
+        // 还在排队等待关闭压缩的文件不算在内，它们整理完之后才参与清理
+        void Retain()
+        {
+            size_t keep_files = g_conf_data->roll_keep_files;
+            size_t keep_bytes = g_conf_data->roll_keep_bytes;
+            if (keep_files == 0 && keep_bytes == 0)
+                return;
+            std::string dir = Util::File::Path(basename_);
+            std::string prefix = basename_.substr(dir.size());
+            DIR *dp = opendir(dir.empty() ? "." : dir.c_str());
+            if (dp == NULL)
+                return;
+            std::vector<std::pair<std::string, size_t>> files; // 文件名与大小
+            std::vector<std::string> busy; // 正在写或等待整理的文件
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                busy.push_back(filename_);
+                for (auto &r : retired_)
+                    busy.push_back(r.name);
+            }
+            struct dirent *ent;
+            while ((ent = readdir(dp)) != NULL)
+            {
+                std::string name = ent->d_name;
+                if (name.compare(0, prefix.size(), prefix) != 0 ||
+                    (name.size() >= 4 && name.compare(name.size() - 4, 4, ".tmp") == 0))
+                    continue;
+                std::string path = dir + name;
+                struct stat st;
+                if (std::find(busy.begin(), busy.end(), path) != busy.end() ||
+                    stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                    continue;
+                files.emplace_back(path, st.st_size);
+            }
+            closedir(dp);
+            std::sort(files.begin(), files.end()); // 名字有序即时间有序，最旧的在前
+            size_t total = 0;
+            for (auto &f : files)
+                total += f.second;
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                size_t remain = files.size() - i;
+                if ((keep_files == 0 || remain <= keep_files) && (keep_bytes == 0 || total <= keep_bytes))
+                    break;
+                if (unlink(files[i].first.c_str()) != 0)
+                {
+                    std::cout << __FILE__ << __LINE__ << "remove log file failed" << std::endl;
+                    perror(NULL);
+                }
+                total -= files[i].second;
+            }
         }
 
     private:
+        static const size_t kCompressChunk = 4 * 1024 * 1024; // 压缩时每次读出的字节数
         size_t cnt_ = 1;       // 文件序号
         size_t cur_size_ = 0;  // 当前文件大小
         size_t max_size_;      // 最大文件大小
         std::string basename_; // 日志文件名
+        std::string period_;   // 按时间滚动的周期，hour/day，其余值不按时间滚动
+        time_t next_roll_;     // 到这个时间就滚动
+        std::string filename_; // 当前文件名，整理线程读取时加锁
         FILE *fs_ = NULL;      // 文件指针
+        SyncPolicy sync_;      // 持久化策略
+        // 整理线程
+        std::mutex mtx_;
+        std::condition_variable cond_work_; // 有文件滚动出去
+        std::condition_variable cond_done_; // 有文件关闭完成
+        std::deque<Retired> retired_;
+        size_t closing_; // 已滚动出去、还没关闭的文件数
+        bool stop_;
+        std::thread house_;
     };
 
     // LogFlushFactory 作为工厂类，用于创建不同的 LogFlush 实例
@@ -1,8 +1,41 @@
+#include<atomic>
+#include<memory>
 #include<unordered_map>
+#include<vector>
 #include"AsyncLogger.hpp"
 
 namespace mylog{
-    // 通过单例对象对日志器进行管理，懒汉模式
+    // 注册表中一个名字对应的位置，创建后不再释放也不再移动，句柄直接指向它
+    struct LoggerSlot
+    {
+        std::atomic<AsyncLogger *> logger{nullptr}; // 还没注册日志器时为空
+        AsyncLogger::ptr owner;                     // 持有日志器，在 logger 发布之前写好，之后不再改变
+    };
+
+    // 轻量的日志器句柄：只是指向注册表位置的指针，可以复制，可以解析一次后缓存在静态变量里，
+    // 使用时不查表、不加锁、不改引用计数。名字还没注册时用默认日志器，注册后自动改用注册的日志器
+    class LoggerHandle
+    {
+    public:
+        LoggerHandle() : slot_(nullptr), fallback_(nullptr) {}
+        AsyncLogger *Get() const
+        {
+            AsyncLogger *logger = slot_ ? slot_->logger.load(std::memory_order_acquire) : nullptr;
+            return logger ? logger : fallback_;
+        }
+        AsyncLogger *operator->() const { return Get(); }
+        explicit operator bool() const { return Get() != nullptr; }
+
+    private:
+        friend class LoggerManager;
+        LoggerHandle(const LoggerSlot *slot, AsyncLogger *fallback) : slot_(slot), fallback_(fallback) {}
+        const LoggerSlot *slot_;
+        AsyncLogger *fallback_;
+    };
+
+    // 通过单例对象对日志器进行管理，懒汉模式。
+    // 查找走只读快照，不加锁：注册新名字时复制一份快照加上它再原子地替换(写时复制)，
+    // 旧快照可能还有读者在用，日志器数量很少，旧快照保留到管理器析构
     class LoggerManager
     {
     public:
@@ -15,45 +48,81 @@ namespace mylog{
         // 检查日志器是否存在
         bool LoggerExist(const std::string &name)
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            auto it = loggers_.find(name);
-            if (it == loggers_.end())
-                return false;
-            return true;
+            LoggerSlot *slot = Find(name);
+            return slot && slot->logger.load(std::memory_order_acquire);
         }
-        // 添加日志器
+        // 添加日志器，同名的已存在时不替换
         void AddLogger(const AsyncLogger::ptr &&AsyncLogger)
         {
-            if (LoggerExist(AsyncLogger->Name()))
-                return;
             std::unique_lock<std::mutex> lock(mtx_);
-            loggers_.insert(std::make_pair(AsyncLogger->Name(), AsyncLogger));
+            LoggerSlot *slot = Slot(AsyncLogger->Name());
+            if (slot->logger.load(std::memory_order_relaxed))
+                return;
+            slot->owner = AsyncLogger;
+            slot->logger.store(AsyncLogger.get(), std::memory_order_release);
         }
-        // 获取日志器
+        // 获取日志器，返回的智能指针会增加一次引用计数，频繁调用的地方用 GetHandle
         AsyncLogger::ptr GetLogger(const std::string &name)
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            auto it = loggers_.find(name);
-            if (it == loggers_.end())
+            LoggerSlot *slot = Find(name);
+            if (slot == nullptr || slot->logger.load(std::memory_order_acquire) == nullptr)
                 return AsyncLogger::ptr();
-            return it->second;
+            return slot->owner;
+        }
+        // 获取日志器句柄，名字还没注册也会返回可用的句柄
+        LoggerHandle GetHandle(const std::string &name)
+        {
+            LoggerSlot *slot = Find(name);
+            if (slot == nullptr)
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                slot = Slot(name);
+            }
+            return LoggerHandle(slot, default_logger_.get());
         }
         // 获取默认日志器
         AsyncLogger::ptr DefaultLogger() { return default_logger_; }
 
     private:
-        // 构造函数 
+        using Snapshot = std::unordered_map<std::string, LoggerSlot *>;
+
+        // 构造函数
         LoggerManager()
         {
+            snapshots_.emplace_back(new Snapshot);
+            snapshot_.store(snapshots_.back().get());
             std::unique_ptr<LoggerBuilder> builder(new LoggerBuilder()); // 创建日志器构建器
-            builder->BuildLoggerName("default"); // 设置日志器名称      
-            default_logger_ = builder->Build(); // 构建日志器   
-            loggers_.insert(std::make_pair("default", default_logger_)); // 插入默认日志器  
+            builder->BuildLoggerName("default"); // 设置日志器名称
+            default_logger_ = builder->Build(); // 构建日志器
+            AddLogger(AsyncLogger::ptr(default_logger_)); // 插入默认日志器
+        }
+        // 在当前快照中查找，不加锁
+        LoggerSlot *Find(const std::string &name)
+        {
+            const Snapshot *snapshot = snapshot_.load(std::memory_order_acquire);
+            auto it = snapshot->find(name);
+            return it == snapshot->end() ? nullptr : it->second;
+        }
+        // 查找或创建名字对应的位置，持有 mtx_ 时调用
+        LoggerSlot *Slot(const std::string &name)
+        {
+            LoggerSlot *slot = Find(name);
+            if (slot)
+                return slot;
+            slots_.emplace_back(new LoggerSlot);
+            slot = slots_.back().get();
+            std::unique_ptr<Snapshot> next(new Snapshot(*snapshot_.load(std::memory_order_relaxed)));
+            next->emplace(name, slot);
+            snapshot_.store(next.get(), std::memory_order_release);
+            snapshots_.push_back(std::move(next));
+            return slot;
         }
 
     private:
-        std::mutex mtx_;
-        AsyncLogger::ptr default_logger_;                              // 默认日志器
-        std::unordered_map<std::string, AsyncLogger::ptr> loggers_; // 存放日志器
+        std::mutex mtx_;                                    // 只在写时使用
+        AsyncLogger::ptr default_logger_;                   // 默认日志器
+        std::vector<std::unique_ptr<LoggerSlot>> slots_;    // 所有位置
+        std::vector<std::unique_ptr<Snapshot>> snapshots_;  // 发布过的所有快照
+        std::atomic<const Snapshot *> snapshot_;            // 当前快照
     };
-}
\ No newline at end of file
+}
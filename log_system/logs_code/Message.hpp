@@ -1,9 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
 
+#include "Format.hpp"
 #include "Level.hpp"
+#include "Structured.hpp"
+#include "Timestamp.hpp"
 #include "Util.hpp"
 
 namespace mylog
@@ -11,38 +17,116 @@ namespace mylog
   struct LogMessage
   {
     using ptr = std::shared_ptr<LogMessage>;
-    // 构造函数
+    // 构造函数，只保存指针，不拷贝字符串
     LogMessage() = default;
-    LogMessage(LogLevel::value level, std::string file, size_t line,
-               std::string name, std::string payload)
-        : name_(name),
+    LogMessage(LogLevel::value level, const char *file, size_t line,
+               const char *name, std::string_view payload = std::string_view())
+        : line_(line),
+          ctime_(Util::Date::NowNs()),
           file_name_(file),
+          name_(name),
           payload_(payload),
-          level_(level),
-          line_(line),
-          ctime_(Util::Date::Now()),
-          tid_(std::this_thread::get_id()) {}
-    // 格式化日志消息
-    std::string format()
-    {
-      std::stringstream ret;
-      // 获取当前时间
-      struct tm t;
-      localtime_r(&ctime_, &t);
-      char buf[128];
-      strftime(buf, sizeof(buf), "%H:%M:%S", &t);
-      std::string tmp1 = '[' + std::string(buf) + "][";
-      std::string tmp2 = '[' + std::string(LogLevel::ToString(level_)) + "][" + name_ + "][" + file_name_ + ":" + std::to_string(line_) + "]\t" + payload_ + "\n";
-      ret << tmp1 << tid_ << tmp2;
-      return ret.str();
+          tid_(std::this_thread::get_id()),
+          level_(level) {}
+    // 把日志头部直接写入 writer，格式为 [时:分:秒.微秒][线程id][等级][日志器][文件:行号]\t
+    void FormatHead(FixedWriter &writer) const
+    {
+      std::string tid;
+      FormatHead(writer, ctime_, TidString(&tid), level_, name_, file_name_, line_);
+    }
+    // 文本格式的一整条记录(不含换行)：头部、信息体，再接 key=value 字段
+    void FormatText(FixedWriter &writer, const Field *fields, size_t count) const
+    {
+      FormatHead(writer);
+      writer.Append(payload_.data(), payload_.size());
+      AppendTextFields(writer, fields, count);
+    }
+    // JSON 格式的一整条记录(不含换行)，头部各项在前，信息体为 msg，之后是各字段：
+    // {"ts_ns":...,"tid":"...","level":"INFO","logger":"...","file":"...","line":12,"msg":"...",...}
+    void FormatJson(FixedWriter &writer, const Field *fields, size_t count) const
+    {
+      std::string tid;
+      JsonWriter json(writer);
+      json.Add("ts_ns", MakeArg(ctime_));
+      json.Add("tid", MakeArg(TidString(&tid)));
+      json.Add("level", MakeArg(LogLevel::ToString(level_)));
+      json.Add("logger", MakeArg(name_));
+      json.Add("file", MakeArg(file_name_));
+      json.Add("line", MakeArg(line_));
+      json.Add("msg", MakeArg(payload_));
+      for (size_t i = 0; i < count; ++i)
+        json.Add(fields[i]);
+      json.End();
+    }
+    // 按字段写日志头部，后台解码二进制日志时也用它生成同样的文本格式
+    static void FormatHead(FixedWriter &writer, uint64_t ctime, const char *tid,
+                           LogLevel::value level, const char *name,
+                           const char *file, size_t line)
+    {
+      writer.Append('[');
+      TimestampCache::Append(writer, ctime);
+      writer.Append("][", 2);
+      writer.Append(tid);
+      writer.Append("][", 2);
+      writer.Append(LogLevel::ToString(level));
+      writer.Append("][", 2);
+      writer.Append(name);
+      writer.Append("][", 2);
+      writer.Append(file);
+      writer.Append(':');
+      writer.AppendNumber(line);
+      writer.Append("]\t", 2);
+    }
+    // 日志头部长度的上界
+    size_t MaxHeadSize() const
+    {
+      // [时间 15][线程id 最长20][等级 5][日志器][文件:行号 最长20]\t 以及括号分隔符
+      return 15 + 20 + 5 + strlen(name_) + strlen(file_name_) + 20 + 16;
+    }
+    // 带字段的整条记录在两种格式下长度的上界
+    size_t MaxRecordSize(const Field *fields, size_t count) const
+    {
+      return MaxEscapedSize(MaxHeadSize() + payload_.size()) + MaxFieldsSize(fields, count);
+    }
+    // 格式化日志消息，返回完整的一行，兼容旧接口
+    std::string format() const
+    {
+      char buf[1024];
+      FixedWriter writer(buf, sizeof(buf));
+      FormatHead(writer);
+      std::string ret(writer.Data(), writer.Size());
+      ret.append(payload_.data(), payload_.size());
+      ret += '\n';
+      return ret;
+    }
+    // 记录所属线程id的字符串形式，不是当前线程时转换到 buf 中
+    const char *TidString(std::string *buf) const
+    {
+      if (tid_ == std::this_thread::get_id())
+        return ThreadIdString();
+      std::stringstream ss;
+      ss << tid_;
+      *buf = ss.str();
+      return buf->c_str();
+    }
+    // 当前线程id的字符串形式，每个线程只转换一次
+    static const char *ThreadIdString()
+    {
+      thread_local std::string tid = []()
+      {
+        std::stringstream ss;
+        ss << std::this_thread::get_id();
+        return ss.str();
+      }();
+      return tid.c_str();
     }
 
-    size_t line_;           // 行号
-    time_t ctime_;          // 时间
-    std::string file_name_; // 文件名
-    std::string name_;      // 日志器名
-    std::string payload_;   // 信息体
-    std::thread::id tid_;   // 线程id
-    LogLevel::value level_; // 等级
+    size_t line_;              // 行号
+    uint64_t ctime_;           // 时间，纳秒
+    const char *file_name_;    // 文件名
+    const char *name_;         // 日志器名
+    std::string_view payload_; // 信息体
+    std::thread::id tid_;      // 线程id
+    LogLevel::value level_;    // 等级
   };
-} // namespace mylog
\ No newline at end of file
+} // namespace mylog
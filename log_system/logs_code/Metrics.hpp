@@ -0,0 +1,195 @@
+/*日志流水线运行指标设计*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mylog
+{
+    // 把 target 更新为它与 value 中较大的一个
+    inline void AtomicMax(std::atomic<uint64_t> &target, uint64_t value)
+    {
+        uint64_t cur = target.load(std::memory_order_relaxed);
+        while (cur < value && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // 分条计数器：每个线程固定累加到其中一条，各条独占一个缓存行，读的时候把各条加起来。
+    // 多个生产者同时计数时基本不会争抢同一个缓存行
+    class StripedCounter
+    {
+    public:
+        static const size_t kStripes = 16;
+
+        void Add(uint64_t n) { stripes_[Stripe()].value.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t Read() const
+        {
+            uint64_t sum = 0;
+            for (auto &stripe : stripes_)
+                sum += stripe.value.load(std::memory_order_relaxed);
+            return sum;
+        }
+
+    private:
+        // 线程第一次计数时按顺序分配一条
+        static size_t Stripe()
+        {
+            static std::atomic<size_t> next(0);
+            thread_local size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % kStripes;
+            return stripe;
+        }
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> value{0};
+        };
+        Slot stripes_[kStripes];
+    };
+
+    // 耗时分布的快照，单位纳秒
+    struct HistogramSnapshot
+    {
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;            // 区间快照(Since)中为0
+        std::vector<uint64_t> buckets;  // 桶 i 为 [2^(i-1), 2^i) 纳秒，桶0只有0
+
+        uint64_t MeanNs() const { return count ? sum_ns / count : 0; }
+        // 第 p(0~100) 百分位所在桶的上界，不超过 max_ns
+        uint64_t PercentileNs(double p) const
+        {
+            if (count == 0)
+                return 0;
+            uint64_t rank = static_cast<uint64_t>(count * p / 100);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); ++i)
+            {
+                seen += buckets[i];
+                if (seen > rank || seen == count)
+                {
+                    uint64_t upper = i == 0 ? 0 : (1ULL << i) - 1;
+                    return max_ns && upper > max_ns ? max_ns : upper;
+                }
+            }
+            return max_ns;
+        }
+        // 与更早的快照相减，得到这段时间内的分布
+        HistogramSnapshot Since(const HistogramSnapshot &prev) const
+        {
+            HistogramSnapshot delta;
+            delta.count = count - prev.count;
+            delta.sum_ns = sum_ns - prev.sum_ns;
+            delta.buckets = buckets;
+            for (size_t i = 0; i < prev.buckets.size() && i < delta.buckets.size(); ++i)
+                delta.buckets[i] -= prev.buckets[i];
+            return delta;
+        }
+    };
+
+    // 耗时分布：按 2 的幂分桶，记录时只做几次 relaxed 原子加，读时得到快照。
+    // 只在慢路径上记录(生产者等待、写出一批、同步)，不需要分条
+    class Histogram
+    {
+    public:
+        static const size_t kBuckets = 40; // 最大的桶从约 275 秒开始
+
+        void Record(uint64_t ns)
+        {
+            size_t bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+            if (bucket >= kBuckets)
+                bucket = kBuckets - 1;
+            buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+            sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            AtomicMax(max_ns_, ns);
+        }
+        // 记录从 begin 到现在的耗时
+        void RecordSince(std::chrono::steady_clock::time_point begin)
+        {
+            Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+        }
+        HistogramSnapshot Read() const
+        {
+            HistogramSnapshot snapshot;
+            snapshot.count = count_.load(std::memory_order_relaxed);
+            snapshot.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+            snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+            snapshot.buckets.resize(kBuckets);
+            for (size_t i = 0; i < kBuckets; ++i)
+                snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+            return snapshot;
+        }
+
+    private:
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_ns_{0};
+        std::atomic<uint64_t> max_ns_{0};
+        std::atomic<uint64_t> buckets_[kBuckets] = {};
+    };
+
+    // 日志器的运行指标快照
+    struct MetricsSnapshot
+    {
+        uint64_t messages;                         // 写入缓冲区的日志条数
+        uint64_t bytes;                            // 写入缓冲区的字节数
+        HistogramSnapshot producer_wait;           // 生产者因缓冲区写满等待的时间
+        uint64_t high_water_bytes;                 // 后台线程一次取走的最多字节数
+        uint64_t swaps;                            // 后台线程取走数据的批数
+        std::vector<HistogramSnapshot> sink_flush; // 各落地方向写出一批的耗时，与添加顺序一致
+        HistogramSnapshot sync;                    // 同步到存储的耗时
+        uint64_t dropped;                          // 溢出策略丢弃的日志条数
+        uint64_t sink_dropped_batches;             // 独立线程的落地方向丢弃的批数
+    };
+
+    // 日志器的运行指标，各分片、各落地方向的线程共同更新，读的时候汇总
+    class LoggerMetrics
+    {
+    public:
+        using ptr = std::shared_ptr<LoggerMetrics>;
+
+        explicit LoggerMetrics(size_t sinks) : high_water_(0), swaps_(0), sink_flush_(sinks) {}
+
+        // 生产者提交一条日志
+        void Written(size_t len)
+        {
+            messages_.Add(1);
+            bytes_.Add(len);
+        }
+        // 后台线程取走一批数据
+        void Swapped(size_t len)
+        {
+            swaps_.fetch_add(1, std::memory_order_relaxed);
+            AtomicMax(high_water_, len);
+        }
+        Histogram &ProducerWait() { return producer_wait_; }
+        Histogram &SinkFlush(size_t i) { return sink_flush_[i]; }
+        Histogram &Sync() { return sync_; }
+
+        MetricsSnapshot Read() const
+        {
+            MetricsSnapshot snapshot;
+            snapshot.messages = messages_.Read();
+            snapshot.bytes = bytes_.Read();
+            snapshot.producer_wait = producer_wait_.Read();
+            snapshot.high_water_bytes = high_water_.load(std::memory_order_relaxed);
+            snapshot.swaps = swaps_.load(std::memory_order_relaxed);
+            for (auto &flush : sink_flush_)
+                snapshot.sink_flush.push_back(flush.Read());
+            snapshot.sync = sync_.Read();
+            snapshot.dropped = 0;
+            snapshot.sink_dropped_batches = 0;
+            return snapshot;
+        }
+
+    private:
+        StripedCounter messages_;
+        StripedCounter bytes_;
+        Histogram producer_wait_;
+        std::atomic<uint64_t> high_water_;
+        std::atomic<uint64_t> swaps_;
+        std::vector<Histogram> sink_flush_;
+        Histogram sync_;
+    };
+} // namespace mylog
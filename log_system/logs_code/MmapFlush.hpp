@@ -0,0 +1,218 @@
+/*基于内存映射的文件落地设计*/
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "LogFlush.hpp"
+
+namespace mylog
+{
+    // 映射文件的文件头，位于文件开头，其后是日志文本
+    struct MmapHeader
+    {
+        char magic[16];     // kMmapMagic
+        uint64_t committed; // 已完整写入的日志字节数(不含文件头)，每批数据拷贝完才更新
+        char reserved[39];
+        char newline; // 文件头以换行结尾，用文本工具查看时只多出一行
+    };
+    static_assert(sizeof(MmapHeader) == 64, "MmapHeader 必须是64字节");
+    const char kMmapMagic[16] = "MYLOG-MMAP-V1";
+
+    // 文件输出，不经过 stdio：文件按窗口大小用 fallocate 预先分配，映射一个大窗口，
+    // 每批数据直接 memcpy 进映射区，拷贝完再更新文件头里的已提交长度。
+    // 映射区的数据在页缓存中，进程被 SIGKILL 也不会丢；重新打开时按已提交长度截掉预分配的空白和
+    // 写了一半的数据。flush_log 为2时按 SyncPolicy 发起回写和 fdatasync(对映射写入的脏页同样有效)。
+    // 查看时跳过64字节的文件头即可：tail -c +65 文件名
+    class MmapFileFlush : public LogFlush
+    {
+    public:
+        using ptr = std::shared_ptr<MmapFileFlush>;
+
+        MmapFileFlush(const std::string &filename)
+            : filename_(filename),
+              window_size_(RoundToPage(g_conf_data->mmap_window_size)),
+              header_(nullptr),
+              window_(nullptr),
+              window_start_(0),
+              window_end_(0),
+              pos_(sizeof(MmapHeader))
+        {
+            Util::File::CreateDirectory(Util::File::Path(filename));
+            fd_ = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd_ < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "open log file failed" << std::endl;
+                perror(NULL);
+                return;
+            }
+            if (!Recover())
+            {
+                close(fd_);
+                fd_ = -1;
+                return;
+            }
+            window_start_ = window_end_ = pos_; // 第一次写入时再映射窗口
+            sync_.Reset(fd_, pos_);
+        }
+        ~MmapFileFlush()
+        {
+            if (fd_ < 0)
+                return;
+            Sync();
+            if (window_)
+                munmap(window_, window_end_ - window_start_);
+            munmap(header_, sizeof(MmapHeader));
+            // 正常关闭时去掉预分配的空白
+            if (ftruncate(fd_, pos_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "truncate log file failed" << std::endl;
+                perror(NULL);
+            }
+            close(fd_);
+        }
+
+        void Flush(const char *data, size_t len) override
+        {
+            if (fd_ < 0)
+                return;
+            size_t total = len;
+            while (len > 0)
+            {
+                if (pos_ == window_end_ && !Remap())
+                    return;
+                size_t n = window_end_ - pos_;
+                if (n > len)
+                    n = len;
+                memcpy(window_ + (pos_ - window_start_), data, n);
+                pos_ += n;
+                data += n;
+                len -= n;
+            }
+            // 整批拷贝完才推进已提交长度，崩溃时文件头之后不会有半批数据被当成有效日志
+            __atomic_store_n(&header_->committed, pos_ - sizeof(MmapHeader), __ATOMIC_RELEASE);
+            if (g_conf_data->flush_log == 2)
+                sync_.Written(total);
+        }
+        void Sync() override
+        {
+            if (fd_ >= 0 && g_conf_data->flush_log == 2)
+                sync_.Sync();
+        }
+        bool SetSyncLatency(std::shared_ptr<Histogram> latency) override
+        {
+            sync_.SetLatency(std::move(latency));
+            return true;
+        }
+
+    private:
+        static size_t RoundToPage(size_t size)
+        {
+            size_t page = sysconf(_SC_PAGESIZE);
+            if (size < page)
+                size = page;
+            return (size + page - 1) / page * page;
+        }
+        // 映射文件头；已有文件按已提交长度截断，新文件写入文件头
+        bool Recover()
+        {
+            struct stat st;
+            if (fstat(fd_, &st) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "stat log file failed" << std::endl;
+                perror(NULL);
+                return false;
+            }
+            if (st.st_size != 0 && st.st_size < static_cast<off_t>(sizeof(MmapHeader)))
+            {
+                std::cout << __FILE__ << __LINE__ << "not a mmap log file: " << filename_ << std::endl;
+                return false;
+            }
+            if (st.st_size == 0 && ftruncate(fd_, sizeof(MmapHeader)) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "truncate log file failed" << std::endl;
+                perror(NULL);
+                return false;
+            }
+            void *mem = mmap(NULL, sizeof(MmapHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (mem == MAP_FAILED)
+            {
+                std::cout << __FILE__ << __LINE__ << "mmap log file failed" << std::endl;
+                perror(NULL);
+                return false;
+            }
+            header_ = static_cast<MmapHeader *>(mem);
+            if (st.st_size == 0)
+            {
+                memset(header_, ' ', sizeof(MmapHeader));
+                memcpy(header_->magic, kMmapMagic, sizeof(kMmapMagic));
+                header_->committed = 0;
+                header_->newline = '\n';
+                return true;
+            }
+            if (memcmp(header_->magic, kMmapMagic, sizeof(kMmapMagic)) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "not a mmap log file: " << filename_ << std::endl;
+                munmap(header_, sizeof(MmapHeader));
+                return false;
+            }
+            pos_ = sizeof(MmapHeader) + header_->committed;
+            if (pos_ > static_cast<size_t>(st.st_size)) // 文件头损坏，以实际长度为准
+                pos_ = st.st_size;
+            // 截掉上次崩溃留下的预分配空白和未提交的数据
+            if (ftruncate(fd_, pos_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "truncate log file failed" << std::endl;
+                perror(NULL);
+                return false;
+            }
+            header_->committed = pos_ - sizeof(MmapHeader);
+            return true;
+        }
+        // 当前窗口写满，预分配并映射从 pos_ 开始的下一个窗口
+        bool Remap()
+        {
+            if (window_)
+                munmap(window_, window_end_ - window_start_);
+            window_ = nullptr;
+            size_t page = sysconf(_SC_PAGESIZE);
+            window_start_ = pos_ / page * page;
+            window_end_ = window_start_ + window_size_;
+            int ret = fallocate(fd_, 0, window_start_, window_size_);
+            if (ret != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) // 文件系统不支持预分配
+                ret = ftruncate(fd_, window_end_);
+            if (ret != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "fallocate log file failed" << std::endl;
+                perror(NULL);
+                window_start_ = window_end_ = pos_;
+                return false;
+            }
+            void *mem = mmap(NULL, window_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, window_start_);
+            if (mem == MAP_FAILED)
+            {
+                std::cout << __FILE__ << __LINE__ << "mmap log file failed" << std::endl;
+                perror(NULL);
+                window_start_ = window_end_ = pos_;
+                return false;
+            }
+            window_ = static_cast<char *>(mem);
+            return true;
+        }
+
+    private:
+        std::string filename_;
+        int fd_;
+        const size_t window_size_; // 每次映射的窗口大小，页对齐
+        MmapHeader *header_;       // 映射的文件头
+        char *window_;             // 当前映射窗口
+        size_t window_start_;      // 当前窗口对应的文件偏移
+        size_t window_end_;
+        size_t pos_;      // 下一次写入的文件偏移
+        SyncPolicy sync_; // 持久化策略
+    };
+} // namespace mylog
@@ -1,5 +1,13 @@
 #pragma once
 #include "Manager.hpp"
+#include "MmapFlush.hpp"
+#include "UringFlush.hpp"
+
+// 编译期日志等级：低于它的日志宏在预处理阶段就被裁掉，参数也不会求值。
+// 0-DEBUG 1-INFO 2-WARN 3-ERROR 4-FATAL，编译时用 -DMYLOG_ACTIVE_LEVEL=1 去掉所有 DEBUG 日志
+#ifndef MYLOG_ACTIVE_LEVEL
+#define MYLOG_ACTIVE_LEVEL 0
+#endif
 namespace mylog
 {
     // 用户获取日志器
@@ -7,20 +15,162 @@ namespace mylog
     {
         return LoggerManager::GetInstance().GetLogger(name);
     }
+    // 用户获取日志器句柄，解析一次后可以缓存在静态变量里反复使用，例：
+    // static mylog::LoggerHandle logger = mylog::GetLoggerHandle("asynclogger");
+    LoggerHandle GetLoggerHandle(const std::string &name)
+    {
+        return LoggerManager::GetInstance().GetHandle(name);
+    }
     // 用户获取默认日志器
     AsyncLogger::ptr DefaultLogger() { return LoggerManager::GetInstance().DefaultLogger(); }
 
-// 简化用户使用，宏函数默认填上文件名+行号
+// 简化用户使用，宏函数默认填上文件名+行号，printf 风格，保留用于兼容。
+// 被编译期等级裁掉的宏变成对空函数 NoLog 的调用，参数被丢弃
+#if MYLOG_ACTIVE_LEVEL <= 0
 #define Debug(fmt, ...) Debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...) Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warn(fmt, ...) Warn(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Error(fmt, ...) Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Fatal(fmt, ...) Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
-// 无需获取日志器，默认标准输出
 #define LOGDEBUGDEFAULT(fmt, ...) mylog::DefaultLogger()->Debug(fmt, ##__VA_ARGS__)
+#else
+#define Debug(fmt, ...) NoLog()
+#define LOGDEBUGDEFAULT(fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 1
+#define Info(fmt, ...) Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define LOGINFODEFAULT(fmt, ...) mylog::DefaultLogger()->Info(fmt, ##__VA_ARGS__)
+#else
+#define Info(fmt, ...) NoLog()
+#define LOGINFODEFAULT(fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 2
+#define Warn(fmt, ...) Warn(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define LOGWARNDEFAULT(fmt, ...) mylog::DefaultLogger()->Warn(fmt, ##__VA_ARGS__)
+#else
+#define Warn(fmt, ...) NoLog()
+#define LOGWARNDEFAULT(fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 3
+#define Error(fmt, ...) Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define LOGERRORDEFAULT(fmt, ...) mylog::DefaultLogger()->Error(fmt, ##__VA_ARGS__)
+#else
+#define Error(fmt, ...) NoLog()
+#define LOGERRORDEFAULT(fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 4
+#define Fatal(fmt, ...) Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define LOGFATALDEFAULT(fmt, ...) mylog::DefaultLogger()->Fatal(fmt, ##__VA_ARGS__)
+#else
+#define Fatal(fmt, ...) NoLog()
+#define LOGFATALDEFAULT(fmt, ...) ((void)0)
+#endif
+
+// 类型安全的格式化接口，fmt 必须是字符串字面量，用 {} 作占位符，
+// 占位符个数与参数类型在编译期检查，格式化过程不申请堆内存。
+// 每个调用点静态定义一个 LogSite，二进制模式下只记录它的编号。
+// 运行时等级在求值参数之前检查，编译期等级之下的调用整体被裁掉
+// 例：LOGINFO(mylog::GetLogger("asynclogger"), "upload {} bytes to {}", len, path);
+//     频繁调用时传入缓存的 LoggerHandle，免去每次查表和引用计数
+#define MYLOG_SITE(level, fmt) ([]() -> const mylog::LogSite & { static const mylog::LogSite site(level, __FILE__, __LINE__, fmt); return site; }())
+#define MYLOG_LOG(logger, level, fmt, ...)                                                                      \
+    do                                                                                                          \
+    {                                                                                                           \
+        auto &&mylog_logger_ = (logger);                                                                        \
+        if (mylog_logger_->ShouldLog(level))                                                                    \
+            mylog_logger_->Log<mylog::CountPlaceholders(fmt)>(MYLOG_SITE(level, fmt), ##__VA_ARGS__);           \
+    } while (0)
+// 结构化日志：msg 为固定的信息体，后面跟若干 mylog::KV("key", value) 字段，
+// 文本格式下写成 msg key=value ...，日志器为 JSON 格式时每条一行 JSON 对象
+// 例：LOGINFOKV(logger, "upload", mylog::KV("url", path), mylog::KV("bytes", len));
+#define MYLOG_LOG_KV(logger, level, msg, ...)                                                                   \
+    do                                                                                                          \
+    {                                                                                                           \
+        auto &&mylog_logger_ = (logger);                                                                        \
+        if (mylog_logger_->ShouldLog(level))                                                                    \
+            mylog_logger_->LogFields(MYLOG_SITE(level, msg), ##__VA_ARGS__);                                    \
+    } while (0)
+// 调用点限流：每 interval_ms 毫秒最多写 burst 条，其余调用不求值参数直接返回，
+// 下一次放行时先写一条被压下的条数；调用点之后不再被调用时，由后台线程在窗口结束后写出。
+// 适合磁盘写满、远端不可用时会反复触发的错误
+// 例：LOGERRORLIMIT(logger, 5, 1000, "write {} failed: {}", path, strerror(errno));
+#define MYLOG_LOG_LIMIT(logger, level, burst, interval_ms, fmt, ...)                                            \
+    do                                                                                                          \
+    {                                                                                                           \
+        auto &&mylog_logger_ = (logger);                                                                        \
+        static mylog::SiteLimiter mylog_limiter_(burst, interval_ms);                                           \
+        uint64_t mylog_suppressed_ = 0;                                                                         \
+        if (mylog_logger_->ShouldLog(level) && mylog_limiter_.Admit(&mylog_suppressed_))                        \
+        {                                                                                                       \
+            const mylog::LogSite &mylog_site_ = MYLOG_SITE(level, fmt);                                         \
+            mylog_logger_->Watch(mylog_limiter_, mylog_site_);                                                  \
+            if (mylog_suppressed_)                                                                              \
+                mylog_logger_->LogSuppressed(mylog_site_, mylog_suppressed_, false);                            \
+            mylog_logger_->Log<mylog::CountPlaceholders(fmt)>(mylog_site_, ##__VA_ARGS__);                      \
+        }                                                                                                       \
+    } while (0)
+// 重复日志折叠：interval_ms 毫秒内参数与上一条相同的调用只计数，参数变化或超过间隔时
+// 先写一条 "last message repeated K times" 再写出本条；之后不再被调用时由后台线程在间隔过去后写出。
+// 参数会求值并计算哈希，但不格式化
+// 例：LOGERRORDEDUP(logger, 10000, "backup {} unreachable", addr);
+#define MYLOG_LOG_DEDUP(logger, level, interval_ms, fmt, ...)                                                   \
+    do                                                                                                          \
+    {                                                                                                           \
+        auto &&mylog_logger_ = (logger);                                                                        \
+        static mylog::SiteDedup mylog_dedup_(interval_ms);                                                      \
+        if (mylog_logger_->ShouldLog(level))                                                                    \
+            mylog_logger_->LogDedup<mylog::CountPlaceholders(fmt)>(mylog_dedup_, MYLOG_SITE(level, fmt),        \
+                                                                   ##__VA_ARGS__);                              \
+    } while (0)
+#if MYLOG_ACTIVE_LEVEL <= 0
+#define LOGDEBUG(logger, fmt, ...) MYLOG_LOG(logger, mylog::LogLevel::value::DEBUG, fmt, ##__VA_ARGS__)
+#define LOGDEBUGKV(logger, msg, ...) MYLOG_LOG_KV(logger, mylog::LogLevel::value::DEBUG, msg, ##__VA_ARGS__)
+#define LOGDEBUGLIMIT(logger, burst, interval_ms, fmt, ...) MYLOG_LOG_LIMIT(logger, mylog::LogLevel::value::DEBUG, burst, interval_ms, fmt, ##__VA_ARGS__)
+#define LOGDEBUGDEDUP(logger, interval_ms, fmt, ...) MYLOG_LOG_DEDUP(logger, mylog::LogLevel::value::DEBUG, interval_ms, fmt, ##__VA_ARGS__)
+#else
+#define LOGDEBUG(logger, fmt, ...) ((void)0)
+#define LOGDEBUGKV(logger, msg, ...) ((void)0)
+#define LOGDEBUGLIMIT(logger, burst, interval_ms, fmt, ...) ((void)0)
+#define LOGDEBUGDEDUP(logger, interval_ms, fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 1
+#define LOGINFO(logger, fmt, ...) MYLOG_LOG(logger, mylog::LogLevel::value::INFO, fmt, ##__VA_ARGS__)
+#define LOGINFOKV(logger, msg, ...) MYLOG_LOG_KV(logger, mylog::LogLevel::value::INFO, msg, ##__VA_ARGS__)
+#define LOGINFOLIMIT(logger, burst, interval_ms, fmt, ...) MYLOG_LOG_LIMIT(logger, mylog::LogLevel::value::INFO, burst, interval_ms, fmt, ##__VA_ARGS__)
+#define LOGINFODEDUP(logger, interval_ms, fmt, ...) MYLOG_LOG_DEDUP(logger, mylog::LogLevel::value::INFO, interval_ms, fmt, ##__VA_ARGS__)
+#else
+#define LOGINFO(logger, fmt, ...) ((void)0)
+#define LOGINFOKV(logger, msg, ...) ((void)0)
+#define LOGINFOLIMIT(logger, burst, interval_ms, fmt, ...) ((void)0)
+#define LOGINFODEDUP(logger, interval_ms, fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 2
+#define LOGWARN(logger, fmt, ...) MYLOG_LOG(logger, mylog::LogLevel::value::WARN, fmt, ##__VA_ARGS__)
+#define LOGWARNKV(logger, msg, ...) MYLOG_LOG_KV(logger, mylog::LogLevel::value::WARN, msg, ##__VA_ARGS__)
+#define LOGWARNLIMIT(logger, burst, interval_ms, fmt, ...) MYLOG_LOG_LIMIT(logger, mylog::LogLevel::value::WARN, burst, interval_ms, fmt, ##__VA_ARGS__)
+#define LOGWARNDEDUP(logger, interval_ms, fmt, ...) MYLOG_LOG_DEDUP(logger, mylog::LogLevel::value::WARN, interval_ms, fmt, ##__VA_ARGS__)
+#else
+#define LOGWARN(logger, fmt, ...) ((void)0)
+#define LOGWARNKV(logger, msg, ...) ((void)0)
+#define LOGWARNLIMIT(logger, burst, interval_ms, fmt, ...) ((void)0)
+#define LOGWARNDEDUP(logger, interval_ms, fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 3
+#define LOGERROR(logger, fmt, ...) MYLOG_LOG(logger, mylog::LogLevel::value::ERROR, fmt, ##__VA_ARGS__)
+#define LOGERRORKV(logger, msg, ...) MYLOG_LOG_KV(logger, mylog::LogLevel::value::ERROR, msg, ##__VA_ARGS__)
+#define LOGERRORLIMIT(logger, burst, interval_ms, fmt, ...) MYLOG_LOG_LIMIT(logger, mylog::LogLevel::value::ERROR, burst, interval_ms, fmt, ##__VA_ARGS__)
+#define LOGERRORDEDUP(logger, interval_ms, fmt, ...) MYLOG_LOG_DEDUP(logger, mylog::LogLevel::value::ERROR, interval_ms, fmt, ##__VA_ARGS__)
+#else
+#define LOGERROR(logger, fmt, ...) ((void)0)
+#define LOGERRORKV(logger, msg, ...) ((void)0)
+#define LOGERRORLIMIT(logger, burst, interval_ms, fmt, ...) ((void)0)
+#define LOGERRORDEDUP(logger, interval_ms, fmt, ...) ((void)0)
+#endif
+#if MYLOG_ACTIVE_LEVEL <= 4
+#define LOGFATAL(logger, fmt, ...) MYLOG_LOG(logger, mylog::LogLevel::value::FATAL, fmt, ##__VA_ARGS__)
+#define LOGFATALKV(logger, msg, ...) MYLOG_LOG_KV(logger, mylog::LogLevel::value::FATAL, msg, ##__VA_ARGS__)
+#define LOGFATALLIMIT(logger, burst, interval_ms, fmt, ...) MYLOG_LOG_LIMIT(logger, mylog::LogLevel::value::FATAL, burst, interval_ms, fmt, ##__VA_ARGS__)
+#define LOGFATALDEDUP(logger, interval_ms, fmt, ...) MYLOG_LOG_DEDUP(logger, mylog::LogLevel::value::FATAL, interval_ms, fmt, ##__VA_ARGS__)
+#else
+#define LOGFATAL(logger, fmt, ...) ((void)0)
+#define LOGFATALKV(logger, msg, ...) ((void)0)
+#define LOGFATALLIMIT(logger, burst, interval_ms, fmt, ...) ((void)0)
+#define LOGFATALDEDUP(logger, interval_ms, fmt, ...) ((void)0)
+#endif
 } // namespace mylog
\ No newline at end of file
@@ -0,0 +1,173 @@
+/*无锁多生产者单消费者(MPSC)环形缓冲区设计，单生产者时即为SPSC*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace mylog
+{
+    // 有界字节环：生产者通过 CAS 推进 head_ 预留一段连续空间(reserve)，
+    // 在预留空间内直接写数据，写完后把记录头的状态置为已提交(commit)；
+    // 唯一的消费者从 tail_ 开始按顺序读取已提交的记录，遇到未提交的记录就停下。
+    // 环中每条记录都以 Slot 记录头开始，占用空间按 Slot 大小对齐。
+    class RingBuffer
+    {
+    public:
+        RingBuffer(size_t capacity)
+            : capacity_(RoundUp(capacity)),
+              mask_(capacity_ - 1),
+              buffer_(new char[capacity_]()), // 全部置零，零即为 kFree
+              head_(0),
+              tail_(0) {}
+
+        // 预留 len 字节的连续空间，成功返回可写指针，空间不足返回 nullptr
+        char *TryReserve(size_t len)
+        {
+            size_t need = Align(sizeof(Slot) + len);
+            if (need > MaxRecord())
+                return nullptr;
+            uint64_t pos = head_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                size_t offset = pos & mask_;
+                size_t room = capacity_ - offset; // 到环尾的连续空间
+                // 环尾放不下则用一条填充记录占满环尾，从环头开始写
+                size_t total = need <= room ? need : room + need;
+                if (pos + total - tail_.load(std::memory_order_acquire) > capacity_)
+                    return nullptr;
+                if (head_.compare_exchange_weak(pos, pos + total,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_relaxed))
+                {
+                    if (total != need)
+                    {
+                        Slot *pad = SlotAt(offset);
+                        pad->span = room;
+                        __atomic_store_n(&pad->state, kPadding, __ATOMIC_RELEASE);
+                        offset = 0;
+                    }
+                    Slot *slot = SlotAt(offset);
+                    slot->span = need;
+                    slot->len = len;
+                    return reinterpret_cast<char *>(slot + 1);
+                }
+            }
+        }
+        // 提交 TryReserve 得到的记录，len 可以小于预留长度
+        void Commit(char *data, size_t len)
+        {
+            Slot *slot = reinterpret_cast<Slot *>(data) - 1;
+            slot->len = len;
+            __atomic_store_n(&slot->state, kCommitted, __ATOMIC_RELEASE);
+        }
+        // 按顺序消费已提交的记录，对每条记录调用 func(data, len)，
+        // 累计消费超过 max_bytes 或遇到未提交的记录时停止，返回消费的字节数
+        template <typename Func>
+        size_t Consume(Func &&func, size_t max_bytes = SIZE_MAX)
+        {
+            const char *data;
+            size_t len, bytes = 0;
+            while (bytes < max_bytes && Peek(&data, &len))
+            {
+                func(data, len);
+                bytes += len;
+                Pop();
+            }
+            return bytes;
+        }
+        // 查看下一条已提交的记录但不移出，没有则返回 false
+        bool Peek(const char **data, size_t *len)
+        {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            while (tail < head_.load(std::memory_order_acquire))
+            {
+                Slot *slot = SlotAt(tail & mask_);
+                uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+                if (state == kFree) // 已预留但生产者还没提交
+                    return false;
+                if (state == kCommitted)
+                {
+                    *data = reinterpret_cast<const char *>(slot + 1);
+                    *len = slot->len;
+                    return true;
+                }
+                tail = Release(slot, tail); // 跳过填充记录
+            }
+            return false;
+        }
+        // 移出 Peek 返回的记录
+        void Pop()
+        {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            Release(SlotAt(tail & mask_), tail);
+        }
+        // 判断是否为空(包括已预留未提交的记录)
+        bool IsEmpty()
+        {
+            return head_.load(std::memory_order_acquire) ==
+                   tail_.load(std::memory_order_acquire);
+        }
+        // 环中已占用的字节数(包括已预留未提交的记录)
+        size_t Size()
+        {
+            return head_.load(std::memory_order_acquire) -
+                   tail_.load(std::memory_order_acquire);
+        }
+        // 生产者预留到的位置与消费者读到的位置，单调递增，用于判断某一时刻之前写入的记录是否都已取出
+        uint64_t WritePos() { return head_.load(std::memory_order_acquire); }
+        uint64_t ReadPos() { return tail_.load(std::memory_order_acquire); }
+        size_t Capacity() { return capacity_; }
+        // 单条记录能写入的最大长度
+        size_t MaxPayload() { return MaxRecord() - sizeof(Slot); }
+
+    private:
+        enum : uint32_t
+        {
+            kFree = 0,
+            kCommitted = 1,
+            kPadding = 2
+        };
+        // 记录头
+        struct Slot
+        {
+            uint32_t state; // 记录状态，原子读写
+            uint32_t span;  // 整条记录(含记录头)在环中占用的字节数
+            uint32_t len;   // 有效数据长度
+            uint32_t unused;
+        };
+
+        static size_t Align(size_t len)
+        {
+            return (len + sizeof(Slot) - 1) & ~(sizeof(Slot) - 1);
+        }
+        // 容量取 2 的幂，方便用掩码取模
+        static size_t RoundUp(size_t capacity)
+        {
+            size_t size = 4096;
+            while (size < capacity)
+                size <<= 1;
+            return size;
+        }
+        // 最大记录不超过容量的一半，保证填充后总能放下
+        size_t MaxRecord() { return capacity_ / 2; }
+        Slot *SlotAt(size_t offset) { return reinterpret_cast<Slot *>(&buffer_[offset]); }
+        // 归还一条记录占用的空间，返回新的读位置
+        uint64_t Release(Slot *slot, uint64_t tail)
+        {
+            uint32_t span = slot->span;
+            // 记录可能落在旧数据上，整段清零后记录头才能用 kFree 判断
+            memset(slot, 0, span);
+            tail += span;
+            tail_.store(tail, std::memory_order_release);
+            return tail;
+        }
+
+    private:
+        const size_t capacity_;
+        const size_t mask_;
+        std::unique_ptr<char[]> buffer_;
+        alignas(64) std::atomic<uint64_t> head_; // 生产者预留到的位置
+        alignas(64) std::atomic<uint64_t> tail_; // 消费者读到的位置
+    };
+} // namespace mylog
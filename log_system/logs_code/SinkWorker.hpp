@@ -0,0 +1,275 @@
+/*落地方向独立线程的设计*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AsyncBuffer.hpp"
+#include "LogFlush.hpp"
+#include "Metrics.hpp"
+#include "Structured.hpp"
+
+namespace mylog
+{
+    // 落地方向的执行方式及其跟不上时的策略
+    enum class SinkPolicy
+    {
+        INLINE,  // 在异步工作器线程里依次调用，默认方式
+        BLOCK,   // 独立线程，队列满时异步工作器等待它腾出空间
+        DROP,    // 独立线程，队列满时丢弃整批数据并计数
+        DEGRADE  // 独立线程，队列满时只保留整批中 ERROR/FATAL 的行，二进制数据无法筛选时同 DROP
+    };
+
+    // 单个落地方向的积压情况
+    struct SinkStats
+    {
+        size_t queued_bytes;       // 排队中的字节数
+        size_t queued_batches;     // 排队中的批数
+        uint64_t lag_ms;           // 最早一批排队了多久
+        uint64_t written_bytes;    // 已写出的字节数
+        uint64_t dropped_batches;  // 丢弃的批数
+        uint64_t dropped_bytes;    // 丢弃及降级时筛掉的字节数
+        uint64_t degraded_batches; // 降级写出的批数
+    };
+
+    // 分给各落地方向的一批只读数据：前面可以有一段字符串(调用点定义、后台解码出的文本或内部记录)，
+    // 之后是从消费者缓冲区整块接过来的块，不复制数据；最后一个方向写完、释放引用时块才还回块池。
+    // defines 为真表示这段字符串是 RAW 模式的调用点定义，丢弃这批数据时要保留它
+    class SinkData
+    {
+    public:
+        SinkData(std::string text, Buffer *blocks = nullptr, bool defines = false)
+            : text_(std::move(text)), defines_(defines && !text_.empty())
+        {
+            if (!text_.empty())
+                iov_.push_back(iovec{&text_[0], text_.size()});
+            if (blocks)
+            {
+                blocks_.Append(*blocks);
+                blocks_.ToIovec(&iov_);
+            }
+            size_ = text_.size() + blocks_.ReadableSize();
+        }
+        const std::vector<struct iovec> &Iov() const { return iov_; }
+        size_t Size() const { return size_; }
+        const std::string &Text() const { return text_; }
+        bool Defines() const { return defines_; }
+
+    private:
+        std::string text_;
+        bool defines_;
+        Buffer blocks_;
+        std::vector<struct iovec> iov_; // 依次指向 text_ 和各块
+        size_t size_;
+    };
+
+    // 落地方向的工作线程：异步工作器把每批数据做成一份引用计数的只读数据，
+    // 分给所有独立线程的落地方向，各自排队、各自写出，慢的方向不会拖住其他方向。
+    // 带持久化序号的批次(即使数据被丢弃也保留序号)写出后调用 Sync 并推进该方向的已同步序号。
+    // 日志器分片时每个分片各自提交，已同步序号取各分片中最小的
+    class SinkWorker
+    {
+    public:
+        using ptr = std::unique_ptr<SinkWorker>;
+        using Data = std::shared_ptr<const SinkData>;
+
+        // layout 为文本行的格式，降级时据此找出每行的等级；
+        // flush_latency 和 sync_latency 不为空时记录每批写出和同步的耗时
+        SinkWorker(const LogFlush::ptr &sink, SinkPolicy policy, bool text, size_t max_bytes, size_t shards = 1,
+                   Histogram *flush_latency = nullptr, Histogram *sync_latency = nullptr,
+                   RecordLayout layout = RecordLayout::TEXT)
+            : sink_(sink), policy_(policy), text_(text), layout_(layout), max_bytes_(max_bytes),
+              flush_latency_(flush_latency), sync_latency_(sync_latency), stop_(false),
+              queued_(0), shard_synced_(shards, 0), synced_(0), written_(0), dropped_batches_(0), dropped_bytes_(0), degraded_(0),
+              thread_(std::thread(&SinkWorker::ThreadEntry, this)) {}
+        // 把队列中剩余的数据写完再退出
+        ~SinkWorker()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                stop_ = true;
+            }
+            cond_consumer_.notify_all();
+            thread_.join();
+        }
+
+        // 异步工作器线程调用，data 可以为空(只有持久化序号)，sync_seq 为0表示不需要同步，shard 为提交的分片
+        void Submit(Data data, uint64_t sync_seq, size_t shard = 0)
+        {
+            size_t size = data ? data->Size() : 0;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (size > 0 && queued_ + size > max_bytes_ && queued_ > 0)
+                {
+                    if (policy_ == SinkPolicy::BLOCK)
+                        cond_productor_.wait(lock, [&]()
+                                             { return queued_ + size <= max_bytes_ || queued_ == 0; });
+                    else if (policy_ == SinkPolicy::DEGRADE && text_)
+                    {
+                        // 重要的日志很少，保留下来的部分不受队列上限限制
+                        data = KeepSevere(*data);
+                        ++degraded_;
+                        dropped_bytes_ += size - data->Size();
+                        size = data->Size();
+                    }
+                    else
+                    {
+                        // 调用点定义只写一次，丢了这个方向之后的记录就无法离线解码，只丢记录
+                        ++dropped_batches_;
+                        data = data->Defines() ? std::make_shared<SinkData>(data->Text(), nullptr, true) : nullptr;
+                        dropped_bytes_ += size - (data ? data->Size() : 0);
+                        size = data ? data->Size() : 0;
+                    }
+                }
+                if (size == 0 && sync_seq == 0)
+                    return;
+                queue_.push_back(Batch{size ? std::move(data) : nullptr, sync_seq, shard, std::chrono::steady_clock::now()});
+                queued_ += size;
+            }
+            cond_consumer_.notify_one();
+        }
+        // 该方向已同步到存储的持久化序号
+        uint64_t SyncedSeq() { return synced_.load(); }
+        // 等待序号 seq 之前的数据在该方向落盘，超时返回 false
+        bool WaitSynced(uint64_t seq, std::chrono::steady_clock::time_point deadline)
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            return cond_synced_.wait_until(lock, deadline, [&]()
+                                           { return synced_.load() >= seq; });
+        }
+        SinkStats Stats()
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            SinkStats stats;
+            stats.queued_bytes = queued_;
+            stats.queued_batches = queue_.size();
+            stats.lag_ms = queue_.empty() ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - queue_.front().time).count();
+            stats.written_bytes = written_;
+            stats.dropped_batches = dropped_batches_;
+            stats.dropped_bytes = dropped_bytes_;
+            stats.degraded_batches = degraded_;
+            return stats;
+        }
+
+    private:
+        struct Batch
+        {
+            Data data;
+            uint64_t sync_seq;
+            size_t shard;
+            std::chrono::steady_clock::time_point time; // 入队时间，用于计算积压时长
+        };
+
+        // 只保留 ERROR/FATAL 级别的行
+        Data KeepSevere(const SinkData &data) const
+        {
+            std::string kept;
+            for (auto &v : data.Iov())
+            { // 每行都在同一段内
+                std::string_view seg(static_cast<const char *>(v.iov_base), v.iov_len);
+                size_t pos = 0;
+                while (pos < seg.size())
+                {
+                    size_t end = seg.find('\n', pos);
+                    end = end == std::string_view::npos ? seg.size() : end + 1;
+                    if (Severe(seg.substr(pos, end - pos)))
+                        kept.append(seg.data() + pos, end - pos);
+                    pos = end;
+                }
+            }
+            return std::make_shared<SinkData>(std::move(kept));
+        }
+        // 只在本行内查找等级：文本行在头部 [...]\t 中，JSON 行是 msg 之前的 "level" 字段，
+        // 两者都排在信息体前面，取第一次出现的即可，信息体里的同样字样不会被误判
+        bool Severe(std::string_view line) const
+        {
+            if (layout_ == RecordLayout::JSON)
+            {
+                size_t level = line.find("\"level\":\"");
+                if (level == std::string_view::npos)
+                    return false;
+                std::string_view value = line.substr(level + 9);
+                return value.compare(0, 6, "ERROR\"") == 0 || value.compare(0, 6, "FATAL\"") == 0;
+            }
+            std::string_view head = line.substr(0, line.find("]\t"));
+            return head.find("][ERROR][") != std::string_view::npos || head.find("][FATAL][") != std::string_view::npos;
+        }
+
+        void ThreadEntry()
+        {
+            while (true)
+            {
+                Batch batch;
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    cond_consumer_.wait(lock, [&]()
+                                        { return stop_ || !queue_.empty(); });
+                    if (queue_.empty())
+                        return; // stop_ 且已写完
+                    batch = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+                size_t size = batch.data ? batch.data->Size() : 0;
+                auto begin = std::chrono::steady_clock::now();
+                if (size > 0)
+                {
+                    sink_->FlushV(batch.data->Iov().data(), batch.data->Iov().size());
+                    if (flush_latency_)
+                        flush_latency_->RecordSince(begin);
+                }
+                if (batch.sync_seq)
+                {
+                    begin = std::chrono::steady_clock::now();
+                    sink_->Sync();
+                    if (sync_latency_)
+                        sync_latency_->RecordSince(begin);
+                }
+                {
+                    // 写完才从积压中扣除，积压字节数反映还没写出的数据
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    queued_ -= size;
+                    written_ += size;
+                    if (batch.sync_seq)
+                    {
+                        shard_synced_[batch.shard] = batch.sync_seq;
+                        synced_.store(*std::min_element(shard_synced_.begin(), shard_synced_.end()));
+                    }
+                }
+                cond_productor_.notify_one();
+                if (batch.sync_seq)
+                    cond_synced_.notify_all();
+            }
+        }
+
+    private:
+        LogFlush::ptr sink_;
+        const SinkPolicy policy_;
+        const bool text_;        // 数据是否为文本行，决定能否降级筛选
+        const RecordLayout layout_; // 文本行的格式
+        const size_t max_bytes_; // 队列上限
+        Histogram *flush_latency_; // 写出一批的耗时，可以为空
+        Histogram *sync_latency_;  // 同步的耗时，可以为空
+        bool stop_;
+        std::mutex mtx_;
+        std::deque<Batch> queue_;
+        size_t queued_;                 // 排队及正在写的字节数
+        std::vector<uint64_t> shard_synced_; // 各分片的已同步序号
+        std::atomic<uint64_t> synced_;  // 已同步序号，各分片中最小的
+        uint64_t written_;
+        uint64_t dropped_batches_;
+        uint64_t dropped_bytes_;
+        uint64_t degraded_;
+        std::condition_variable cond_productor_; // 等待队列腾出空间
+        std::condition_variable cond_consumer_;  // 等待新数据
+        std::condition_variable cond_synced_;    // 等待持久化
+        std::thread thread_;                     // 必须最后初始化
+    };
+} // namespace mylog
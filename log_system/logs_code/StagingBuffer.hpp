@@ -0,0 +1,218 @@
+/*每个生产者线程独享的暂存缓冲区设计*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "RingBuffer.hpp"
+
+namespace mylog
+{
+    // 单个线程的暂存缓冲区：只有所属线程写、后台线程读的 SPSC 环
+    struct StagingBuffer
+    {
+        StagingBuffer(size_t capacity) : ring(capacity), closed(false), retired(false) {}
+        RingBuffer ring;
+        std::atomic<bool> closed;  // 所属线程已退出，读空后即可回收
+        std::atomic<bool> retired; // 所属注册表已销毁，线程局部表中的条目可以删除
+    };
+
+    // 管理一个异步工作器下所有线程的暂存缓冲区。
+    // 生产者写入时不碰任何共享锁，只有线程第一次写入(注册)时才加锁；
+    // 后台线程把各线程已提交的记录按时间戳归并后交给回调。
+    class StagingRegistry
+    {
+    public:
+        StagingRegistry(size_t capacity)
+            : id_(NextId()), capacity_(capacity), version_(0) {}
+        // 此时已没有生产者在写，标记各线程的暂存缓冲区，线程下次注册时从线程局部表中删除
+        ~StagingRegistry()
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            for (auto &buf : buffers_)
+                buf->retired = true;
+        }
+
+        // 在本线程的暂存缓冲区预留 len 字节，返回可写指针并通过 ring 返回所属的环，满时返回 nullptr
+        char *TryReserve(size_t len, RingBuffer **ring)
+        {
+            RingBuffer &local = Local()->ring;
+            char *slot = local.TryReserve(sizeof(uint64_t) + len);
+            if (slot == nullptr)
+                return nullptr;
+            *ring = &local;
+            return slot + sizeof(uint64_t);
+        }
+        // 提交 TryReserve 得到的记录，时间戳在提交时打上，归并时按它排序
+        static void Commit(RingBuffer *ring, char *data, size_t len)
+        {
+            uint64_t ts = std::chrono::steady_clock::now().time_since_epoch().count();
+            memcpy(data - sizeof(ts), &ts, sizeof(ts));
+            ring->Commit(data - sizeof(ts), sizeof(ts) + len);
+        }
+        // 暂存缓冲区能容纳的最大单条记录
+        size_t MaxPayload() { return Local()->ring.MaxPayload() - sizeof(uint64_t); }
+
+        // 后台线程调用：把各线程已提交的记录按时间戳从小到大归并，
+        // 对每条记录调用 func(data, len)，累计超过 max_bytes 时停止
+        template <typename Func>
+        size_t Drain(Func &&func, size_t max_bytes = SIZE_MAX)
+        {
+            Refresh();
+            size_t bytes = 0;
+            while (bytes < max_bytes)
+            {
+                StagingBuffer *earliest = nullptr;
+                uint64_t min_ts = UINT64_MAX;
+                const char *data;
+                size_t len;
+                for (auto &buf : snapshot_)
+                {
+                    if (!buf->ring.Peek(&data, &len))
+                        continue;
+                    uint64_t ts;
+                    memcpy(&ts, data, sizeof(ts));
+                    if (ts < min_ts)
+                    {
+                        min_ts = ts;
+                        earliest = buf.get();
+                    }
+                }
+                if (earliest == nullptr)
+                    break;
+                earliest->ring.Peek(&data, &len);
+                func(data + sizeof(uint64_t), len - sizeof(uint64_t));
+                bytes += len - sizeof(uint64_t);
+                earliest->ring.Pop();
+            }
+            Reclaim();
+            return bytes;
+        }
+        // 后台线程调用：所有线程的暂存缓冲区是否都为空
+        bool IsEmpty()
+        {
+            Refresh();
+            for (auto &buf : snapshot_)
+                if (!buf->ring.IsEmpty())
+                    return false;
+            return true;
+        }
+        // 后台线程调用：所有线程的暂存缓冲区已占用的字节数之和
+        size_t Size()
+        {
+            Refresh();
+            size_t size = 0;
+            for (auto &buf : snapshot_)
+                size += buf->ring.Size();
+            return size;
+        }
+
+        // 后台线程调用：记下各线程暂存缓冲区当前的写位置
+        void Mark(std::vector<std::pair<std::shared_ptr<StagingBuffer>, uint64_t>> *marks)
+        {
+            Refresh();
+            marks->clear();
+            for (auto &buf : snapshot_)
+                marks->emplace_back(buf, buf->ring.WritePos());
+        }
+        // 后台线程调用：Mark 之前写入的记录是否都已取出
+        static bool Passed(const std::vector<std::pair<std::shared_ptr<StagingBuffer>, uint64_t>> &marks)
+        {
+            for (auto &m : marks)
+                if (m.first->ring.ReadPos() < m.second)
+                    return false;
+            return true;
+        }
+
+    private:
+        using Entry = std::pair<uint64_t, std::shared_ptr<StagingBuffer>>;
+        // 线程退出时把自己的暂存缓冲区标记为关闭，由后台线程读空后回收
+        struct LocalList
+        {
+            std::vector<Entry> entries;
+            ~LocalList()
+            {
+                for (auto &e : entries)
+                    e.second->closed = true;
+            }
+        };
+
+        static uint64_t NextId()
+        {
+            static std::atomic<uint64_t> id(0);
+            return ++id;
+        }
+        // 查找当前线程在本注册表下的暂存缓冲区，没有则创建并注册
+        StagingBuffer *Local()
+        {
+            thread_local LocalList local;
+            thread_local Entry *last = nullptr;
+            if (last && last->first == id_)
+                return last->second.get();
+            for (auto &e : local.entries)
+            {
+                if (e.first == id_)
+                {
+                    last = &e;
+                    return e.second.get();
+                }
+            }
+            // 顺带删除已销毁的注册表留下的条目，长期存活的线程不会一直持有它们的环
+            local.entries.erase(std::remove_if(local.entries.begin(), local.entries.end(),
+                                               [](const Entry &e)
+                                               { return e.second->retired.load(); }),
+                                local.entries.end());
+            auto buf = std::make_shared<StagingBuffer>(capacity_);
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                buffers_.push_back(buf);
+                ++version_;
+            }
+            local.entries.emplace_back(id_, buf);
+            last = &local.entries.back();
+            return buf.get();
+        }
+        // 注册表有变化时刷新后台线程持有的快照
+        void Refresh()
+        {
+            if (snapshot_version_ == version_.load())
+                return;
+            std::unique_lock<std::mutex> lock(mtx_);
+            snapshot_ = buffers_;
+            snapshot_version_ = version_.load();
+        }
+        // 回收所属线程已退出且已读空的暂存缓冲区
+        void Reclaim()
+        {
+            bool dead = false;
+            for (auto &buf : snapshot_)
+                if (buf->closed && buf->ring.IsEmpty())
+                    dead = true;
+            if (!dead)
+                return;
+            std::unique_lock<std::mutex> lock(mtx_);
+            std::vector<std::shared_ptr<StagingBuffer>> alive;
+            for (auto &buf : buffers_)
+                if (!(buf->closed && buf->ring.IsEmpty()))
+                    alive.push_back(buf);
+            buffers_.swap(alive);
+            ++version_;
+        }
+
+    private:
+        const uint64_t id_;     // 注册表编号，区分线程局部表中属于哪个工作器
+        const size_t capacity_; // 每个线程暂存缓冲区的容量
+        std::mutex mtx_;        // 只保护注册与回收
+        std::vector<std::shared_ptr<StagingBuffer>> buffers_;
+        std::atomic<uint64_t> version_;
+        // 以下仅后台线程访问
+        std::vector<std::shared_ptr<StagingBuffer>> snapshot_;
+        uint64_t snapshot_version_ = UINT64_MAX;
+    };
+} // namespace mylog
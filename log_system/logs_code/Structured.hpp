@@ -0,0 +1,267 @@
+/*结构化日志字段与流式 JSON 编码设计*/
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Format.hpp"
+
+namespace mylog
+{
+    // 一条记录的输出格式：TEXT 为原有的 [头部]\t消息 key=value，JSON 为每行一个 JSON 对象
+    enum class RecordLayout
+    {
+        TEXT,
+        JSON
+    };
+
+    // 附加在日志记录上的一个带类型的字段，值只保存指针和长度，不拷贝字符串，
+    // 字符串值必须在日志调用返回前保持有效(日志宏的参数都满足)
+    struct Field
+    {
+        std::string_view key;
+        FormatArg value;
+    };
+
+    // 构造字段，值支持的类型与 {} 占位符相同，不支持的类型在编译期报错
+    template <typename T>
+    Field KV(std::string_view key, const T &value)
+    {
+        return Field{key, MakeArg(value)};
+    }
+
+    // 返回第一个需要 JSON 转义的字节(引号、反斜杠、控制字符)的位置，没有则返回 len。
+    // 支持 SSE2 时每次检查16字节，普通文本基本整段在这里跳过
+    inline size_t FindJsonEscape(const char *data, size_t len)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            // 无符号比较 v <= 0x1f 等价于 min(v, 0x1f) == v
+            __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+            int mask = _mm_movemask_epi8(hit);
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+#endif
+        for (; i < len; ++i)
+        {
+            unsigned char c = data[i];
+            if (c == '"' || c == '\\' || c < 0x20)
+                return i;
+        }
+        return len;
+    }
+
+    // 转义后写入 writer，写到 limit 字节为止：放不下时在 UTF-8 字符边界截断，
+    // 不写半个转义序列，返回是否完整写完
+    inline bool AppendJsonEscaped(FixedWriter &writer, const char *data, size_t len, size_t limit)
+    {
+        static const char kHex[] = "0123456789abcdef";
+        size_t i = 0;
+        while (i < len)
+        {
+            size_t n = FindJsonEscape(data + i, len - i);
+            size_t room = limit > writer.Size() ? limit - writer.Size() : 0;
+            if (n > room)
+            {
+                while (room > 0 && (static_cast<unsigned char>(data[i + room]) & 0xc0) == 0x80)
+                    --room; // 不截断多字节字符
+                writer.Append(data + i, room);
+                return false;
+            }
+            writer.Append(data + i, n);
+            i += n;
+            if (i == len)
+                break;
+            unsigned char c = data[i];
+            char esc[6] = {'\\', static_cast<char>(c), 0, 0, 0, 0};
+            size_t esc_len = 2;
+            switch (c)
+            {
+            case '"':
+            case '\\':
+                break;
+            case '\n':
+                esc[1] = 'n';
+                break;
+            case '\r':
+                esc[1] = 'r';
+                break;
+            case '\t':
+                esc[1] = 't';
+                break;
+            case '\b':
+                esc[1] = 'b';
+                break;
+            case '\f':
+                esc[1] = 'f';
+                break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = kHex[c >> 4];
+                esc[5] = kHex[c & 0xf];
+                esc_len = 6;
+                break;
+            }
+            if (writer.Size() + esc_len > limit)
+                return false;
+            writer.Append(esc, esc_len);
+            ++i;
+        }
+        return true;
+    }
+
+    // 流式 JSON 对象编码器：字段直接写进 FixedWriter，不构造中间对象也不申请内存。
+    // 始终为结尾的 '}' 留出一字节：字符串值放不下时截断，其他字段放不下时整个跳过，
+    // 所以容量不够时输出依然是合法的 JSON
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(FixedWriter &writer)
+            : writer_(writer), limit_(writer.Capacity() - 1), first_(true)
+        {
+            writer_.Append('{');
+        }
+        void Add(std::string_view key, const FormatArg &value)
+        {
+            size_t mark = writer_.Size();
+            if (!Key(key) || !Value(value))
+                writer_.Truncate(mark);
+        }
+        void Add(const Field &field) { Add(field.key, field.value); }
+        void End() { writer_.Append('}'); }
+
+    private:
+        // 写入 ,"key":
+        bool Key(std::string_view key)
+        {
+            if (!first_)
+                writer_.Append(',');
+            writer_.Append('"');
+            if (!AppendJsonEscaped(writer_, key.data(), key.size(), limit_) || writer_.Size() + 2 > limit_)
+                return false;
+            writer_.Append("\":", 2);
+            return true;
+        }
+        bool Value(const FormatArg &arg)
+        {
+            switch (arg.type)
+            {
+            case FormatArg::Type::BOOL:
+                return Raw(arg.b ? "true" : "false");
+            case FormatArg::Type::CHAR:
+                return String(&arg.c, 1);
+            case FormatArg::Type::INT:
+                return Number(arg.i);
+            case FormatArg::Type::UINT:
+                return Number(arg.u);
+            case FormatArg::Type::DOUBLE:
+                if (!std::isfinite(arg.d))
+                    return Raw("null"); // JSON 没有 inf 和 nan
+                return Number(arg.d);
+            case FormatArg::Type::STRING:
+                return String(arg.s.data, arg.s.len);
+            case FormatArg::Type::POINTER:
+            {
+                if (writer_.Size() + 20 > limit_)
+                    return false;
+                writer_.Append("\"0x", 3);
+                writer_.AppendHex(reinterpret_cast<uintptr_t>(arg.p));
+                writer_.Append('"');
+                return Done();
+            }
+            }
+            return false;
+        }
+        bool Raw(const char *str)
+        {
+            size_t len = strlen(str);
+            if (writer_.Size() + len > limit_)
+                return false;
+            writer_.Append(str, len);
+            return Done();
+        }
+        template <typename T>
+        bool Number(T value)
+        {
+            if (writer_.Size() + 24 > limit_) // 与 MaxFormattedSize 中数值的上界一致
+                return false;
+            writer_.AppendNumber(value);
+            return Done();
+        }
+        bool String(const char *data, size_t len)
+        {
+            if (writer_.Size() + 2 > limit_)
+                return false;
+            writer_.Append('"');
+            AppendJsonEscaped(writer_, data, len, limit_ - 1); // 截断时也留出结尾的引号
+            writer_.Append('"');
+            return Done();
+        }
+        bool Done()
+        {
+            first_ = false;
+            return true;
+        }
+
+        FixedWriter &writer_;
+        const size_t limit_; // 字段最多写到这里，之后留给 '}'
+        bool first_;
+    };
+
+    // 文本格式下把字段写成 " key=value"，字符串中有空白、'='、引号或控制字符时加引号并按 JSON 规则转义
+    inline void AppendTextFields(FixedWriter &writer, const Field *fields, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            writer.Append(' ');
+            writer.Append(fields[i].key.data(), fields[i].key.size());
+            writer.Append('=');
+            const FormatArg &arg = fields[i].value;
+            if (arg.type != FormatArg::Type::STRING)
+            {
+                AppendArg(writer, arg);
+                continue;
+            }
+            bool quote = arg.s.len == 0 || FindJsonEscape(arg.s.data, arg.s.len) != arg.s.len ||
+                         memchr(arg.s.data, ' ', arg.s.len) || memchr(arg.s.data, '=', arg.s.len);
+            if (!quote)
+            {
+                writer.Append(arg.s.data, arg.s.len);
+                continue;
+            }
+            writer.Append('"');
+            AppendJsonEscaped(writer, arg.s.data, arg.s.len, writer.Capacity());
+            writer.Append('"');
+        }
+    }
+
+    // 转义后长度的上界：每字节最多变成 \u00XX 共6字节
+    inline size_t MaxEscapedSize(size_t len) { return len * 6; }
+
+    // 字段在两种格式下长度的上界，用于预先在缓冲区中预留空间
+    inline size_t MaxFieldsSize(const Field *fields, size_t count)
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            size += MaxEscapedSize(fields[i].key.size()) + 4; // ,"key": 或 " key="
+            const FormatArg &arg = fields[i].value;
+            size += arg.type == FormatArg::Type::STRING ? MaxEscapedSize(arg.s.len) + 2 : 24;
+        }
+        return size;
+    }
+} // namespace mylog
@@ -0,0 +1,201 @@
+/*调用点限流与重复日志折叠设计*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "Format.hpp"
+#include "Metrics.hpp"
+#include "Util.hpp"
+
+namespace mylog
+{
+    // 取出累计值 total 中还没汇报过的部分，多个线程同时取时每一条只汇报一次
+    inline uint64_t TakeUnreported(uint64_t total, std::atomic<uint64_t> &reported)
+    {
+        uint64_t prev = reported.load(std::memory_order_relaxed);
+        while (prev < total && !reported.compare_exchange_weak(prev, total, std::memory_order_relaxed))
+        {
+        }
+        return prev < total ? total - prev : 0;
+    }
+
+    struct LogSite;
+
+    // 限流和折叠调用点的公共部分：压下的条数和其中已汇报的部分，最近一次放行的时间，
+    // 以及负责补写汇总的日志器。调用点第一次放行时登记到日志器(AsyncLogger::Watch)，
+    // 之后不再被调用时，由该日志器的后台线程在窗口或间隔过去后写出还没汇报的条数
+    class ThrottleSite
+    {
+    public:
+        constexpr ThrottleSite(uint64_t interval_ms, bool repeat)
+            : interval_ms_(interval_ms), repeat_(repeat), last_ms_(0), reported_(0), owner_(nullptr), site_(nullptr) {}
+
+        // 由 owner 负责补写汇总，已有其他日志器负责时返回 false
+        bool Claim(const void *owner, const LogSite *site)
+        {
+            const void *expected = nullptr;
+            if (!owner_.compare_exchange_strong(expected, owner))
+                return false;
+            site_ = site;
+            return true;
+        }
+        bool Owned(const void *owner) const { return owner_.load(std::memory_order_relaxed) == owner; }
+        // 日志器销毁时解除，之后由下一个放行它的日志器负责
+        void Release(const void *owner)
+        {
+            const void *expected = owner;
+            owner_.compare_exchange_strong(expected, nullptr);
+        }
+        const LogSite *Site() const { return site_; }
+        // 为真时汇总写成 "last message repeated K times"，否则是被限流丢掉的条数
+        bool Repeat() const { return repeat_; }
+        // 调用点安静下来的时刻(CoarseMs)：限流为最近一次放行所在窗口的结束，折叠为最近一次放行加间隔
+        uint64_t IdleAt() const
+        {
+            uint64_t last = last_ms_.load(std::memory_order_relaxed);
+            return repeat_ ? last + interval_ms_ : (last / interval_ms_ + 1) * interval_ms_;
+        }
+        // 取出还没汇报的压下条数
+        uint64_t TakeUnreported() { return mylog::TakeUnreported(suppressed_.Read(), reported_); }
+
+    protected:
+        const uint64_t interval_ms_;
+        const bool repeat_;
+        std::atomic<uint64_t> last_ms_;  // 最近一次放行的时间
+        StripedCounter suppressed_;      // 累计压下的条数
+        std::atomic<uint64_t> reported_; // 已汇报的压下条数
+        std::atomic<const void *> owner_;
+        const LogSite *site_; // 登记时写入，之后由 owner 的后台线程读取
+    };
+
+    // 调用点限流：每 interval_ms 毫秒最多放行 burst 条，由日志宏在调用点定义为静态变量。
+    // 窗口编号和窗口内已放行的条数打包在一个原子变量里，被压下的调用只读一次它、
+    // 累加一次分条计数器就返回，日志参数不求值、不格式化、不进缓冲区
+    class SiteLimiter : public ThrottleSite
+    {
+    public:
+        constexpr SiteLimiter(uint32_t burst, uint32_t interval_ms)
+            : ThrottleSite(interval_ms == 0 ? 1 : interval_ms, false),
+              burst_(burst == 0 ? 1 : (burst > kCountMask ? kCountMask : burst)), state_(0) {}
+
+        // 放行时返回 true，suppressed 为上次放行以来被压下的条数
+        bool Admit(uint64_t *suppressed)
+        {
+            uint64_t now = Util::Date::CoarseMs();
+            uint64_t window = now / interval_ms_;
+            uint64_t cur = state_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                uint64_t next;
+                if ((cur >> kCountBits) == window)
+                {
+                    if ((cur & kCountMask) >= burst_)
+                    {
+                        suppressed_.Add(1);
+                        return false;
+                    }
+                    next = cur + 1;
+                }
+                else
+                    next = (window << kCountBits) | 1; // 进入新窗口
+                if (state_.compare_exchange_weak(cur, next, std::memory_order_relaxed))
+                    break;
+            }
+            last_ms_.store(now, std::memory_order_relaxed);
+            *suppressed = TakeUnreported();
+            return true;
+        }
+
+    private:
+        static const int kCountBits = 24;
+        static const uint64_t kCountMask = (1ULL << kCountBits) - 1;
+        const uint64_t burst_;
+        std::atomic<uint64_t> state_; // 高位为窗口编号，低 kCountBits 位为窗口内已放行的条数
+    };
+
+    // 重复日志折叠：与上一条放行的日志参数完全相同、且距它不到 interval_ms 毫秒的调用被折叠，
+    // 参数变化或超过间隔时放行，并先补一条 "last message repeated K times"。
+    // 比较的是参数的哈希，折叠的调用只计算一次哈希，不格式化、不进缓冲区
+    class SiteDedup : public ThrottleSite
+    {
+    public:
+        constexpr explicit SiteDedup(uint32_t interval_ms)
+            : ThrottleSite(interval_ms, true), hash_(0) {}
+
+        // 放行时返回 true，repeated 为上次放行以来折叠掉的条数
+        bool Admit(uint64_t hash, uint64_t *repeated)
+        {
+            uint64_t now = Util::Date::CoarseMs();
+            if (hash == hash_.load(std::memory_order_relaxed) &&
+                now - last_ms_.load(std::memory_order_relaxed) < interval_ms_)
+            {
+                suppressed_.Add(1);
+                return false;
+            }
+            hash_.store(hash, std::memory_order_relaxed);
+            last_ms_.store(now, std::memory_order_relaxed);
+            *repeated = TakeUnreported();
+            return true;
+        }
+
+    private:
+        std::atomic<uint64_t> hash_; // 上一条放行的日志的参数哈希
+    };
+
+    // 参数的哈希(FNV-1a 的变体，字符串按8字节一组)，字符串按内容计算，其余按类型取值计算
+    inline uint64_t HashArgs(const FormatArg *args, size_t count)
+    {
+        const uint64_t kPrime = 1099511628211ULL;
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&](uint64_t value)
+        {
+            hash = (hash ^ value) * kPrime;
+        };
+        for (size_t i = 0; i < count; ++i)
+        {
+            const FormatArg &arg = args[i];
+            mix(static_cast<uint64_t>(arg.type));
+            switch (arg.type)
+            {
+            case FormatArg::Type::BOOL:
+                mix(arg.b);
+                break;
+            case FormatArg::Type::CHAR:
+                mix(static_cast<unsigned char>(arg.c));
+                break;
+            case FormatArg::Type::INT:
+                mix(static_cast<uint64_t>(arg.i));
+                break;
+            case FormatArg::Type::UINT:
+                mix(arg.u);
+                break;
+            case FormatArg::Type::DOUBLE:
+            {
+                uint64_t bits;
+                memcpy(&bits, &arg.d, sizeof(bits));
+                mix(bits);
+                break;
+            }
+            case FormatArg::Type::STRING:
+            {
+                mix(arg.s.len);
+                size_t j = 0;
+                for (; j + 8 <= arg.s.len; j += 8) // 每次取8字节
+                {
+                    uint64_t word;
+                    memcpy(&word, arg.s.data + j, sizeof(word));
+                    mix(word);
+                }
+                for (; j < arg.s.len; ++j)
+                    mix(static_cast<unsigned char>(arg.s.data[j]));
+                break;
+            }
+            case FormatArg::Type::POINTER:
+                mix(reinterpret_cast<uintptr_t>(arg.p));
+                break;
+            }
+        }
+        return hash;
+    }
+} // namespace mylog
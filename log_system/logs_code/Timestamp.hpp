@@ -0,0 +1,44 @@
+/*日志时间戳格式化设计*/
+#pragma once
+#include <cstdint>
+#include <ctime>
+
+#include "Format.hpp"
+
+namespace mylog
+{
+    // 把纳秒时间戳格式化为 HH:MM:SS.uuuuuu。
+    // 每个线程缓存当前这一秒已渲染好的 HH:MM:SS，只有跨秒时才调用 localtime_r，
+    // 避免每条日志都去抢 localtime_r 内部的时区全局锁，同一秒内只需重写微秒部分
+    class TimestampCache
+    {
+    public:
+        static void Append(FixedWriter &writer, uint64_t ns)
+        {
+            thread_local time_t cached_sec = -1;
+            thread_local char cached[8];
+            time_t sec = static_cast<time_t>(ns / 1000000000ULL);
+            if (sec != cached_sec)
+            {
+                struct tm t;
+                localtime_r(&sec, &t);
+                Render2(cached, t.tm_hour);
+                cached[2] = ':';
+                Render2(cached + 3, t.tm_min);
+                cached[5] = ':';
+                Render2(cached + 6, t.tm_sec);
+                cached_sec = sec;
+            }
+            writer.Append(cached, sizeof(cached));
+            writer.Append('.');
+            writer.AppendPadded(ns % 1000000000ULL / 1000, 6);
+        }
+
+    private:
+        static void Render2(char *out, int value)
+        {
+            out[0] = '0' + value / 10;
+            out[1] = '0' + value % 10;
+        }
+    };
+} // namespace mylog
@@ -0,0 +1,464 @@
+/*基于 io_uring 的异步文件落地设计*/
+#pragma once
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LogFlush.hpp"
+
+namespace mylog
+{
+    // 文件输出，写入和同步通过 io_uring 异步提交，后台线程把数据拷进注册好的固定缓冲区、
+    // 提交后立即返回，继续交换缓冲区，只有所有固定缓冲区都在写盘时才等待。
+    // 内核不支持 io_uring 时退化为一个专门做 pwrite 的线程，后台线程同样不阻塞在写文件上。
+    // flush_log 为2时按 sync_bytes/sync_interval_ms 异步提交 fdatasync；Sync 等待之前的写入和同步全部完成
+    class IoUringFileFlush : public LogFlush
+    {
+    public:
+        using ptr = std::shared_ptr<IoUringFileFlush>;
+
+        IoUringFileFlush(const std::string &filename, bool use_uring = true)
+            : filename_(filename),
+              block_size_(g_conf_data->uring_block_size),
+              uring_(false),
+              fixed_(false),
+              stop_(false),
+              inflight_(0),
+              unsynced_(0),
+              last_sync_(std::chrono::steady_clock::now())
+        {
+            Util::File::CreateDirectory(Util::File::Path(filename));
+            fd_ = open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+            if (fd_ < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "open log file failed" << std::endl;
+                perror(NULL);
+                return;
+            }
+            offset_ = lseek(fd_, 0, SEEK_END);
+            blocks_.resize(g_conf_data->uring_depth);
+            for (size_t i = 0; i < blocks_.size(); ++i)
+            {
+                // 按页对齐，注册固定缓冲区时内核要锁定这些页
+                void *mem = nullptr;
+                if (posix_memalign(&mem, 4096, block_size_) != 0)
+                {
+                    std::cout << __FILE__ << __LINE__ << "alloc uring buffer failed" << std::endl;
+                    perror(NULL);
+                    blocks_.resize(i);
+                    break;
+                }
+                blocks_[i].data = static_cast<char *>(mem);
+                free_.push_back(i);
+            }
+            if (use_uring && !blocks_.empty())
+                uring_ = SetupRing();
+            if (!uring_)
+                writer_ = std::thread(&IoUringFileFlush::WriterEntry, this);
+        }
+        ~IoUringFileFlush()
+        {
+            if (fd_ < 0)
+                return; // 打开文件失败时构造函数提前返回，没有创建写线程也没有分配缓冲区
+            Sync();
+            if (uring_)
+            {
+                munmap(sq_ptr_, sq_size_);
+                if (cq_ptr_ != sq_ptr_)
+                    munmap(cq_ptr_, cq_size_);
+                munmap(sqes_, sqes_size_);
+                close(ring_fd_);
+            }
+            else
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    stop_ = true;
+                }
+                cond_work_.notify_all();
+                if (writer_.joinable())
+                    writer_.join();
+            }
+            for (auto &b : blocks_)
+                free(b.data);
+            close(fd_);
+        }
+        // 是否真的在使用 io_uring，false 表示退化成了写线程
+        bool UsingUring() { return uring_; }
+
+        void Flush(const char *data, size_t len) override
+        {
+            if (fd_ < 0 || blocks_.empty())
+                return;
+            while (len > 0)
+            {
+                size_t n = len < block_size_ ? len : block_size_;
+                size_t idx = AcquireBlock();
+                Block &b = blocks_[idx];
+                memcpy(b.data, data, n);
+                b.len = n;
+                b.done = 0;
+                b.offset = offset_;
+                offset_ += n;
+                unsynced_ += n;
+                SubmitWrite(idx);
+                data += n;
+                len -= n;
+            }
+            if (g_conf_data->flush_log == 2 &&
+                (unsynced_ >= g_conf_data->sync_bytes ||
+                 std::chrono::steady_clock::now() - last_sync_ >=
+                     std::chrono::milliseconds(g_conf_data->sync_interval_ms)))
+                SubmitSync();
+        }
+        // 等待之前提交的写入全部完成，flush_log 为2时再同步到磁盘
+        void Sync() override
+        {
+            if (fd_ < 0)
+                return;
+            if (g_conf_data->flush_log == 2 && unsynced_ > 0)
+                SubmitSync();
+            if (uring_)
+            {
+                while (inflight_ > 0)
+                    Reap(1);
+                return;
+            }
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_done_.wait(lock, [&]()
+                            { return queue_.empty() && inflight_ == 0; });
+        }
+        // io_uring 路径记录从提交同步请求到完成的耗时(含排在它前面的写入)，写线程路径记录 fdatasync 本身
+        bool SetSyncLatency(std::shared_ptr<Histogram> latency) override
+        {
+            latency_ = std::move(latency);
+            return true;
+        }
+
+    private:
+        struct Block
+        {
+            char *data = nullptr;
+            size_t len = 0;  // 待写入的长度
+            size_t done = 0; // 已写入的长度，短写时从这里继续
+            off_t offset = 0;
+        };
+        static constexpr uint64_t kSyncTag = UINT64_MAX; // 同步请求的 user_data
+
+        // 取一块空闲的缓冲区，全部在写盘时等待完成
+        size_t AcquireBlock()
+        {
+            if (uring_)
+            {
+                while (free_.empty())
+                    Reap(1);
+                size_t idx = free_.back();
+                free_.pop_back();
+                return idx;
+            }
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_done_.wait(lock, [&]()
+                            { return !free_.empty(); });
+            size_t idx = free_.back();
+            free_.pop_back();
+            return idx;
+        }
+        void SubmitWrite(size_t idx)
+        {
+            if (!uring_)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    queue_.push_back(idx);
+                }
+                cond_work_.notify_one();
+                return;
+            }
+            Block &b = blocks_[idx];
+            io_uring_sqe *sqe = GetSqe();
+            sqe->opcode = fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->fd = fd_;
+            sqe->off = b.offset + b.done;
+            sqe->addr = reinterpret_cast<uint64_t>(b.data + b.done);
+            sqe->len = b.len - b.done;
+            sqe->buf_index = fixed_ ? idx : 0;
+            sqe->user_data = idx;
+            if (!Submit())
+            { // 提交失败，同步写完这块缓冲区
+                WriteBlock(b);
+                free_.push_back(idx);
+            }
+        }
+        // 提交一次 fdatasync，排在之前提交的写入之后执行
+        void SubmitSync()
+        {
+            unsynced_ = 0;
+            last_sync_ = std::chrono::steady_clock::now();
+            if (!uring_)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    queue_.push_back(kSyncTag);
+                }
+                cond_work_.notify_one();
+                return;
+            }
+            io_uring_sqe *sqe = GetSqe();
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->flags = IOSQE_IO_DRAIN;
+            sqe->fd = fd_;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            sqe->user_data = kSyncTag;
+            if (Submit())
+            {
+                sync_submitted_.push_back(last_sync_);
+                return;
+            }
+            if (fdatasync(fd_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                perror(NULL);
+            }
+            if (latency_)
+                latency_->RecordSince(last_sync_);
+        }
+
+        // 以下是 io_uring 路径，只在后台线程调用，不加锁
+        bool SetupRing()
+        {
+            io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            // 每块缓冲区最多一个写请求在途，另外给同步请求留位置
+            ring_fd_ = syscall(__NR_io_uring_setup, blocks_.size() + 4, &p);
+            if (ring_fd_ < 0)
+                return false;
+            sq_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+            cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if (p.features & IORING_FEAT_SINGLE_MMAP)
+                sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+            sq_ptr_ = mmap(0, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring_fd_, IORING_OFF_SQ_RING);
+            cq_ptr_ = sq_ptr_;
+            if (sq_ptr_ != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP))
+                cq_ptr_ = mmap(0, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               ring_fd_, IORING_OFF_CQ_RING);
+            sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe *>(mmap(0, sqes_size_, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+            if (sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes_ == MAP_FAILED)
+            {
+                std::cout << __FILE__ << __LINE__ << "mmap io_uring failed" << std::endl;
+                perror(NULL);
+                close(ring_fd_);
+                return false;
+            }
+            char *sq = static_cast<char *>(sq_ptr_);
+            sq_tail_ = reinterpret_cast<uint32_t *>(sq + p.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<uint32_t *>(sq + p.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<uint32_t *>(sq + p.sq_off.array);
+            char *cq = static_cast<char *>(cq_ptr_);
+            cq_head_ = reinterpret_cast<uint32_t *>(cq + p.cq_off.head);
+            cq_tail_ = reinterpret_cast<uint32_t *>(cq + p.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<uint32_t *>(cq + p.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+            // 注册固定缓冲区，省去每次写入时内核映射用户页的开销；
+            // 失败(如超出锁定内存限制)时仍用普通写请求
+            std::vector<iovec> iovs(blocks_.size());
+            for (size_t i = 0; i < blocks_.size(); ++i)
+            {
+                iovs[i].iov_base = blocks_[i].data;
+                iovs[i].iov_len = block_size_;
+            }
+            fixed_ = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS,
+                             iovs.data(), iovs.size()) == 0;
+            return true;
+        }
+        io_uring_sqe *GetSqe()
+        {
+            uint32_t tail = *sq_tail_;
+            uint32_t idx = tail & sq_mask_;
+            io_uring_sqe *sqe = &sqes_[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sq_array_[idx] = idx;
+            return sqe;
+        }
+        // 提交队尾的一个请求，失败时撤回该请求并返回 false，由调用方同步完成
+        bool Submit()
+        {
+            uint32_t tail = *sq_tail_;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+            ++inflight_;
+            while (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, NULL, 0) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EBUSY) // 完成队列满了，先收割再重试
+                {
+                    Reap(1);
+                    continue;
+                }
+                std::cout << __FILE__ << __LINE__ << "io_uring_enter failed" << std::endl;
+                perror(NULL);
+                // 内核没有取走这个请求，撤回队尾，否则 inflight_ 永远不会归零
+                __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+                --inflight_;
+                return false;
+            }
+            return true;
+        }
+        // 收割完成事件，至少等到 wait 个
+        void Reap(unsigned wait)
+        {
+            if (wait > 0 && __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) == *cq_head_)
+            {
+                if (syscall(__NR_io_uring_enter, ring_fd_, 0, wait, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+                    errno != EINTR)
+                {
+                    std::cout << __FILE__ << __LINE__ << "io_uring_enter failed" << std::endl;
+                    perror(NULL);
+                }
+            }
+            uint32_t head = *cq_head_;
+            while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+            {
+                io_uring_cqe cqe = cqes_[head & cq_mask_];
+                __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+                --inflight_;
+                if (cqe.user_data == kSyncTag)
+                {
+                    if (latency_ && !sync_submitted_.empty()) // 同步请求带 IOSQE_IO_DRAIN，按提交顺序完成
+                        latency_->RecordSince(sync_submitted_.front());
+                    if (!sync_submitted_.empty())
+                        sync_submitted_.pop_front();
+                    if (cqe.res < 0)
+                    {
+                        errno = -cqe.res;
+                        std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                        perror(NULL);
+                    }
+                    continue;
+                }
+                Block &b = blocks_[cqe.user_data];
+                if (cqe.res > 0 && b.done + cqe.res < b.len)
+                { // 短写，提交剩余部分
+                    b.done += cqe.res;
+                    SubmitWrite(cqe.user_data);
+                    head = *cq_head_;
+                    continue;
+                }
+                if (cqe.res == 0 && b.done < b.len) // 零字节写入，用 pwrite 写完剩余部分，仍写不进去时报错
+                    WriteBlock(b);
+                if (cqe.res < 0)
+                {
+                    errno = -cqe.res;
+                    std::cout << __FILE__ << __LINE__ << "write log file failed" << std::endl;
+                    perror(NULL);
+                }
+                free_.push_back(cqe.user_data);
+            }
+        }
+
+        // 以下是退化的写线程路径
+        void WriterEntry()
+        {
+            while (true)
+            {
+                size_t idx;
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    cond_work_.wait(lock, [&]()
+                                    { return stop_ || !queue_.empty(); });
+                    if (queue_.empty())
+                        return;
+                    idx = queue_.front();
+                    queue_.pop_front();
+                    ++inflight_;
+                }
+                if (idx == kSyncTag)
+                {
+                    auto begin = std::chrono::steady_clock::now();
+                    if (fdatasync(fd_) != 0)
+                    {
+                        std::cout << __FILE__ << __LINE__ << "fdatasync failed" << std::endl;
+                        perror(NULL);
+                    }
+                    if (latency_)
+                        latency_->RecordSince(begin);
+                }
+                else
+                    WriteBlock(blocks_[idx]);
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    --inflight_;
+                    if (idx != kSyncTag)
+                        free_.push_back(idx);
+                }
+                cond_done_.notify_all();
+            }
+        }
+        void WriteBlock(Block &b)
+        {
+            while (b.done < b.len)
+            {
+                ssize_t n = pwrite(fd_, b.data + b.done, b.len - b.done, b.offset + b.done);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    std::cout << __FILE__ << __LINE__ << "write log file failed" << std::endl;
+                    perror(NULL);
+                    return;
+                }
+                b.done += n;
+            }
+        }
+
+    private:
+        std::string filename_;
+        int fd_;
+        off_t offset_;            // 下一次写入的文件偏移
+        const size_t block_size_; // 每块缓冲区的大小
+        std::vector<Block> blocks_;
+        std::vector<size_t> free_; // 空闲缓冲区下标
+        bool uring_;               // 是否使用 io_uring
+        bool fixed_;               // 缓冲区是否注册成功
+        // io_uring 的共享队列
+        int ring_fd_ = -1;
+        void *sq_ptr_ = nullptr;
+        void *cq_ptr_ = nullptr;
+        io_uring_sqe *sqes_ = nullptr;
+        size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+        uint32_t *sq_tail_ = nullptr;
+        uint32_t *sq_array_ = nullptr;
+        uint32_t sq_mask_ = 0;
+        uint32_t *cq_head_ = nullptr;
+        uint32_t *cq_tail_ = nullptr;
+        uint32_t cq_mask_ = 0;
+        io_uring_cqe *cqes_ = nullptr;
+        // 写线程路径
+        std::mutex mtx_;
+        std::condition_variable cond_work_; // 有新的写入或同步请求
+        std::condition_variable cond_done_; // 有缓冲区写完
+        std::deque<size_t> queue_;          // 待写入的缓冲区下标，kSyncTag 表示同步
+        bool stop_;
+        std::thread writer_;
+        size_t inflight_; // 已提交未完成的请求数
+        // 持久化策略
+        size_t unsynced_; // 上次同步后提交的字节数
+        std::chrono::steady_clock::time_point last_sync_;
+        std::deque<std::chrono::steady_clock::time_point> sync_submitted_; // io_uring 路径在途同步请求的提交时间
+        std::shared_ptr<Histogram> latency_; // 同步的耗时，可以为空
+    };
+} // namespace mylog
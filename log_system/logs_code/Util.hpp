@@ -3,6 +3,7 @@
 #include <sys/types.h>
 #include <jsoncpp/json/json.h>
 
+#include <cstdint>
 #include <ctime>
 #include <fstream>
 #include <iostream>
@@ -16,6 +17,22 @@ namespace mylog
         {
         public:
             static time_t Now() { return time(nullptr); }
+            // 纳秒级墙上时间。CLOCK_REALTIME 走 vDSO 不陷入内核，
+            // CLOCK_REALTIME_COARSE 虽然更快但精度只有一个时钟节拍(1~4ms)，满足不了亚毫秒级排序
+            static uint64_t NowNs()
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+            }
+            // 毫秒级单调时间，用 CLOCK_MONOTONIC_COARSE 只读一次内核共享页，
+            // 精度一个时钟节拍，供限流这类按窗口计数、每次调用都要取时间的场合
+            static uint64_t CoarseMs()
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+                return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+            }
         };
 
         class File
@@ -176,25 +193,105 @@ namespace mylog
                 Json::Value root;
                 mylog::Util::JsonUtil::UnSerialize(content, &root); // 反序列化，把内容转成jaon value格式
                 buffer_size = root["buffer_size"].asInt64();
-                threshold = root["threshold"].asInt64();
-                linear_growth = root["linear_growth"].asInt64();
+                block_size = root["block_size"].asUInt64();
+                if (block_size == 0)
+                    block_size = 64 * 1024;
+                block_pool_bytes = root.isMember("block_pool_bytes") ? root["block_pool_bytes"].asUInt64() : 64 * 1024 * 1024;
                 flush_log = root["flush_log"].asInt64();
                 backup_addr = root["backup_addr"].asString();
                 backup_port = root["backup_port"].asInt();
                 thread_count = root["thread_count"].asInt();
+                ring_size = root["ring_size"].asUInt64();
+                if (ring_size == 0)
+                    ring_size = buffer_size;
+                log_level = root["log_level"].asString();
+                staging_size = root["staging_size"].asUInt64();
+                if (staging_size == 0)
+                    staging_size = 1024 * 1024;
+                flush_bytes = root["flush_bytes"].asUInt64();
+                if (flush_bytes == 0)
+                    flush_bytes = 64 * 1024;
+                flush_interval_ms = root.isMember("flush_interval_ms") ? root["flush_interval_ms"].asUInt64() : 50;
+                consumer_spin = root.isMember("consumer_spin") ? root["consumer_spin"].asUInt64() : 1000;
+                sync_bytes = root["sync_bytes"].asUInt64();
+                if (sync_bytes == 0)
+                    sync_bytes = 4 * 1024 * 1024;
+                sync_interval_ms = root["sync_interval_ms"].asUInt64();
+                if (sync_interval_ms == 0)
+                    sync_interval_ms = 1000;
+                uring_depth = root["uring_depth"].asUInt64();
+                if (uring_depth == 0)
+                    uring_depth = 8;
+                uring_block_size = root["uring_block_size"].asUInt64();
+                if (uring_block_size == 0)
+                    uring_block_size = 1024 * 1024;
+                mmap_window_size = root["mmap_window_size"].asUInt64();
+                if (mmap_window_size == 0)
+                    mmap_window_size = 64 * 1024 * 1024;
+                roll_period = root["roll_period"].asString();
+                roll_keep_files = root["roll_keep_files"].asUInt64();
+                roll_keep_bytes = root["roll_keep_bytes"].asUInt64();
+                backup_queue_bytes = root["backup_queue_bytes"].asUInt64();
+                if (backup_queue_bytes == 0)
+                    backup_queue_bytes = 4 * 1024 * 1024;
+                backup_spool_dir = root["backup_spool_dir"].asString();
+                if (backup_spool_dir.empty())
+                    backup_spool_dir = "./logfile/backup_spool/";
+                backup_spool_bytes = root["backup_spool_bytes"].asUInt64();
+                if (backup_spool_bytes == 0)
+                    backup_spool_bytes = 256 * 1024 * 1024;
+                backup_segment_bytes = root["backup_segment_bytes"].asUInt64();
+                if (backup_segment_bytes == 0)
+                    backup_segment_bytes = 16 * 1024 * 1024;
+                sink_queue_bytes = root["sink_queue_bytes"].asUInt64();
+                if (sink_queue_bytes == 0)
+                    sink_queue_bytes = 64 * 1024 * 1024;
+                sample_rate = root["sample_rate"].asUInt64();
+                if (sample_rate == 0)
+                    sample_rate = 10;
+                drop_report_interval_ms = root["drop_report_interval_ms"].asUInt64();
+                if (drop_report_interval_ms == 0)
+                    drop_report_interval_ms = 1000;
+                backend_threads = root["backend_threads"].asUInt64();
+                if (backend_threads == 0)
+                    backend_threads = 2;
+                metrics_report_interval_ms = root["metrics_report_interval_ms"].asUInt64();
                 // 读取 config.conf 配置文件，并将 JSON 数据解析到 root 变量
-                // 将 root 的值赋给结构体成员变量，如 buffer_size、threshold 等
+                // 将 root 的值赋给结构体成员变量，如 buffer_size、block_size 等
                 // 错误处理：如果 GetContent() 失败，输出错误并 perror(NULL)
             }
 
         public:
-            size_t buffer_size;   // 缓冲区基础容量
-            size_t threshold;     // 倍数扩容阈值
-            size_t linear_growth; // 线性增长容量
-            size_t flush_log;     // 控制日志同步到磁盘的时机，默认为0, 1调用fflush，2调用fsync
+            size_t buffer_size;   // 缓冲区基础容量，ASYNC_SAFE 及不阻塞的溢出策略下的上限
+            size_t block_size;    // 缓冲区按块增长，每块的大小，未配置时为64KB
+            size_t block_pool_bytes; // 块池最多保留的空闲字节数，多出的块直接释放，未配置时为64MB
+            size_t flush_log;     // 控制日志同步到磁盘的时机，默认为0, 1调用fflush，2按 sync_bytes/sync_interval_ms 成组调用fdatasync
             std::string backup_addr;
             uint16_t backup_port;
             size_t thread_count;
+            size_t ring_size;     // 无锁环形缓冲区容量，未配置时与buffer_size相同
+            size_t staging_size;  // 每个线程暂存缓冲区容量，未配置时为1MB
+            std::string log_level; // 日志器默认的最低日志等级，DEBUG/INFO/WARN/ERROR/FATAL/OFF
+            size_t flush_bytes;       // 后台线程攒够这么多字节就处理一批，未配置时为64KB
+            size_t flush_interval_ms; // 有数据时后台线程最多等待的毫秒数，未配置时为50
+            size_t consumer_spin;     // 后台线程休眠前的自旋次数，未配置时为1000
+            size_t sync_bytes;        // flush_log 为2时，累计写入这么多字节同步一次，未配置时为4MB
+            size_t sync_interval_ms;  // flush_log 为2时，写入后最多这么多毫秒同步一次，未配置时为1000
+            size_t uring_depth;       // IoUringFileFlush 的缓冲区块数，即最多同时在写的请求数，未配置时为8
+            size_t uring_block_size;  // IoUringFileFlush 每块缓冲区的大小，未配置时为1MB
+            size_t mmap_window_size;  // MmapFileFlush 每次预分配并映射的窗口大小，未配置时为64MB
+            std::string roll_period;  // RollFileFlush 按时间滚动的周期，hour/day，未配置时只按大小滚动
+            size_t roll_keep_files;   // RollFileFlush 最多保留的旧文件个数，0为不限
+            size_t roll_keep_bytes;   // RollFileFlush 旧文件(含压缩后的)最多占用的字节数，0为不限
+            size_t backup_queue_bytes; // 远程备份待发送队列的上限，超出后丢弃新记录，未配置时为4MB
+            std::string backup_spool_dir; // 远程备份落盘队列的目录，未配置时为 ./logfile/backup_spool/
+            size_t backup_spool_bytes;    // 落盘队列最多占用的字节数，超出后删除最旧的段，未配置时为256MB
+            size_t backup_segment_bytes;  // 落盘队列单个段文件的大小，未配置时为16MB
+            size_t sink_queue_bytes;      // 使用独立线程的落地方向排队数据的上限，未配置时为64MB
+            size_t sample_rate;             // SAMPLE 溢出策略下 DEBUG/INFO 每多少条保留约一条，未配置时为10
+            size_t drop_report_interval_ms; // 有日志被溢出策略丢弃时，最多每隔多少毫秒写一行汇总，未配置时为1000
+            size_t backend_threads;         // 默认共享后台的线程数，未配置时为2
+            size_t metrics_report_interval_ms; // 每个日志器每隔多少毫秒写一行运行指标，0或未配置时不写
         };
     } // namespace Util
 } // namespace mylog
@@ -0,0 +1,191 @@
+// 备份日志接收端的压力测试：起很多个本地客户端，按备份协议([4字节长度(网络序)][内容])持续发送记录，
+// 同时追踪接收端为本机写出的文件，统计记录/秒和从发送到写入文件的延迟
+// 用法：./loadgen port file [clients] [records_per_client] [interval_us]
+//   file 为接收端写出的本机文件，如 ./backup_logs/127.0.0.1.log
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t kSenderThreads = 8;
+
+uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int Connect(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0)
+    {
+        perror("connect");
+        close(sock);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+bool SendAll(int sock, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(sock, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+// 每个发送线程负责一部分客户端，每轮给每个客户端发一条记录
+void Sender(uint16_t port, size_t first, size_t count, size_t records, size_t interval_us, std::atomic<size_t> *failed)
+{
+    std::vector<int> socks;
+    for (size_t i = 0; i < count; ++i)
+        socks.push_back(Connect(port));
+    char line[256];
+    std::string frame;
+    for (size_t r = 0; r < records; ++r)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (socks[i] < 0)
+            {
+                ++*failed;
+                continue;
+            }
+            int len = snprintf(line, sizeof(line), "loadgen %lu client=%zu seq=%zu [ERROR][loadgen] backup receiver load test record\n",
+                               static_cast<unsigned long>(NowNs()), first + i, r);
+            uint32_t head = htonl(len);
+            frame.assign(reinterpret_cast<const char *>(&head), sizeof(head));
+            frame.append(line, len);
+            if (!SendAll(socks[i], frame))
+            {
+                ++*failed;
+                close(socks[i]);
+                socks[i] = -1;
+            }
+        }
+        if (interval_us > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+    }
+    for (int s : socks)
+        if (s >= 0)
+            close(s);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: %s port file [clients] [records_per_client] [interval_us]\n", argv[0]);
+        return -1;
+    }
+    uint16_t port = atoi(argv[1]);
+    std::string file = argv[2];
+    size_t clients = argc > 3 ? atoi(argv[3]) : 1000;
+    size_t records = argc > 4 ? atoi(argv[4]) : 1000;
+    size_t interval_us = argc > 5 ? atoi(argv[5]) : 0;
+    size_t total = clients * records;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    // 只统计本次运行追加的部分
+    int fd = open(file.c_str(), O_RDONLY | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("open");
+        return -1;
+    }
+    off_t off = lseek(fd, 0, SEEK_END);
+
+    std::atomic<size_t> failed(0);
+    std::atomic<bool> senders_done(false);
+    uint64_t begin = NowNs();
+    std::vector<std::thread> senders;
+    size_t per = (clients + kSenderThreads - 1) / kSenderThreads;
+    for (size_t first = 0; first < clients; first += per)
+        senders.emplace_back(Sender, port, first, std::min(per, clients - first), records, interval_us, &failed);
+
+    // 追踪文件新写入的行，每行的发送时间戳到看到它的时间即为写入延迟
+    std::vector<uint64_t> latency;
+    latency.reserve(total);
+    std::string carry;
+    std::vector<char> buf(1 << 20);
+    uint64_t last_seen = begin, idle_since = 0;
+    std::thread joiner([&]()
+                       { for (auto &t : senders) t.join(); senders_done = true; });
+    while (latency.size() + failed < total)
+    {
+        ssize_t n = pread(fd, buf.data(), buf.size(), off);
+        if (n <= 0)
+        {
+            // 发送结束后5秒内没有新数据就认为剩下的丢了
+            uint64_t now = NowNs();
+            if (!senders_done)
+                idle_since = 0;
+            else if (idle_since == 0)
+                idle_since = now;
+            else if (now - idle_since > 5000000000ULL)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+        idle_since = 0;
+        uint64_t now = NowNs();
+        off += n;
+        carry.append(buf.data(), n);
+        size_t pos = 0, end;
+        while ((end = carry.find('\n', pos)) != std::string::npos)
+        {
+            if (carry.compare(pos, 8, "loadgen ") == 0)
+            {
+                uint64_t sent = strtoull(carry.c_str() + pos + 8, nullptr, 10);
+                latency.push_back(now > sent ? now - sent : 0);
+                last_seen = now;
+            }
+            pos = end + 1;
+        }
+        carry.erase(0, pos);
+    }
+    joiner.join();
+    close(fd);
+
+    double seconds = (last_seen - begin) / 1e9;
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p)
+    { return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, static_cast<size_t>(latency.size() * p))] / 1e3; };
+    printf("clients=%zu records=%zu received=%zu failed=%zu seconds=%.3f\n", clients, total, latency.size(), failed.load(), seconds);
+    printf("records/s=%.0f p50_us=%.1f p99_us=%.1f max_us=%.1f\n",
+           seconds > 0 ? latency.size() / seconds : 0.0, pct(0.5), pct(0.99), pct(1.0));
+    return latency.size() == total ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+// 远程备份的本地落盘队列-发送端
+#pragma once
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../Util.hpp"
+
+namespace mylog
+{
+    // 备份记录先追加到本地的段文件，再由发送线程从读位置开始发往远端，发出后才推进读位置，
+    // 进程崩溃或远端宕机期间的记录在重启/恢复后继续发送(至少一次，读位置落盘前崩溃会重发)。
+    // 段文件名为递增的编号 NNNNNNNNNNNNNNNNNNNN.seg，每条记录为
+    // [4字节长度(网络序)][4字节CRC32(网络序)][内容]，读到长度越界或CRC不符的记录时丢弃该段剩余部分。
+    // 读位置保存在 cursor 文件中。所有段文件总大小超过预算时删除最旧的段。
+    // 只由发送线程访问，不加锁
+    class BackupSpool
+    {
+    public:
+        BackupSpool(const std::string &dir, size_t segment_bytes, size_t budget_bytes)
+            : dir_(dir), segment_bytes_(segment_bytes), budget_bytes_(budget_bytes),
+              fd_(-1), write_seg_(0), write_size_(0), total_(0), read_seg_(0), read_off_(0)
+        {
+            if (dir_.empty() || dir_.back() != '/')
+                dir_ += '/';
+            // 至少保留4个段，删除最旧的段时不至于一次丢掉大半预算
+            if (segment_bytes_ > budget_bytes_ / 4)
+                segment_bytes_ = std::max<size_t>(budget_bytes_ / 4, 4096);
+            Util::File::CreateDirectory(dir_);
+            segs_ = ListSegments();
+            for (auto seg : segs_)
+                total_ += SegmentSize(seg);
+            LoadCursor();
+            // 上次可能在写一半时崩溃，总是从新的段开始追加
+            OpenSegment(std::max<uint64_t>(segs_.empty() ? 1 : segs_.back() + 1, read_seg_ + 1));
+        }
+        ~BackupSpool()
+        {
+            if (fd_ >= 0)
+                close(fd_);
+        }
+
+        // 追加若干条 [4字节长度(网络序)][内容] 格式的记录并落盘，返回因超出预算被删除的记录数
+        size_t Append(const std::string &frames)
+        {
+            if (frames.empty() || fd_ < 0)
+                return 0;
+            size_t dropped = 0;
+            std::string data;
+            for (size_t pos = 0; pos + sizeof(uint32_t) <= frames.size();)
+            {
+                uint32_t len;
+                memcpy(&len, frames.data() + pos, sizeof(len));
+                size_t n = ntohl(len);
+                // 当前段写不下就先写出已转换的部分，换到下一段
+                if (write_size_ + data.size() > 0 && write_size_ + data.size() + kHeadSize + n > segment_bytes_)
+                {
+                    dropped += Write(data);
+                    data.clear();
+                    OpenSegment(write_seg_ + 1);
+                }
+                uint32_t crc = htonl(Crc32(frames.data() + pos + sizeof(len), n));
+                data.append(frames.data() + pos, sizeof(len));
+                data.append(reinterpret_cast<const char *>(&crc), sizeof(crc));
+                data.append(frames.data() + pos + sizeof(len), n);
+                pos += sizeof(len) + n;
+            }
+            dropped += Write(data);
+            return dropped;
+        }
+        // 是否还有未发出的记录
+        bool Unsent() const
+        {
+            return read_seg_ < write_seg_ || read_off_ < write_size_;
+        }
+        // 从读位置开始读出最多约 max_bytes 字节的记录，转换为 [4字节长度][内容] 格式追加到 out，
+        // 返回读出的记录数。读位置不变，发出后调用 Consume
+        size_t Read(std::string *out, size_t max_bytes)
+        {
+            reads_.clear();
+            while (Unsent())
+            {
+                off_t end = read_seg_ == write_seg_ ? write_size_ : SegmentSize(read_seg_);
+                size_t want = std::min<size_t>(end - read_off_, max_bytes + kHeadSize);
+                std::string data;
+                size_t pos = 0, wire = out->size();
+                bool corrupt = want > 0 && !ReadRange(read_seg_, read_off_, want, &data);
+                while (!corrupt && pos + kHeadSize <= data.size())
+                {
+                    uint32_t len, crc;
+                    memcpy(&len, data.data() + pos, sizeof(len));
+                    memcpy(&crc, data.data() + pos + sizeof(len), sizeof(crc));
+                    size_t n = ntohl(len);
+                    if (read_off_ + pos + kHeadSize + n > static_cast<size_t>(end))
+                    {
+                        corrupt = true; // 长度越界，或崩溃时写了一半
+                        break;
+                    }
+                    if (pos + kHeadSize + n > data.size())
+                    {
+                        if (pos > 0)
+                            break;
+                        // 单条记录超过 max_bytes，按记录长度重读
+                        corrupt = !ReadRange(read_seg_, read_off_, kHeadSize + n, &data) || data.size() < kHeadSize + n;
+                        continue;
+                    }
+                    if (ntohl(crc) != Crc32(data.data() + pos + kHeadSize, n))
+                    {
+                        corrupt = true;
+                        break;
+                    }
+                    out->append(data.data() + pos, sizeof(len));
+                    out->append(data.data() + pos + kHeadSize, n);
+                    pos += kHeadSize + n;
+                    reads_.push_back(std::make_pair(out->size() - wire, read_off_ + pos));
+                    if (out->size() - wire >= max_bytes)
+                        break;
+                }
+                if (!reads_.empty())
+                    return reads_.size(); // 损坏的部分留到下次 Read 从它开始时处理
+                if (read_seg_ == write_seg_)
+                {
+                    // 正在追加的段里读不出完整记录，说明剩余部分损坏；换到新段继续追加并跳过它，
+                    // 否则 Unsent() 一直为真，发送线程会空转
+                    std::cout << __FILE__ << __LINE__ << "spool segment " << read_seg_ << " corrupted at " << read_off_ << ", skip the rest" << std::endl;
+                    OpenSegment(write_seg_ + 1);
+                    NextSegment();
+                    return 0;
+                }
+                if (corrupt)
+                    std::cout << __FILE__ << __LINE__ << "spool segment " << read_seg_ << " corrupted at " << read_off_ << ", skip the rest" << std::endl;
+                NextSegment(); // 本段已读完或剩余部分损坏
+            }
+            return 0;
+        }
+        // Read 读出的记录中前 wire_bytes 字节已发出，推进读位置到其中最后一条完整记录之后并落盘
+        void Consume(size_t wire_bytes)
+        {
+            off_t off = -1;
+            for (auto &r : reads_)
+            {
+                if (r.first > wire_bytes)
+                    break;
+                off = r.second;
+            }
+            reads_.clear();
+            if (off < 0)
+                return;
+            read_off_ = off;
+            if (read_seg_ < write_seg_ && read_off_ >= SegmentSize(read_seg_))
+                NextSegment();
+            SaveCursor();
+        }
+
+    private:
+        static constexpr size_t kHeadSize = 2 * sizeof(uint32_t); // 长度和CRC
+
+        // 写入当前段并落盘，返回为腾出预算删除的记录数
+        size_t Write(const std::string &data)
+        {
+            if (data.empty())
+                return 0;
+            size_t dropped = Evict(data.size());
+            if (!WriteAll(data.data(), data.size()))
+            {
+                // 去掉写了一半的记录，后续追加仍从记录边界开始
+                if (ftruncate(fd_, write_size_) != 0)
+                    perror(NULL);
+                return dropped;
+            }
+            write_size_ += data.size();
+            total_ += data.size();
+            // 备份的只有错误和致命级别的记录，每批同步一次的开销可以接受
+            if (fdatasync(fd_) != 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "fdatasync spool failed" << std::endl;
+                perror(NULL);
+            }
+            return dropped;
+        }
+        static uint32_t Crc32(const char *data, size_t len)
+        {
+            static uint32_t table[256] = {0};
+            static bool init = [&]()
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    table[i] = c;
+                }
+                return true;
+            }();
+            (void)init;
+            uint32_t crc = 0xFFFFFFFFu;
+            for (size_t i = 0; i < len; ++i)
+                crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+            return crc ^ 0xFFFFFFFFu;
+        }
+        std::string SegmentName(uint64_t seg) const
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "%020lu.seg", static_cast<unsigned long>(seg));
+            return dir_ + name;
+        }
+        off_t SegmentSize(uint64_t seg) const
+        {
+            if (seg == write_seg_)
+                return write_size_;
+            struct stat st;
+            if (stat(SegmentName(seg).c_str(), &st) != 0)
+                return 0;
+            return st.st_size;
+        }
+        std::vector<uint64_t> ListSegments()
+        {
+            std::vector<uint64_t> segs;
+            DIR *dir = opendir(dir_.c_str());
+            if (dir == nullptr)
+            {
+                std::cout << __FILE__ << __LINE__ << "open spool dir failed" << std::endl;
+                perror(NULL);
+                return segs;
+            }
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != nullptr)
+            {
+                std::string name = entry->d_name;
+                if (name.size() == 24 && name.compare(20, 4, ".seg") == 0)
+                    segs.push_back(strtoull(name.c_str(), nullptr, 10));
+            }
+            closedir(dir);
+            std::sort(segs.begin(), segs.end());
+            return segs;
+        }
+        void OpenSegment(uint64_t seg)
+        {
+            if (fd_ >= 0)
+                close(fd_);
+            fd_ = open(SegmentName(seg).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd_ < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "open spool segment failed" << std::endl;
+                perror(NULL);
+            }
+            write_seg_ = seg;
+            write_size_ = 0;
+            segs_.push_back(seg);
+            if (read_seg_ < segs_.front())
+            {
+                read_seg_ = segs_.front();
+                read_off_ = 0;
+            }
+        }
+        // 读位置所在的段读完，删除它并移到下一段
+        void NextSegment()
+        {
+            if (read_seg_ >= write_seg_)
+                return;
+            RemoveSegment(read_seg_);
+            read_seg_ = segs_.empty() ? write_seg_ : segs_.front();
+            read_off_ = 0;
+            SaveCursor();
+        }
+        void RemoveSegment(uint64_t seg)
+        {
+            total_ -= std::min<size_t>(total_, SegmentSize(seg));
+            unlink(SegmentName(seg).c_str());
+            segs_.erase(std::remove(segs_.begin(), segs_.end(), seg), segs_.end());
+        }
+        // 为 len 字节腾出预算，删除最旧的段，返回其中未发出的记录数
+        size_t Evict(size_t len)
+        {
+            size_t dropped = 0;
+            while (total_ + len > budget_bytes_ && !segs_.empty() && segs_.front() != write_seg_)
+            {
+                uint64_t seg = segs_.front();
+                if (seg >= read_seg_)
+                    dropped += CountRecords(seg, seg == read_seg_ ? read_off_ : 0);
+                RemoveSegment(seg);
+                if (seg >= read_seg_)
+                {
+                    read_seg_ = segs_.front();
+                    read_off_ = 0;
+                    reads_.clear();
+                }
+            }
+            if (dropped > 0)
+                SaveCursor();
+            return dropped;
+        }
+        size_t CountRecords(uint64_t seg, off_t off)
+        {
+            size_t count = 0;
+            int fd = open(SegmentName(seg).c_str(), O_RDONLY);
+            if (fd < 0)
+                return 0;
+            uint32_t len;
+            while (pread(fd, &len, sizeof(len), off) == sizeof(len))
+            {
+                off += kHeadSize + ntohl(len);
+                ++count;
+            }
+            close(fd);
+            return count;
+        }
+        bool ReadRange(uint64_t seg, off_t off, size_t len, std::string *out)
+        {
+            int fd = open(SegmentName(seg).c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "open spool segment failed" << std::endl;
+                perror(NULL);
+                return false;
+            }
+            out->resize(len);
+            size_t got = 0;
+            while (got < len)
+            {
+                ssize_t n = pread(fd, &(*out)[got], len - got, off + got);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                got += n;
+            }
+            close(fd);
+            out->resize(got);
+            return got > 0;
+        }
+        bool WriteAll(const char *data, size_t len)
+        {
+            while (len > 0)
+            {
+                ssize_t n = write(fd_, data, len);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                {
+                    std::cout << __FILE__ << __LINE__ << "write spool segment failed" << std::endl;
+                    perror(NULL);
+                    return false;
+                }
+                data += n;
+                len -= n;
+            }
+            return true;
+        }
+        void LoadCursor()
+        {
+            FILE *fp = fopen((dir_ + "cursor").c_str(), "r");
+            if (fp != nullptr)
+            {
+                unsigned long seg = 0;
+                long off = 0;
+                if (fscanf(fp, "%lu %ld", &seg, &off) == 2)
+                {
+                    read_seg_ = seg;
+                    read_off_ = off;
+                }
+                fclose(fp);
+            }
+            // 读位置所在的段已被删除时从最旧的段开始
+            if (!segs_.empty() && read_seg_ < segs_.front())
+            {
+                read_seg_ = segs_.front();
+                read_off_ = 0;
+            }
+            // 读位置之前的段都已发完
+            while (!segs_.empty() && segs_.front() < read_seg_)
+                RemoveSegment(segs_.front());
+        }
+        // 写临时文件再改名，崩溃时不会留下半个读位置
+        void SaveCursor()
+        {
+            std::string tmp = dir_ + "cursor.tmp";
+            FILE *fp = fopen(tmp.c_str(), "w");
+            if (fp == nullptr)
+            {
+                std::cout << __FILE__ << __LINE__ << "open spool cursor failed" << std::endl;
+                perror(NULL);
+                return;
+            }
+            fprintf(fp, "%lu %ld\n", static_cast<unsigned long>(read_seg_), static_cast<long>(read_off_));
+            fclose(fp);
+            rename(tmp.c_str(), (dir_ + "cursor").c_str());
+        }
+
+    private:
+        std::string dir_;
+        size_t segment_bytes_; // 单个段文件的大小上限
+        size_t budget_bytes_;  // 所有段文件的总大小上限
+        int fd_;               // 正在追加的段
+        uint64_t write_seg_;
+        off_t write_size_;
+        size_t total_;              // 所有段文件的总大小
+        std::vector<uint64_t> segs_; // 现存的段，从旧到新
+        uint64_t read_seg_;         // 下一条要发出的记录的位置
+        off_t read_off_;
+        std::vector<std::pair<size_t, off_t>> reads_; // 上次 Read 每条记录在输出中的结束位置及其段内结束偏移
+    };
+} // namespace mylog
@@ -1,4 +1,5 @@
 // 远程备份debug等级以上的日志信息-发送端
+#pragma once
 #include <iostream>
 #include <cstring>
 #include <string>
@@ -6,49 +7,224 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "../Util.hpp"
+#include "BackupSpool.hpp"
 
 // 全局变量，用于存储配置文件中的数据
 extern mylog::Util::JsonData *g_conf_data;
 
-// 该函数用于启动备份
-void start_backup(const std::string &message)
+namespace mylog
 {
-    // 1. 创建socket
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0)
+    // 远程备份客户端：日志线程只把记录加上4字节长度前缀(网络序)追加到内存队列后立即返回；
+    // 发送线程把队列里积攒的记录整批追加到本地落盘队列 BackupSpool，再从落盘队列的读位置开始
+    // 通过一条长连接成批发往远端，发出后才推进读位置。远端不可达时按指数退避重连，期间记录留在磁盘上，
+    // 进程重启后继续发送，关键日志至少送达一次。
+    // 内存队列超过 backup_queue_bytes、落盘队列超过 backup_spool_bytes 时丢弃记录并计数，
+    // 日志线程永远不会阻塞在网络或磁盘上
+    class BackupClient
     {
-        std::cout << __FILE__ << __LINE__ << "socket error : " << strerror(errno) << std::endl;
-        perror(NULL);
-    }
-    // 2. 创建服务器地址结构体  
-    struct sockaddr_in server;
-    memset(&server, 0, sizeof(server));
-    server.sin_family = AF_INET;
-    server.sin_port = htons(g_conf_data->backup_port);
-    inet_aton(g_conf_data->backup_addr.c_str(), &(server.sin_addr));
-    // 3. 连接服务器
-    int cnt = 5;
-    while (-1 == connect(sock, (struct sockaddr *)&server, sizeof(server)))
-    {
-        std::cout << "正在尝试重连,重连次数还有: " << cnt-- << std::endl;
-        if (cnt <= 0)
+    public:
+        static BackupClient &GetInstance()
+        {
+            static BackupClient client;
+            return client;
+        }
+        // 日志线程调用，只追加到队列
+        void Send(const char *data, size_t len)
         {
-            std::cout << __FILE__ << __LINE__ << "connect error : " << strerror(errno) << std::endl;
-            close(sock);
-            perror(NULL);
-            return;
+            uint32_t head = htonl(static_cast<uint32_t>(len));
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (pending_.size() + sizeof(head) + len > g_conf_data->backup_queue_bytes)
+                {
+                    ++dropped_;
+                    return;
+                }
+                pending_.append(reinterpret_cast<const char *>(&head), sizeof(head));
+                pending_.append(data, len);
+            }
+            cond_.notify_one();
         }
-    }
+        // 因内存队列满或落盘队列超出预算而丢弃的记录数
+        size_t Dropped() { return dropped_.load(); }
+        // 当前的重连间隔(毫秒)，连不上时逐次翻倍，连接成功后回到下限
+        int Backoff() { return backoff_ms_.load(); }
 
-    // 4. 连接成功，发送日志信息    
-    char buffer[1024];
-    if (-1 == write(sock, message.c_str(), message.size()))
-    {
-        std::cout << __FILE__ << __LINE__ << "send to server error : " << strerror(errno) << std::endl;
-        perror(NULL);
-    }
-    close(sock);
-}
\ No newline at end of file
+    private:
+        BackupClient()
+            : sock_(-1),
+              spool_(g_conf_data->backup_spool_dir, g_conf_data->backup_segment_bytes, g_conf_data->backup_spool_bytes),
+              stop_(false),
+              dropped_(0),
+              backoff_ms_(kMinBackoff)
+        {
+            thread_ = std::thread(&BackupClient::SendEntry, this);
+        }
+        ~BackupClient()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            thread_.join();
+            if (sock_ >= 0)
+                close(sock_);
+        }
+
+        void SendEntry()
+        {
+            std::chrono::milliseconds backoff(kMinBackoff);
+            auto retry_at = std::chrono::steady_clock::now();
+            while (true)
+            {
+                std::string batch;
+                bool stopping;
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    if (spool_.Unsent() && sock_ < 0) // 等到下次重连的时间，期间新记录照常落盘
+                        cond_.wait_until(lock, retry_at, [&]()
+                                         { return stop_ || !pending_.empty(); });
+                    else
+                        cond_.wait(lock, [&]()
+                                   { return stop_ || !pending_.empty() || spool_.Unsent(); });
+                    batch.swap(pending_);
+                    stopping = stop_;
+                }
+                // 先落盘再发送
+                dropped_ += spool_.Append(batch);
+                if (spool_.Unsent())
+                {
+                    if (sock_ >= 0 && PeerClosed())
+                    {
+                        // 服务端已关闭，此时写入会被内核接受然后丢掉，先重连
+                        close(sock_);
+                        sock_ = -1;
+                    }
+                    auto now = std::chrono::steady_clock::now();
+                    if (sock_ < 0 && (stopping || now >= retry_at))
+                    {
+                        if (Connect())
+                            backoff = std::chrono::milliseconds(kMinBackoff);
+                        else
+                        {
+                            retry_at = now + backoff;
+                            backoff = std::min(backoff * 2, std::chrono::milliseconds(kMaxBackoff));
+                        }
+                        backoff_ms_ = backoff.count();
+                    }
+                    if (sock_ >= 0)
+                        SendBatch();
+                }
+                // 退出时连不上的记录留在落盘队列中，下次启动继续发送
+                if (stopping && (!spool_.Unsent() || sock_ < 0))
+                    return;
+            }
+        }
+        // 从落盘队列读出一批发出，发送失败时只确认已完整发出的记录
+        void SendBatch()
+        {
+            std::string sending;
+            if (spool_.Read(&sending, kBatchBytes) == 0)
+                return;
+            size_t sent = 0;
+            while (sent < sending.size())
+            {
+                ssize_t n = send(sock_, sending.data() + sent, sending.size() - sent, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    std::cout << __FILE__ << __LINE__ << "send to server error : " << strerror(errno) << std::endl;
+                    close(sock_);
+                    sock_ = -1;
+                    break;
+                }
+                sent += n;
+            }
+            spool_.Consume(sent);
+        }
+        // 服务端不发数据，连接上可读只可能是对端关闭或出错
+        bool PeerClosed()
+        {
+            char c;
+            ssize_t n = recv(sock_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+            return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+        }
+        // 非阻塞连接，最多等待 kConnectTimeout 毫秒
+        bool Connect()
+        {
+            int sock = socket(AF_INET, SOCK_STREAM, 0);
+            if (sock < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "socket error : " << strerror(errno) << std::endl;
+                return false;
+            }
+            struct sockaddr_in server;
+            memset(&server, 0, sizeof(server));
+            server.sin_family = AF_INET;
+            server.sin_port = htons(g_conf_data->backup_port);
+            inet_aton(g_conf_data->backup_addr.c_str(), &(server.sin_addr));
+
+            int flags = fcntl(sock, F_GETFL, 0);
+            fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+            int ret = connect(sock, (struct sockaddr *)&server, sizeof(server));
+            if (ret < 0 && errno == EINPROGRESS)
+            {
+                struct pollfd pfd = {sock, POLLOUT, 0};
+                int err = ETIMEDOUT;
+                socklen_t errlen = sizeof(err);
+                if (poll(&pfd, 1, kConnectTimeout) == 1)
+                    getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &errlen);
+                ret = err == 0 ? 0 : -1;
+                errno = err;
+            }
+            if (ret < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "connect error : " << strerror(errno) << std::endl;
+                close(sock);
+                return false;
+            }
+            fcntl(sock, F_SETFL, flags); // 连接建立后改回阻塞写，发送线程可以等待
+            int one = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            struct timeval tv = {kSendTimeout, 0}; // 远端不再读取时不至于一直卡住，退出时也能结束
+            setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+            sock_ = sock;
+            return true;
+        }
+
+    private:
+        static constexpr int kMinBackoff = 100;     // 重连间隔下限，毫秒
+        static constexpr int kMaxBackoff = 30000;   // 重连间隔上限，毫秒
+        static constexpr int kConnectTimeout = 1000; // 单次连接超时，毫秒
+        static constexpr int kSendTimeout = 5;       // 单次发送超时，秒
+        static constexpr size_t kBatchBytes = 1024 * 1024; // 每次从落盘队列读出发送的字节数
+        int sock_;                  // 以下两个仅发送线程访问
+        BackupSpool spool_;
+        std::mutex mtx_;
+        std::condition_variable cond_;
+        std::string pending_;       // 待发送的记录，每条前面是4字节长度
+        std::atomic<bool> stop_;
+        std::atomic<size_t> dropped_;
+        std::atomic<int> backoff_ms_;
+        std::thread thread_;
+    };
+} // namespace mylog
+
+// 兼容旧接口：把一条日志交给备份客户端，不等待发送
+inline void start_backup(const std::string &message)
+{
+    mylog::BackupClient::GetInstance().Send(message.data(), message.size());
+}
@@ -14,41 +14,16 @@
 using std::cout;
 using std::endl;
 // cout 和 endl 直接使用，避免 std:: 前缀
-const std::string filename = "./logfile.log";
+const std::string dirname = "./backup_logs/"; // 每个客户端的日志追加到该目录下的 ip.log
 // 该函数用于打印使用错误
 void usage(std::string procgress)
 {
-    cout << "usage error:" << procgress << "port" << endl;
-}
-// 该函数用于检查文件是否存在
-bool file_exist(const std::string &name)
-{
-    struct stat exist;
-    return (stat(name.c_str(), &exist) == 0);
-    // stat(name.c_str(), &exist) 获取文件状态，如果返回 0，说明文件存在
-}
-// 该函数用于备份日志
-void backup_log(const std::string &message)//用作回调
-{
-    FILE *fp = fopen(filename.c_str(), "ab");
-    if (fp == NULL)
-    {
-        perror("fopen error: ");
-        assert(false);
-    }
-    int write_byte = fwrite(message.c_str(), 1, message.size(), fp);
-    if (write_byte != message.size())
-    {
-        perror("fwrite error: ");
-        assert(false);
-    }
-    fflush(fp); // 刷新缓冲区，将缓冲区的内容写入文件
-    fclose(fp);
+    cout << "usage error:" << procgress << " port [loops]" << endl;
 }
 // 该函数用于启动备份服务器
 int main(int args, char *argv[])
 {
-    if (args != 2)
+    if (args != 2 && args != 3)
     {
         usage(argv[0]);
         perror("usage error");
@@ -56,12 +31,14 @@ int main(int args, char *argv[])
     }
     // 将字符串转换为整数
     uint16_t port = atoi(argv[1]);
-    // 创建一个 TcpServer 对象，并使用 backup_log 作为回调函数
-    std::unique_ptr<TcpServer> tcp(new TcpServer(port, backup_log));
+    // 事件循环个数，默认与CPU核数相同
+    size_t loops = args == 3 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    std::unique_ptr<TcpServer> tcp(new TcpServer(port, dirname, loops));
     // 初始化服务
-    tcp->init_service();
+    if (!tcp->init_service())
+        exit(-1);
     // 启动服务
     tcp->start_service();
     // 返回 0
     return 0;
-}
\ No newline at end of file
+}
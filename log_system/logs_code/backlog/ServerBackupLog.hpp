@@ -5,132 +5,329 @@
 #include <cstring>
 #include <cerrno>
 #include <cstdlib>
-#include <pthread.h>
-#include <mutex>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 using std::cout;
 using std::endl;
 
-using func_t = std::function<void(const std::string &)>;
-const int backlog = 32;
+const int backlog = 4096;
 
-class TcpServer; // 该类包含客户端的ip和端口信息
-// 该类用于存储线程数据
-class ThreadData
+// 单个连接的状态
+struct Connection
 {
-public:
-    ThreadData(int fd, const std::string &ip, const uint16_t &port, TcpServer *ts)
-        : sock(fd), client_ip(ip), client_port(port), ts_(ts) {}
-
-public:
     int sock;
     std::string client_ip;
     uint16_t client_port;
-    TcpServer *ts_;
+    std::string in; // 已读到但还没凑成完整记录的数据
 };
 
-// 该类用于创建TCP服务器
-class TcpServer
+// 同一客户端(按ip区分)的追加文件，一轮事件里收到的记录先攒在 buf，这一轮处理完再一次写出
+struct ClientFile
+{
+    int fd;
+    std::string buf;
+    bool dirty = false; // 是否已在本轮待写出的列表中
+};
+
+// 一个事件循环：自己的 epoll 和监听 socket(SO_REUSEPORT，由内核把新连接分给各个循环)，
+// 循环之间不共享任何状态
+class EventLoop
 {
 public:
-    TcpServer(uint16_t port, func_t func)
-        : port_(port), func_(func)
+    EventLoop(uint16_t port, const std::string &dir)
+        : port_(port), dir_(dir), listen_sock_(-1), epfd_(-1) {}
+    ~EventLoop()
     {
+        for (auto &c : conns_)
+            close(c.first);
+        for (auto &f : files_)
+            close(f.second.fd);
+        if (listen_sock_ >= 0)
+            close(listen_sock_);
+        if (epfd_ >= 0)
+            close(epfd_);
     }
 
-    // 该函数用于初始化服务
-    void init_service()
+    bool init()
     {
-        // 创建socket
-        listen_sock_ = socket(AF_INET, SOCK_STREAM, 0);
+        listen_sock_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
         if (listen_sock_ == -1)
         {
             std::cout << __FILE__ << __LINE__ << "create socket error" << strerror(errno) << std::endl;
+            return false;
         }
+        int opt = 1; // 重启后可以立即重新绑定端口，客户端据此重连
+        setsockopt(listen_sock_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        setsockopt(listen_sock_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
 
         struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
         local.sin_family = AF_INET;
         local.sin_port = htons(port_);
         local.sin_addr.s_addr = htonl(INADDR_ANY);
-
         if (bind(listen_sock_, (struct sockaddr *)&local, sizeof(local)) < 0)
         {
             std::cout << __FILE__ << __LINE__ << "bind socket error" << strerror(errno) << std::endl;
+            return false;
         }
-
         if (listen(listen_sock_, backlog) < 0)
         {
             std::cout << __FILE__ << __LINE__ << "listen error" << strerror(errno) << std::endl;
+            return false;
         }
+        epfd_ = epoll_create1(0);
+        if (epfd_ < 0)
+        {
+            std::cout << __FILE__ << __LINE__ << "epoll_create error" << strerror(errno) << std::endl;
+            return false;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = listen_sock_;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, listen_sock_, &ev);
+        return true;
     }
 
-    // 该函数用于启动服务
-    static void *threadRoutine(void *args)
+    void run()
     {
-        pthread_detach(pthread_self()); // 让线程 自动释放资源，防止 阻塞 pthread_create()
-
-        ThreadData *td = static_cast<ThreadData *>(args);
-        std::string client_info = td->client_ip + ":" + std::to_string(td->client_port);
-        td->ts_->service(td->sock, move(client_info));
-        close(td->sock);
-        delete td;
-        return nullptr;
+        std::vector<struct epoll_event> events(1024);
+        std::vector<ClientFile *> dirty;
+        while (true)
+        {
+            int n = epoll_wait(epfd_, events.data(), events.size(), -1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cout << __FILE__ << __LINE__ << "epoll_wait error" << strerror(errno) << std::endl;
+                return;
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                if (events[i].data.fd == listen_sock_)
+                    accept_all();
+                else
+                    on_readable(events[i].data.fd, &dirty);
+            }
+            // 这一轮所有连接收到的记录按客户端合并写出
+            for (auto f : dirty)
+            {
+                flush(f);
+                f->dirty = false;
+            }
+            dirty.clear();
+            if (static_cast<size_t>(n) == events.size())
+                events.resize(events.size() * 2);
+        }
     }
 
-    // 该函数用于启动服务
-    void start_service()
+private:
+    static const size_t kReadSize = 64 * 1024;
+    static const size_t kMaxRecord = 16 * 1024 * 1024; // 超过这个长度的记录视为协议错误
+    static const int kReadsPerEvent = 16;              // 一个连接每轮最多读几次，避免饿死其他连接
+    static const size_t kFlushSize = 1024 * 1024;      // 一个客户端攒够这么多不等这一轮结束直接写出
+
+    void accept_all()
     {
         while (true)
         {
             struct sockaddr_in client_addr;
             socklen_t client_addrlen = sizeof(client_addr);
-            int connfd = accept(listen_sock_, (struct sockaddr *)&client_addr, &client_addrlen);
+            int connfd = accept4(listen_sock_, (struct sockaddr *)&client_addr, &client_addrlen, SOCK_NONBLOCK);
             if (connfd < 0)
             {
-                std::cout << __FILE__ << __LINE__ << "accept error" << strerror(errno) << std::endl;
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    std::cout << __FILE__ << __LINE__ << "accept error" << strerror(errno) << std::endl;
+                return;
+            }
+            std::unique_ptr<Connection> conn(new Connection);
+            conn->sock = connfd;
+            conn->client_ip = inet_ntoa(client_addr.sin_addr); // 网络序列转字符串
+            conn->client_port = ntohs(client_addr.sin_port);   // 网络序列转主机序列
+            struct epoll_event ev;
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = connfd;
+            if (epoll_ctl(epfd_, EPOLL_CTL_ADD, connfd, &ev) < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "epoll_ctl error" << strerror(errno) << std::endl;
+                close(connfd);
                 continue;
             }
+            conns_[connfd] = std::move(conn);
+        }
+    }
 
-            // 获取client端信息
-            std::string client_ip = inet_ntoa(client_addr.sin_addr); // 网络序列转字符串
-            uint16_t client_port = ntohs(client_addr.sin_port);      // 网络序列转主机序列
-
-            // 多个线程提供服务
-            // 传入线程数据类型来访问threadRoutine，因为该函数是static的，所以内部传入了data类型存了tcpserver类型
-            pthread_t tid;
-            ThreadData *td = new ThreadData(connfd, client_ip, client_port, this);
-            pthread_create(&tid, nullptr, threadRoutine, td);
+    // 读出连接上的数据，按 [4字节长度(网络序)][内容] 拆出完整记录追加到该客户端文件的缓冲
+    void on_readable(int sock, std::vector<ClientFile *> *dirty)
+    {
+        auto it = conns_.find(sock);
+        if (it == conns_.end())
+            return;
+        Connection *conn = it->second.get();
+        ClientFile *file = get_file(conn->client_ip);
+        if (file == nullptr)
+        {
+            close_conn(sock);
+            return;
+        }
+        char buf[kReadSize];
+        bool closed = false;
+        for (int i = 0; i < kReadsPerEvent; ++i)
+        {
+            ssize_t r_ret = read(sock, buf, sizeof(buf));
+            if (r_ret < 0 && errno == EINTR)
+                continue;
+            if (r_ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (r_ret <= 0) // 客户端断开或出错
+            {
+                if (r_ret < 0)
+                    std::cout << __FILE__ << __LINE__ << "read error" << strerror(errno) << std::endl;
+                closed = true;
+                break;
+            }
+            conn->in.append(buf, r_ret);
+            if (static_cast<size_t>(r_ret) < sizeof(buf))
+                break;
         }
+        size_t pos = 0;
+        while (pos + sizeof(uint32_t) <= conn->in.size())
+        {
+            uint32_t len;
+            memcpy(&len, conn->in.data() + pos, sizeof(len));
+            len = ntohl(len);
+            if (len > kMaxRecord)
+            {
+                std::cout << __FILE__ << __LINE__ << "bad record length from " << conn->client_ip << ":" << conn->client_port << std::endl;
+                closed = true;
+                break;
+            }
+            if (pos + sizeof(len) + len > conn->in.size())
+                break;
+            file->buf.append(conn->in.data() + pos + sizeof(len), len);
+            pos += sizeof(len) + len;
+            if (file->buf.size() >= kFlushSize)
+                flush(file);
+        }
+        conn->in.erase(0, pos);
+        if (!file->dirty && !file->buf.empty())
+        {
+            file->dirty = true;
+            dirty->push_back(file);
+        }
+        if (closed)
+            close_conn(sock);
     }
 
-    // 该函数用于处理客户端请求
-    void service(int sock, const std::string &&client_info)
+    // 每个客户端ip一个追加文件，每个循环各自打开，O_APPEND 保证整批写入不会互相覆盖
+    ClientFile *get_file(const std::string &ip)
     {
-        char buf[1024];
+        auto it = files_.find(ip);
+        if (it != files_.end())
+            return &it->second;
+        std::string name = dir_ + ip + ".log";
+        int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+        {
+            std::cout << __FILE__ << __LINE__ << "open " << name << " error" << strerror(errno) << std::endl;
+            return nullptr;
+        }
+        ClientFile &file = files_[ip];
+        file.fd = fd;
+        return &file;
+    }
 
-        int r_ret = read(sock, buf, sizeof(buf));
-        if (r_ret == -1)
+    void flush(ClientFile *file)
+    {
+        size_t done = 0;
+        while (done < file->buf.size())
         {
-            std::cout << __FILE__ << __LINE__ << "read error" << strerror(errno) << std::endl;
-            perror("NULL");
+            ssize_t n = write(file->fd, file->buf.data() + done, file->buf.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+            {
+                std::cout << __FILE__ << __LINE__ << "write error" << strerror(errno) << std::endl;
+                break;
+            }
+            done += n;
         }
-        else if (r_ret > 0)
+        file->buf.clear();
+    }
+
+    void close_conn(int sock)
+    {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, sock, nullptr);
+        close(sock);
+        conns_.erase(sock);
+    }
+
+private:
+    uint16_t port_;
+    std::string dir_;
+    int listen_sock_;
+    int epfd_;
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_;
+    std::unordered_map<std::string, ClientFile> files_;
+};
+
+// 该类用于创建TCP服务器：loops 个事件循环线程，每个客户端(ip)的记录追加到 dir 下的 ip.log
+class TcpServer
+{
+public:
+    TcpServer(uint16_t port, const std::string &dir, size_t loops)
+        : port_(port), dir_(dir)
+    {
+        if (dir_.empty() || dir_.back() != '/')
+            dir_ += '/';
+        if (loops == 0)
+            loops = 1;
+        for (size_t i = 0; i < loops; ++i)
+            loops_.emplace_back(new EventLoop(port_, dir_));
+    }
+
+    // 该函数用于初始化服务
+    bool init_service()
+    {
+        // 每个连接占一个描述符，上千个客户端需要放开打开文件数的限制
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
         {
-            buf[r_ret] = 0;
-            std::string tmp = buf;
-            func_(client_info + tmp); // 进行回调
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
         }
+        mkdir(dir_.c_str(), 0755);
+        for (auto &loop : loops_)
+            if (!loop->init())
+                return false;
+        return true;
+    }
+
+    // 该函数用于启动服务
+    void start_service()
+    {
+        std::vector<std::thread> threads;
+        for (auto &loop : loops_)
+            threads.emplace_back(&EventLoop::run, loop.get());
+        for (auto &t : threads)
+            t.join();
     }
 
     ~TcpServer() = default;
 
 private:
-    int listen_sock_;
     uint16_t port_;
-    func_t func_;
-};
\ No newline at end of file
+    std::string dir_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+};
@@ -0,0 +1,39 @@
+// 二进制日志离线解码工具：把 BinaryMode::RAW 写出的日志文件还原为文本格式
+// 编译：g++ -std=c++17 -o LogDecoder LogDecoder.cpp -ljsoncpp
+// 用法：./LogDecoder file1 [file2 ...]，滚动产生的每个文件开头都有之前出现过的调用点定义，可以单独解码；
+// 给出多个文件时按时间顺序排列
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "../logs_code/BinaryLog.hpp"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " binary_log_file..." << std::endl;
+        return -1;
+    }
+    mylog::BinaryDecoder decoder; // 调用点定义在多个文件间共享
+    char buf[64 * 1024];
+    std::string out;
+    for (int i = 1; i < argc; ++i)
+    {
+        FILE *fp = fopen(argv[i], "rb");
+        if (fp == NULL)
+        {
+            std::cout << __FILE__ << __LINE__ << "open " << argv[i] << " failed" << std::endl;
+            perror(NULL);
+            continue;
+        }
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        {
+            out.clear();
+            decoder.Decode(buf, n, &out);
+            fwrite(out.data(), 1, out.size(), stdout);
+        }
+        fclose(fp);
+    }
+    return 0;
+}
@@ -27,17 +27,17 @@ namespace storage
         {
             if (ReadConfig() == false)
             {
-                mylog::GetLogger("asynclogger")->Fatal("ReadConfig failed");
+                Logger()->Fatal("ReadConfig failed");
                 return;
             }
-            mylog::GetLogger("asynclogger")->Info("ReadConfig complicate");
+            Logger()->Info("ReadConfig complicate");
         }
 
     public:
         // 读取配置文件信息
         bool ReadConfig()
         {
-            mylog::GetLogger("asynclogger")->Info("ReadConfig start");
+            Logger()->Info("ReadConfig start");
 
             storage::FileUtil fu(Config_File);
             std::string content;
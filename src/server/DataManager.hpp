@@ -16,11 +16,11 @@ namespace storage
         bool NewStorageInfo(const std::string &storage_path)
         {
             // 初始化备份文件的信息
-            mylog::GetLogger("asynclogger")->Info("NewStorageInfo start");
+            Logger()->Info("NewStorageInfo start");
             FileUtil f(storage_path);
             if (!f.Exists())
             {
-                mylog::GetLogger("asynclogger")->Info("file not exists");
+                Logger()->Info("file not exists");
                 return false;
             }
             mtime_ = f.LastAccessTime();
@@ -31,8 +31,8 @@ namespace storage
             // 下载路径前缀+文件名
             storage::Config *config = storage::Config::GetInstance();
             url_ = config->GetDownloadPrefix() + f.FileName();
-            mylog::GetLogger("asynclogger")->Info("download_url:%s,mtime_:%s,atime_:%s,fsize_:%d", url_.c_str(), ctime(&mtime_), ctime(&atime_), fsize_);
-            mylog::GetLogger("asynclogger")->Info("NewStorageInfo end");
+            Logger()->Info("download_url:%s,mtime_:%s,atime_:%s,fsize_:%zu", url_.c_str(), ctime(&mtime_), ctime(&atime_), fsize_);
+            Logger()->Info("NewStorageInfo end");
             return true;
             // 传入 storage_path 作为参数，检查文件是否存在。
             // 使用 FileUtil 获取文件的修改时间、访问时间、大小等信息。
@@ -51,12 +51,12 @@ namespace storage
     public:
         DataManager()
         {
-            mylog::GetLogger("asynclogger")->Info("DataManager construct start");
+            Logger()->Info("DataManager construct start");
             storage_file_ = storage::Config::GetInstance()->GetStorageInfoFile();
             // 从 Config::GetInstance()->GetStorageInfoFile() 读取存储路径
             pthread_rwlock_init(&rwlock_, NULL);
             InitLoad(); // 初始化加载
-            mylog::GetLogger("asynclogger")->Info("DataManager construct end");
+            Logger()->Info("DataManager construct end");
         }
 
         ~DataManager()
@@ -66,11 +66,11 @@ namespace storage
 
         bool InitLoad() // 初始化程序运行时从文件读取数据
         {
-            mylog::GetLogger("asynclogger")->Info("init datamanager");
+            Logger()->Info("init datamanager");
             storage::FileUtil f(storage_file_);
             if (!f.Exists())
             {
-                mylog::GetLogger("asynclogger")->Info("there is no storage file info need to load");
+                Logger()->Info("there is no storage file info need to load");
                 return true;
             }
 
@@ -98,12 +98,12 @@ namespace storage
         bool Storage()
         { // 每次有信息改变则需要持久化存储一次
             // 把table_中的数据转成json格式存入文件
-            mylog::GetLogger("asynclogger")->Info("message storage start");
+            Logger()->Info("message storage start");
             std::vector<StorageInfo> arr;
             // 获取所有存储信息
             if (!GetAll(&arr))
             {
-                mylog::GetLogger("asynclogger")->Warn("GetAll fail,can't get StorageInfo");
+                Logger()->Warn("GetAll fail,can't get StorageInfo");
                 return false;
             }
             // 将存储信息转成json格式
@@ -121,7 +121,7 @@ namespace storage
 
             // 序列化
             std::string body;
-            mylog::GetLogger("asynclogger")->Info("new message for StorageInfo:%s", body.c_str());
+            Logger()->Info("new message for StorageInfo:%s", body.c_str());
             JsonUtil::Serialize(root, &body);
             // 将root中的数据序列化成字符串
 
@@ -129,42 +129,42 @@ namespace storage
             // 写入文件
             if (f.SetContent(body.c_str(), body.size()) == false)
             {
-                mylog::GetLogger("asynclogger")->Error("SetContent for StorageInfo Error");
+                Logger()->Error("SetContent for StorageInfo Error");
                 return false;
             }
 
-            mylog::GetLogger("asynclogger")->Info("message storage end");
+            Logger()->Info("message storage end");
             return true;
         }
         // 该函数用于插入存储信息
         bool Insert(const StorageInfo &info)
         {
-            mylog::GetLogger("asynclogger")->Info("data_message Insert start");
+            Logger()->Info("data_message Insert start");
             pthread_rwlock_wrlock(&rwlock_); // 加写锁
             table_[info.url_] = info;
             pthread_rwlock_unlock(&rwlock_);
             // 持久化存储
             if (Storage() == false)
             {
-                mylog::GetLogger("asynclogger")->Error("data_message Insert:Storage Error");
+                LOGERRORDEDUP(Logger(), 10000, "data_message Insert:Storage Error");
                 return false;
             }
-            mylog::GetLogger("asynclogger")->Info("data_message Insert end");
+            Logger()->Info("data_message Insert end");
             return true;
         }
         // 该函数用于更新存储信息
         bool Update(const StorageInfo &info)
         {
-            mylog::GetLogger("asynclogger")->Info("data_message Update start");
+            Logger()->Info("data_message Update start");
             pthread_rwlock_wrlock(&rwlock_);
             table_[info.url_] = info;
             pthread_rwlock_unlock(&rwlock_);
             if (Storage() == false)
             {
-                mylog::GetLogger("asynclogger")->Error("data_message Update:Storage Error");
+                LOGERRORDEDUP(Logger(), 10000, "data_message Update:Storage Error");
                 return false;
             }
-            mylog::GetLogger("asynclogger")->Info("data_message Update end");
+            Logger()->Info("data_message Update end");
             return true;
         }
         // 通过 URL（key） 查找对应的 StorageInfo
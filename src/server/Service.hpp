@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <chrono>
 #include <regex>
 
 #include "base64.h" // 来自 cpp-base64 库
@@ -24,14 +25,14 @@ namespace storage
         Service()
         {
 #ifdef DEBUG_LOG // 若开启 DEBUG_LOG，则记录日志
-            mylog::GetLogger("asynclogger")->Debug("Service start(Construct)");
+            Logger()->Debug("Service start(Construct)");
 #endif
             server_port_ = Config::GetInstance()->GetServerPort();
             server_ip_ = Config::GetInstance()->GetServerIp();
             download_prefix_ = Config::GetInstance()->GetDownloadPrefix();
             // 获取服务器端口、IP地址和下载前缀
 #ifdef DEBUG_LOG
-            mylog::GetLogger("asynclogger")->Debug("Service end(Construct)");
+            Logger()->Debug("Service end(Construct)");
 #endif
         }
         // 该函数用于初始化服务
@@ -41,7 +42,7 @@ namespace storage
             event_base *base = event_base_new();
             if (base == NULL)
             {
-                mylog::GetLogger("asynclogger")->Fatal("event_base_new err!");
+                Logger()->Fatal("event_base_new err!");
                 return false;
             }
             // 设置监听的端口和地址
@@ -54,7 +55,7 @@ namespace storage
             // 绑定端口和ip
             if (evhttp_bind_socket(httpd, "0.0.0.0", server_port_) != 0)
             {
-                mylog::GetLogger("asynclogger")->Fatal("evhttp_bind_socket failed!");
+                Logger()->Fatal("evhttp_bind_socket failed!");
                 return false;
             }
             // 设定回调函数
@@ -65,11 +66,11 @@ namespace storage
             if (base)
             {
 #ifdef DEBUG_LOG
-                mylog::GetLogger("asynclogger")->Debug("event_base_dispatch");
+                Logger()->Debug("event_base_dispatch");
 #endif
                 if (-1 == event_base_dispatch(base))
                 {
-                    mylog::GetLogger("asynclogger")->Debug("event_base_dispatch err");
+                    Logger()->Debug("event_base_dispatch err");
                 }
             }
             // 释放资源
@@ -91,7 +92,7 @@ namespace storage
         {
             std::string path = evhttp_uri_get_path(evhttp_request_get_evhttp_uri(req));
             path = UrlDecode(path);
-            mylog::GetLogger("asynclogger")->Info("get req, uri: %s", path.c_str());
+            LOGINFO(Logger(), "get req, uri: {}", path); // 二进制记录，后台格式化
 
             // 根据请求中的内容判断是什么请求
             // 这里是下载请求
@@ -118,23 +119,24 @@ namespace storage
         // 该函数用于上传文件
         static void Upload(struct evhttp_request *req, void *arg)
         {
-            mylog::GetLogger("asynclogger")->Info("Upload start");
+            auto begin = std::chrono::steady_clock::now();
+            Logger()->Info("Upload start");
             // 约定：请求中包含"low_storage"，说明请求中存在文件数据,并希望普通存储\
                 包含"deep_storage"字段则压缩后存储
             // 获取请求体内容
             struct evbuffer *buf = evhttp_request_get_input_buffer(req);
             if (buf == nullptr)
             {
-                mylog::GetLogger("asynclogger")->Info("evhttp_request_get_input_buffer is empty");
+                Logger()->Info("evhttp_request_get_input_buffer is empty");
                 return;
             }
 
             size_t len = evbuffer_get_length(buf); // 获取请求体的长度
-            mylog::GetLogger("asynclogger")->Info("evbuffer_get_length is %u", len);
+            Logger()->Info("evbuffer_get_length is %zu", len);
             if (0 == len)
             {
                 evhttp_send_reply(req, HTTP_BADREQUEST, "file empty", NULL);
-                mylog::GetLogger("asynclogger")->Info("request body is empty");
+                Logger()->Info("request body is empty");
                 return;
             }
             // 创建一个字符串，长度为请求体的长度
@@ -142,7 +144,7 @@ namespace storage
             // 将请求体的内容复制到content中
             if (-1 == evbuffer_copyout(buf, (void *)content.c_str(), len))
             {
-                mylog::GetLogger("asynclogger")->Error("evbuffer_copyout error");
+                Logger()->Error("evbuffer_copyout error");
                 evhttp_send_reply(req, HTTP_INTERNAL, NULL, NULL);
                 return;
             }
@@ -166,7 +168,7 @@ namespace storage
             }
             else
             {
-                mylog::GetLogger("asynclogger")->Info("evhttp_send_reply: HTTP_BADREQUEST");
+                Logger()->Info("evhttp_send_reply: HTTP_BADREQUEST");
                 evhttp_send_reply(req, HTTP_BADREQUEST, "Illegal storage type", NULL);
                 return;
             }
@@ -178,7 +180,7 @@ namespace storage
             // 目录创建后加可以加上文件名，这个就是最终要写入的文件路径
             storage_path += filename;
 #ifdef DEBUG_LOG
-            mylog::GetLogger("asynclogger")->Debug("storage_path:%s", storage_path.c_str());
+            Logger()->Debug("storage_path:%s", storage_path.c_str());
 #endif
 
             // 看路径里是low还是deep存储，是deep就压缩，是low就直接写入
@@ -188,13 +190,13 @@ namespace storage
                 // 写入文件
                 if (fu.SetContent(content.c_str(), len) == false)
                 {
-                    mylog::GetLogger("asynclogger")->Error("low_storage fail, evhttp_send_reply: HTTP_INTERNAL");
+                    LOGERRORLIMIT(Logger(), 5, 1000, "low_storage fail, evhttp_send_reply: HTTP_INTERNAL");
                     evhttp_send_reply(req, HTTP_INTERNAL, "server error", NULL);
                     return;
                 }
                 else
                 {
-                    mylog::GetLogger("asynclogger")->Info("low_storage success");
+                    Logger()->Info("low_storage success");
                 }
             }
             else // 深度存储
@@ -202,13 +204,13 @@ namespace storage
                 // 压缩文件
                 if (fu.Compress(content, Config::GetInstance()->GetBundleFormat()) == false)
                 {
-                    mylog::GetLogger("asynclogger")->Error("deep_storage fail, evhttp_send_reply: HTTP_INTERNAL");
+                    LOGERRORLIMIT(Logger(), 5, 1000, "deep_storage fail, evhttp_send_reply: HTTP_INTERNAL");
                     evhttp_send_reply(req, HTTP_INTERNAL, "server error", NULL);
                     return;
                 }
                 else
                 {
-                    mylog::GetLogger("asynclogger")->Info("deep_storage success");
+                    Logger()->Info("deep_storage success");
                 }
             }
 
@@ -219,9 +221,23 @@ namespace storage
 
             // 发送200响应
             evhttp_send_reply(req, HTTP_OK, "Success", NULL);
-            mylog::GetLogger("asynclogger")->Info("upload finish:success");
+            Logger()->Info("upload finish:success");
+            LOGINFOKV(RequestLogger(), "upload", mylog::KV("url", "/upload"), mylog::KV("file", filename),
+                      mylog::KV("status", HTTP_OK), mylog::KV("bytes", len),
+                      mylog::KV("codec", storage_type == "deep" ? CodecName() : "none"),
+                      mylog::KV("latency_us", ElapsedUs(begin)));
         }
 
+        // 深度存储使用的压缩算法名
+        static const char *CodecName()
+        {
+            return bundle::name_of(static_cast<unsigned>(Config::GetInstance()->GetBundleFormat()));
+        }
+        // 从 begin 到现在经过的微秒数
+        static int64_t ElapsedUs(std::chrono::steady_clock::time_point begin)
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        }
         // 该函数用于将时间转换为字符串
         static std::string TimetoStr(time_t t)
         {
@@ -284,7 +300,7 @@ namespace storage
         // 该函数用于显示已存储文件列表
         static void ListShow(struct evhttp_request *req, void *arg)
         {
-            mylog::GetLogger("asynclogger")->Info("ListShow()");
+            Logger()->Info("ListShow()");
             // 1. 获取所有的文件存储信息
             std::vector<StorageInfo> arry;
             data_->GetAll(&arry);
@@ -311,7 +327,7 @@ namespace storage
             evbuffer_add(buf, (const void *)response_body.c_str(), response_body.size());
             evhttp_add_header(req->output_headers, "Content-Type", "text/html;charset=utf-8");
             evhttp_send_reply(req, HTTP_OK, NULL, NULL);
-            mylog::GetLogger("asynclogger")->Info("ListShow() finish");
+            Logger()->Info("ListShow() finish");
         }
         // 该函数用于获取ETag
         static std::string GetETag(const StorageInfo &info)
@@ -330,17 +346,18 @@ namespace storage
         {
             // 1. 获取客户端请求的资源路径path   req.path
             // 2. 根据资源路径，获取StorageInfo
+            auto begin = std::chrono::steady_clock::now();
             StorageInfo info;
             std::string resource_path = evhttp_uri_get_path(evhttp_request_get_evhttp_uri(req));
             resource_path = UrlDecode(resource_path);
             data_->GetOneByURL(resource_path, &info); // 通过 URL（key） 查找对应的 StorageInfo
-            mylog::GetLogger("asynclogger")->Info("request resource_path:%s", resource_path.c_str());
+            Logger()->Info("request resource_path:%s", resource_path.c_str());
 
             std::string download_path = info.storage_path_;
             // 2.如果压缩过了就解压到新文件给用户下载
             if (info.storage_path_.find(Config::GetInstance()->GetLowStorageDir()) == std::string::npos)
             {
-                mylog::GetLogger("asynclogger")->Info("uncompressing:%s", info.storage_path_.c_str());
+                Logger()->Info("uncompressing:%s", info.storage_path_.c_str());
                 FileUtil fu(info.storage_path_);
                 download_path = Config::GetInstance()->GetLowStorageDir() +
                                 std::string(download_path.begin() + download_path.find_last_of('/') + 1, download_path.end());
@@ -351,18 +368,18 @@ namespace storage
                 // 先检查目标存储目录是否存在，若不存在，则创建目录。
                 // 调用 UnCompress() 方法 解压文件，以便用户下载未压缩版本
             }
-            mylog::GetLogger("asynclogger")->Info("request download_path:%s", download_path.c_str());
+            Logger()->Info("request download_path:%s", download_path.c_str());
             FileUtil fu(download_path);
             if (fu.Exists() == false && info.storage_path_.find("deep_storage") != std::string::npos)
             {
                 // 如果是压缩文件，且解压失败，是服务端的错误
-                mylog::GetLogger("asynclogger")->Info("evhttp_send_reply: 500 - UnCompress failed");
+                Logger()->Info("evhttp_send_reply: 500 - UnCompress failed");
                 evhttp_send_reply(req, HTTP_INTERNAL, NULL, NULL);
             }
             else if (fu.Exists() == false && info.storage_path_.find("low_storage") == std::string::npos)
             {
                 // 如果是普通文件，且文件不存在，是客户端的错误
-                mylog::GetLogger("asynclogger")->Info("evhttp_send_reply: 400 - bad request,file not exists");
+                Logger()->Info("evhttp_send_reply: 400 - bad request,file not exists");
                 evhttp_send_reply(req, HTTP_BADREQUEST, "file not exists", NULL);
             }
 
@@ -377,14 +394,14 @@ namespace storage
                 if (old_etag == GetETag(info))
                 {
                     retrans = true;
-                    mylog::GetLogger("asynclogger")->Info("%s need breakpoint continuous transmission", download_path.c_str());
+                    Logger()->Info("%s need breakpoint continuous transmission", download_path.c_str());
                 }
             }
 
             // 4. 读取文件数据，放入rsp.body中
             if (fu.Exists() == false)
             {
-                mylog::GetLogger("asynclogger")->Info("%s not exists", download_path.c_str());
+                Logger()->Info("%s not exists", download_path.c_str());
                 download_path += "not exists";
                 evhttp_send_reply(req, 404, download_path.c_str(), NULL);
                 return;
@@ -394,14 +411,14 @@ namespace storage
             int fd = open(download_path.c_str(), O_RDONLY);
             if (fd == -1)
             {
-                mylog::GetLogger("asynclogger")->Error("open file error: %s -- %s", download_path.c_str(), strerror(errno));
+                LOGERRORLIMIT(Logger(), 5, 1000, "open file error: {} -- {}", download_path, strerror(errno));
                 evhttp_send_reply(req, HTTP_INTERNAL, strerror(errno), NULL);
                 return;
             }
             // 和前面用的evbuffer_add类似，但是效率更高，具体原因可以看函数声明
             if (-1 == evbuffer_add_file(outbuf, fd, 0, fu.FileSize()))
             {
-                mylog::GetLogger("asynclogger")->Error("evbuffer_add_file: %d -- %s -- %s", fd, download_path.c_str(), strerror(errno));
+                Logger()->Error("evbuffer_add_file: %d -- %s -- %s", fd, download_path.c_str(), strerror(errno));
             }
             // 5. 设置响应头部字段： ETag， Accept-Ranges: bytes
             evhttp_add_header(req->output_headers, "Accept-Ranges", "bytes");
@@ -410,13 +427,17 @@ namespace storage
             if (retrans == false)
             {
                 evhttp_send_reply(req, HTTP_OK, "Success", NULL); // 发送200响应:完整下载文件
-                mylog::GetLogger("asynclogger")->Info("evhttp_send_reply: HTTP_OK");
+                Logger()->Info("evhttp_send_reply: HTTP_OK");
             }
             else
             {
                 evhttp_send_reply(req, 206, "breakpoint continuous transmission", NULL); // 区间请求响应的是206:断点续传
-                mylog::GetLogger("asynclogger")->Info("evhttp_send_reply: 206");
+                Logger()->Info("evhttp_send_reply: 206");
             }
+            LOGINFOKV(RequestLogger(), "download", mylog::KV("url", resource_path),
+                      mylog::KV("status", retrans ? 206 : HTTP_OK), mylog::KV("bytes", fu.FileSize()),
+                      mylog::KV("codec", download_path != info.storage_path_ ? CodecName() : "none"),
+                      mylog::KV("latency_us", ElapsedUs(begin)));
             // 6. 清理临时解压缩文件
             if (download_path != info.storage_path_)
             {
@@ -15,7 +15,7 @@ mylog::Util::JsonData *g_conf_data;
 void service_module()
 {
     storage::Service s;
-    mylog::GetLogger("asynclogger")->Info("service step in RunModule");
+    storage::Logger()->Info("service step in RunModule");
     s.RunModule();
 }
 // 该函数用于初始化日志系统
@@ -25,11 +25,25 @@ void log_system_module_init()
     tp = new ThreadPool(g_conf_data->thread_count);                        // 创建线程池
     std::shared_ptr<mylog::LoggerBuilder> Glb(new mylog::LoggerBuilder()); // 创建日志构建器
     Glb->BuildLoggerName("asynclogger");                                   // 设置日志名称
+    Glb->BuildBinaryMode(mylog::BinaryMode::BACKEND);                      // 请求路径上的日志由后台线程格式化
+    // 滚动出去的日志文件在后台用 bundle 的 LZ4 压缩
+    mylog::RollFileFlush::SetCompressor([](const std::string &in, std::string *out)
+                                        {
+                                            *out = bundle::pack(bundle::LZ4, in);
+                                            return !out->empty(); },
+                                        ".lz4");
     Glb->BuildLoggerFlush<mylog::RollFileFlush>("./logfile/RollFile_log",
                                                 1024 * 1024); // 设置日志文件路径和大小
     // The LoggerManger has been built and is managed by members of the LoggerManger class
     // The logger is assigned to the managed object, and the caller lands the log by invoking the singleton managed object
     mylog::LoggerManager::GetInstance().AddLogger(Glb->Build()); // 添加日志
+
+    // 请求日志单独写一组文件，每行一个 JSON 对象
+    std::shared_ptr<mylog::LoggerBuilder> Rlb(new mylog::LoggerBuilder());
+    Rlb->BuildLoggerName("requestlogger");
+    Rlb->BuildRecordLayout(mylog::RecordLayout::JSON);
+    Rlb->BuildLoggerFlush<mylog::RollFileFlush>("./logfile/Request_log", 1024 * 1024);
+    mylog::LoggerManager::GetInstance().AddLogger(Rlb->Build());
 }
 
 int main()
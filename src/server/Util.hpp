@@ -16,6 +16,18 @@
 namespace storage
 {
     namespace fs = std::experimental::filesystem;
+    // 存储服务的日志器，第一次调用时解析出句柄并缓存，之后不再查表、加锁或增加引用计数
+    inline mylog::LoggerHandle &Logger()
+    {
+        static mylog::LoggerHandle handle = mylog::GetLoggerHandle("asynclogger");
+        return handle;
+    }
+    // 请求日志器，每个请求一行 JSON(url、字节数、压缩算法、耗时)，交给分析系统直接解析
+    inline mylog::LoggerHandle &RequestLogger()
+    {
+        static mylog::LoggerHandle handle = mylog::GetLoggerHandle("requestlogger");
+        return handle;
+    }
     // 将字符转换为十六进制
     static unsigned char ToHex(unsigned char x)
     {
@@ -75,7 +87,7 @@ namespace storage
             auto ret = stat(filename_.c_str(), &s);
             if (ret == -1)
             {
-                mylog::GetLogger("asynclogger")->Info("%s, Get file size failed: %s", filename_.c_str(), strerror(errno));
+                Logger()->Info("%s, Get file size failed: %s", filename_.c_str(), strerror(errno));
                 return -1;
             }
             return s.st_size;
@@ -87,7 +99,7 @@ namespace storage
             auto ret = stat(filename_.c_str(), &s);
             if (ret == -1)
             {
-                mylog::GetLogger("asynclogger")->Info("%s, Get file access time failed: %s", filename_.c_str(), strerror(errno));
+                Logger()->Info("%s, Get file access time failed: %s", filename_.c_str(), strerror(errno));
                 return -1;
             }
             return s.st_atime;
@@ -100,7 +112,7 @@ namespace storage
             auto ret = stat(filename_.c_str(), &s);
             if (ret == -1)
             {
-                mylog::GetLogger("asynclogger")->Info("%s, Get file modify time failed: %s", filename_.c_str(), strerror(errno));
+                Logger()->Info("%s, Get file modify time failed: %s", filename_.c_str(), strerror(errno));
                 return -1;
             }
             return s.st_mtime;
@@ -121,7 +133,7 @@ namespace storage
             // 判断要求数据内容是否符合文件大小
             if (pos + len > FileSize())
             {
-                mylog::GetLogger("asynclogger")->Info("needed data larger than file size");
+                Logger()->Info("needed data larger than file size");
                 return false;
             }
 
@@ -130,7 +142,7 @@ namespace storage
             ifs.open(filename_.c_str(), std::ios::binary);
             if (ifs.is_open() == false)
             {
-                mylog::GetLogger("asynclogger")->Info("%s,file open error", filename_.c_str());
+                Logger()->Info("%s,file open error", filename_.c_str());
                 return false;
             }
 
@@ -140,7 +152,7 @@ namespace storage
             ifs.read(&(*content)[0], len);
             if (!ifs.good())
             {
-                mylog::GetLogger("asynclogger")->Info("%s,read file content error", filename_.c_str());
+                Logger()->Info("%s,read file content error", filename_.c_str());
                 ifs.close();
                 return false;
             }
@@ -162,13 +174,13 @@ namespace storage
             ofs.open(filename_.c_str(), std::ios::binary);
             if (!ofs.is_open())
             {
-                mylog::GetLogger("asynclogger")->Info("%s open error: %s", filename_.c_str(), strerror(errno));
+                Logger()->Info("%s open error: %s", filename_.c_str(), strerror(errno));
                 return false;
             }
             ofs.write(content, len);
             if (!ofs.good())
             {
-                mylog::GetLogger("asynclogger")->Info("%s, file set content error", filename_.c_str());
+                Logger()->Info("%s, file set content error", filename_.c_str());
                 ofs.close();
             }
             ofs.close();
@@ -184,14 +196,14 @@ namespace storage
             std::string packed = bundle::pack(format, content);
             if (packed.size() == 0)
             {
-                mylog::GetLogger("asynclogger")->Info("Compress packed size error:%d", packed.size());
+                Logger()->Info("Compress packed size error:%zu", packed.size());
                 return false;
             }
             // 将压缩的数据写入压缩包文件中
             FileUtil f(filename_);
             if (f.SetContent(packed.c_str(), packed.size()) == false)
             {
-                mylog::GetLogger("asynclogger")->Info("filename:%s, Compress SetContent error", filename_.c_str());
+                Logger()->Info("filename:%s, Compress SetContent error", filename_.c_str());
                 return false;
             }
             return true;
@@ -203,7 +215,7 @@ namespace storage
             std::string body;
             if (this->GetContent(&body) == false)
             {
-                mylog::GetLogger("asynclogger")->Info("filename:%s, uncompress get file content failed!", filename_.c_str());
+                Logger()->Info("filename:%s, uncompress get file content failed!", filename_.c_str());
                 return false;
             }
             // 对压缩的数据进行解压缩
@@ -212,7 +224,7 @@ namespace storage
             FileUtil fu(download_path);
             if (fu.SetContent(unpacked.c_str(), unpacked.size()) == false)
             {
-                mylog::GetLogger("asynclogger")->Info("filename:%s, uncompress write packed data failed!", filename_.c_str());
+                Logger()->Info("filename:%s, uncompress write packed data failed!", filename_.c_str());
                 return false;
             }
             return true;
@@ -258,7 +270,7 @@ namespace storage
             std::stringstream ss;
             if (usw->write(val, &ss) != 0)
             {
-                mylog::GetLogger("asynclogger")->Info("serialize error");
+                Logger()->Info("serialize error");
                 return false;
             }
             *str = ss.str();
@@ -272,7 +284,7 @@ namespace storage
             std::string err;
             if (ucr->parse(str.c_str(), str.c_str() + str.size(), val, &err) == false)
             {
-                mylog::GetLogger("asynclogger")->Info("parse error");
+                Logger()->Info("parse error");
                 return false;
             }
             return true;